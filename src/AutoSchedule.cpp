@@ -1,7 +1,15 @@
 #include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <random>
 #include <regex>
+#include <thread>
 
 #include "AutoSchedule.h"
+#include "Associativity.h"
 #include "AutoScheduleUtils.h"
 #include "ExprUsesVar.h"
 #include "FindCalls.h"
@@ -13,6 +21,7 @@
 #include "RegionCosts.h"
 #include "Scope.h"
 #include "Simplify.h"
+#include "ThreadPool.h"
 #include "Util.h"
 
 namespace Halide {
@@ -135,28 +144,287 @@ void check_estimates_on_outputs(const vector<Function> &outputs) {
     }
 }
 
+// Return the 64-bit FNV-1a hash of 's'.
+uint64_t fingerprint(const string &s) {
+    uint64_t h = 14695981039346656037ULL;
+    for (char c : s) {
+        h = (h ^ (uint8_t)c) * 1099511628211ULL;
+    }
+    return h;
+}
+
+// Return a string representation of the definitions of all the stages of
+// 'f', which changes whenever their arguments, values or domains change.
+string definition_string(const Function &f) {
+    std::ostringstream oss;
+    oss << f.name() << "(";
+    for (const string &arg : f.args()) {
+        oss << arg << ", ";
+    }
+    oss << ")\n";
+
+    if (f.has_extern_definition()) {
+        oss << "extern " << f.extern_function_name();
+        for (const ExternFuncArgument &arg : f.extern_arguments()) {
+            if (arg.is_func()) {
+                oss << " " << Function(arg.func).name();
+            } else if (arg.is_expr()) {
+                oss << " " << arg.expr;
+            } else if (arg.is_buffer()) {
+                oss << " " << arg.buffer.name();
+            } else if (arg.is_image_param()) {
+                oss << " " << arg.image_param.name();
+            }
+        }
+        oss << "\n";
+        return oss.str();
+    }
+
+    int num_stages = f.updates().size() + 1;
+    for (int s = 0; s < num_stages; s++) {
+        Definition def = get_stage_definition(f, s);
+        for (const ReductionVariable &rv : def.schedule().rvars()) {
+            oss << rv.var << "[" << rv.min << ", " << rv.extent << "] ";
+        }
+        oss << "where " << def.predicate() << ": (";
+        for (const Expr &arg : def.args()) {
+            oss << arg << ", ";
+        }
+        oss << ") = ";
+        for (const Expr &val : def.values()) {
+            oss << val << " : " << val.type() << ", ";
+        }
+        oss << "\n";
+    }
+    return oss.str();
+}
+
+// Find the scalar parameters used by a function, whose estimates are
+// substituted by SubstituteVarEstimates.
+class FindScalarParams : public IRGraphVisitor {
+    using IRGraphVisitor::visit;
+
+    void visit(const Variable *var) override {
+        if (var->param.defined() && !var->param.is_buffer()) {
+            params.emplace(var->name, var->param);
+        }
+    }
+public:
+    map<string, Parameter> params;
+};
+
+// Write a bound of a region in the format of the regions required cache
+// file. Return false if the bound is neither constant nor infinite.
+bool write_cached_bound(std::ostream &stream, const Expr &e) {
+    if (e.same_as(Interval::neg_inf)) {
+        stream << " -inf";
+    } else if (e.same_as(Interval::pos_inf)) {
+        stream << " +inf";
+    } else if (e.type().is_int() && as_const_int(e)) {
+        stream << " " << e.type().bits() << ":" << *as_const_int(e);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Read a bound written by write_cached_bound(). Return an undefined Expr if
+// the bound is malformed.
+Expr read_cached_bound(const string &token) {
+    if (token == "-inf") {
+        return Interval::neg_inf;
+    } else if (token == "+inf") {
+        return Interval::pos_inf;
+    }
+    std::istringstream iss(token);
+    int bits = 0;
+    int64_t value = 0;
+    char sep = 0;
+    if (!(iss >> bits >> sep >> value) || (sep != ':') ||
+        !((bits == 8) || (bits == 16) || (bits == 32) || (bits == 64))) {
+        return Expr();
+    }
+    return make_const(Int(bits), value);
+}
+
+// The regions required by the queries of all the runs of the auto-scheduler
+// in this process. The entries are keyed by a fingerprint of the query, which
+// covers the definitions of all the functions the query depends on and the
+// estimates in effect, so that re-running the auto-scheduler on an edited
+// pipeline only recomputes the queries affected by the edit. If the
+// environment variable HL_AUTO_SCHEDULE_CACHE names a file, the regions with
+// constant bounds are loaded from it on first use, and saved to it after
+// each run of the auto-scheduler.
+class RegionsRequiredCache {
+    // The cache is cleared when it grows beyond this many entries.
+    static const size_t max_entries = 1 << 18;
+
+    std::mutex mutex;
+    map<uint64_t, map<string, Box>> entries;
+    string filename;
+    AutoScheduleCacheStats stats;
+
+    RegionsRequiredCache() : filename(get_env_variable("HL_AUTO_SCHEDULE_CACHE")) {
+        if (!filename.empty()) {
+            load();
+        }
+    }
+
+    void load() {
+        std::ifstream file(filename);
+        string line;
+        while (std::getline(file, line)) {
+            std::istringstream tokens(line);
+            string kind;
+            uint64_t key = 0;
+            size_t num_regions = 0;
+            if (!(tokens >> kind >> std::hex >> key >> std::dec >> num_regions) ||
+                (kind != "entry")) {
+                debug(1) << "Ignoring malformed auto-scheduler cache line: " << line << "\n";
+                continue;
+            }
+            map<string, Box> regions;
+            bool valid = true;
+            for (size_t r = 0; r < num_regions && valid; r++) {
+                valid = (bool)std::getline(file, line);
+                std::istringstream region(line);
+                string name, min, max;
+                size_t dims = 0;
+                valid = valid && (region >> name >> dims);
+                Box box;
+                for (size_t d = 0; d < dims && valid; d++) {
+                    valid = (bool)(region >> min >> max);
+                    Interval interval(read_cached_bound(min), read_cached_bound(max));
+                    valid = valid && interval.min.defined() && interval.max.defined();
+                    box.push_back(interval);
+                }
+                regions[name] = box;
+            }
+            if (!valid) {
+                debug(1) << "Ignoring malformed auto-scheduler cache file " << filename << "\n";
+                entries.clear();
+                return;
+            }
+            entries[key] = regions;
+        }
+        debug(1) << "Loaded " << entries.size() << " entries from auto-scheduler cache "
+                 << filename << "\n";
+    }
+
+public:
+    static RegionsRequiredCache &get() {
+        static RegionsRequiredCache cache;
+        return cache;
+    }
+
+    bool find(uint64_t key, map<string, Box> &regions) {
+        std::lock_guard<std::mutex> lock(mutex);
+        const auto &iter = entries.find(key);
+        if (iter == entries.end()) {
+            stats.misses++;
+            return false;
+        }
+        stats.hits++;
+        regions = iter->second;
+        return true;
+    }
+
+    void insert(uint64_t key, const map<string, Box> &regions) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (entries.size() >= max_entries) {
+            entries.clear();
+        }
+        entries[key] = regions;
+    }
+
+    // Save the entries with constant bounds to the cache file, if any.
+    void save() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (filename.empty()) {
+            return;
+        }
+        // Write to a temporary file first, so that concurrent runs never
+        // see a partially written cache.
+        string tmp = filename + ".tmp";
+        {
+            std::ofstream file(tmp);
+            for (const auto &entry : entries) {
+                std::ostringstream oss;
+                bool constant = true;
+                for (const auto &reg : entry.second) {
+                    constant = constant && !reg.second.used.defined();
+                    oss << reg.first << " " << reg.second.size();
+                    for (size_t d = 0; d < reg.second.size() && constant; d++) {
+                        constant = write_cached_bound(oss, reg.second[d].min) &&
+                            write_cached_bound(oss, reg.second[d].max);
+                    }
+                    oss << "\n";
+                }
+                if (constant) {
+                    file << "entry " << std::hex << entry.first << std::dec << " "
+                         << entry.second.size() << "\n" << oss.str();
+                }
+            }
+            if (!file) {
+                debug(1) << "Unable to write auto-scheduler cache " << tmp << "\n";
+                return;
+            }
+        }
+        if (std::rename(tmp.c_str(), filename.c_str()) != 0) {
+            debug(1) << "Unable to replace auto-scheduler cache " << filename << "\n";
+        }
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex);
+        entries.clear();
+        stats = AutoScheduleCacheStats();
+    }
+
+    AutoScheduleCacheStats get_stats() {
+        std::lock_guard<std::mutex> lock(mutex);
+        AutoScheduleCacheStats result = stats;
+        result.entries = entries.size();
+        return result;
+    }
+};
+
 struct DependenceAnalysis {
     // Map containing all the functions in the pipeline.
     map<string, Function> env;
     vector<string> order;
     FuncValueBounds func_val_bounds;
 
+    // Fingerprint of the definition of each function in the pipeline,
+    // combined with the fingerprints of the functions it calls.
+    map<string, uint64_t> func_fingerprints;
+    // The scalar parameters used by the functions in the pipeline.
+    map<string, Parameter> scalar_params;
+
     struct RegionsRequiredQuery {
         string f;
         int stage;
         set<string> prods;
         bool only_regions_computed;
+        // Fingerprint of the estimates the query is computed with.
+        uint64_t estimates;
 
         RegionsRequiredQuery(const string &f, int stage, const set<string> &prods,
-                             bool only_regions_computed)
+                             bool only_regions_computed, uint64_t estimates)
             : f(f), stage(stage), prods(prods),
-              only_regions_computed(only_regions_computed) {}
+              only_regions_computed(only_regions_computed), estimates(estimates) {}
 
         bool operator==(const RegionsRequiredQuery &other) const {
             return (f == other.f) && (stage == other.stage) && (prods == other.prods) &&
-                   (only_regions_computed == other.only_regions_computed);
+                   (only_regions_computed == other.only_regions_computed) &&
+                   (estimates == other.estimates);
         }
         bool operator<(const RegionsRequiredQuery &other) const {
+            if (estimates < other.estimates) {
+                return true;
+            } else if (estimates > other.estimates) {
+                return false;
+            }
             if (f < other.f) {
                 return true;
             } else if (f > other.f) {
@@ -184,12 +452,63 @@ struct DependenceAnalysis {
             : bounds(b), regions(r) {}
     };
     // Cache for bounds queries (bound queries with the same parameters are
-    // common during the grouping process).
+    // common during the grouping process). The cache is shared by all the
+    // threads evaluating grouping choices, and guarded by 'cache_mutex'.
     map<RegionsRequiredQuery, vector<RegionsRequired>> regions_required_cache;
+    std::unique_ptr<std::mutex> cache_mutex;
 
     DependenceAnalysis(const map<string, Function> &env, const vector<string> &order,
                        const FuncValueBounds &func_val_bounds)
-        : env(env), order(order), func_val_bounds(func_val_bounds) {}
+        : env(env), order(order), func_val_bounds(func_val_bounds),
+          cache_mutex(new std::mutex) {
+        // The producers come first in the realization order.
+        for (const string &name : order) {
+            const Function &f = get_element(env, name);
+            std::ostringstream oss;
+            oss << definition_string(f);
+            for (int i = 0; i < f.outputs(); i++) {
+                const auto &iter = func_val_bounds.find(make_pair(name, i));
+                if (iter != func_val_bounds.end()) {
+                    oss << "value " << i << " in [" << iter->second.min << ", "
+                        << iter->second.max << "]\n";
+                }
+            }
+            for (const auto &call : find_direct_calls(f)) {
+                const auto &iter = func_fingerprints.find(call.first);
+                if ((call.first != name) && (iter != func_fingerprints.end())) {
+                    oss << "calls " << call.first << " " << iter->second << "\n";
+                }
+            }
+            func_fingerprints[name] = fingerprint(oss.str());
+
+            FindScalarParams find;
+            f.accept(&find);
+            scalar_params.insert(find.params.begin(), find.params.end());
+        }
+    }
+
+    // Return a fingerprint of the estimates which the regions required depend
+    // on: those of the functions, the input images in 'input_estimates', and
+    // the scalar parameters. This is part of the key of the cached regions
+    // required. It is computed once for each set of estimates, and passed to
+    // the queries below as 'estimates_key'.
+    uint64_t estimates_fingerprint(const Scope<Interval> *input_estimates) const {
+        std::ostringstream oss;
+        for (const auto &f : env) {
+            for (const Bound &b : f.second.schedule().estimates()) {
+                oss << f.first << "." << b.var << " " << b.min << " " << b.extent << "\n";
+            }
+        }
+        if (input_estimates) {
+            for (auto iter = input_estimates->cbegin(); iter != input_estimates->cend(); ++iter) {
+                oss << iter.name() << " " << iter.value().min << " " << iter.value().max << "\n";
+            }
+        }
+        for (const auto &p : scalar_params) {
+            oss << p.first << " " << p.second.estimate() << "\n";
+        }
+        return fingerprint(oss.str());
+    }
 
     // Return the regions of the producers ('prods') required to compute the region
     // of the function stage ('f', 'stage_num') specified by 'bounds'. When
@@ -199,7 +518,8 @@ struct DependenceAnalysis {
                                       const DimBounds &bounds,
                                       const set<string> &prods,
                                       bool only_regions_computed,
-                                      const Scope<Interval> *input_estimates);
+                                      const Scope<Interval> *input_estimates,
+                                      uint64_t estimates_key);
 
     // Return the regions of the producers ('prods') required to compute the region
     // of the function specified by 'pure_bounds'. When 'only_regions_computed'
@@ -209,7 +529,8 @@ struct DependenceAnalysis {
                                       const DimBounds &pure_bounds,
                                       const set<string> &prods,
                                       bool only_regions_computed,
-                                      const Scope<Interval> *input_estimates);
+                                      const Scope<Interval> *input_estimates,
+                                      uint64_t estimates_key);
 
     // Return redundantly computed regions of producers ('prods') while computing
     // a region of the function stage ('f', 'stage_num') specified by 'bounds'.
@@ -222,14 +543,15 @@ struct DependenceAnalysis {
                                        const DimBounds &bounds,
                                        const set<string> &prods,
                                        bool only_regions_computed,
-                                       const Scope<Interval> *input_estimates);
+                                       const Scope<Interval> *input_estimates,
+                                       uint64_t estimates_key);
 
     // Return overlapping regions of producers ('prods') while computing a function
     // stage along each of the dimensions.
     vector<map<string, Box>>
     overlap_regions(Function f, int stage_num, const DimBounds &bounds,
                     const set<string> &prods, bool only_regions_computed,
-                    const Scope<Interval> *input_estimates);
+                    const Scope<Interval> *input_estimates, uint64_t estimates_key);
 };
 
 // Return the regions of the producers ('prods') required to compute the region
@@ -238,14 +560,16 @@ map<string, Box>
 DependenceAnalysis::regions_required(Function f, const DimBounds &pure_bounds,
                                      const set<string> &prods,
                                      bool only_regions_computed,
-                                     const Scope<Interval> *input_estimates) {
+                                     const Scope<Interval> *input_estimates,
+                                     uint64_t estimates_key) {
     // Find the regions required for each stage and merge them.
     map<string, Box> regions;
     int num_stages = f.updates().size() + 1;
     for (int s = 0; s < num_stages; s++) {
         DimBounds bounds = get_stage_bounds(f, s, pure_bounds);
         map<string, Box> stage_regions =
-            regions_required(f, s, bounds, prods, only_regions_computed, input_estimates);
+            regions_required(f, s, bounds, prods, only_regions_computed, input_estimates,
+                             estimates_key);
 
         merge_regions(regions, stage_regions);
     }
@@ -381,19 +705,46 @@ DependenceAnalysis::regions_required(Function f, int stage_num,
                                      const DimBounds &bounds,
                                      const set<string> &prods,
                                      bool only_regions_computed,
-                                     const Scope<Interval> *input_estimates) {
+                                     const Scope<Interval> *input_estimates,
+                                     uint64_t estimates_key) {
     // Iteratively compute the required regions by traversing the chain
     // of dependencies.
 
     // Check the cache if we've already computed this previously.
-    RegionsRequiredQuery query(f.name(), stage_num, prods, only_regions_computed);
-    const auto &iter = regions_required_cache.find(query);
-    if (iter != regions_required_cache.end()) {
-        const auto &it = std::find_if(iter->second.begin(), iter->second.end(),
-            [&bounds](const RegionsRequired &r) { return (r.bounds == bounds); });
-        if (it != iter->second.end()) {
-            internal_assert((iter->first == query) && (it->bounds == bounds));
-            return it->regions;
+    RegionsRequiredQuery query(f.name(), stage_num, prods, only_regions_computed, estimates_key);
+    {
+        std::lock_guard<std::mutex> lock(*cache_mutex);
+        const auto &iter = regions_required_cache.find(query);
+        if (iter != regions_required_cache.end()) {
+            const auto &it = std::find_if(iter->second.begin(), iter->second.end(),
+                [&bounds](const RegionsRequired &r) { return (r.bounds == bounds); });
+            if (it != iter->second.end()) {
+                internal_assert((iter->first == query) && (it->bounds == bounds));
+                return it->regions;
+            }
+        }
+    }
+
+    // Then check the cache shared with the previous runs of the auto-scheduler.
+    uint64_t key;
+    {
+        std::ostringstream oss;
+        oss << f.name() << " " << get_element(func_fingerprints, f.name()) << " "
+            << stage_num << " " << only_regions_computed << " " << estimates_key << "\n";
+        for (const string &p : prods) {
+            oss << p << " ";
+        }
+        oss << "\n";
+        for (const auto &b : bounds) {
+            oss << b.first << " [" << b.second.min << ", " << b.second.max << "]\n";
+        }
+        key = fingerprint(oss.str());
+
+        map<string, Box> cached;
+        if (RegionsRequiredCache::get().find(key, cached)) {
+            std::lock_guard<std::mutex> lock(*cache_mutex);
+            regions_required_cache[query].push_back(RegionsRequired(bounds, cached));
+            return cached;
         }
     }
 
@@ -575,6 +926,9 @@ DependenceAnalysis::regions_required(Function f, int stage_num,
         concrete_regions[f_reg.first] = concrete_box;
     }
 
+    RegionsRequiredCache::get().insert(key, concrete_regions);
+
+    std::lock_guard<std::mutex> lock(*cache_mutex);
     regions_required_cache[query].push_back(RegionsRequired(bounds, concrete_regions));
     return concrete_regions;
 }
@@ -587,11 +941,12 @@ DependenceAnalysis::redundant_regions(Function f, int stage_num, string var,
                                       const DimBounds &bounds,
                                       const set<string> &prods,
                                       bool only_regions_computed,
-                                      const Scope<Interval> *input_estimates) {
+                                      const Scope<Interval> *input_estimates,
+                                      uint64_t estimates_key) {
     // Find the regions required to compute the region of 'f' specified
     // by 'bounds'.
     map<string, Box> regions = regions_required(
-        f, stage_num, bounds, prods, only_regions_computed, input_estimates);
+        f, stage_num, bounds, prods, only_regions_computed, input_estimates, estimates_key);
 
     // Shift the bounds by the size of the interval along the direction
     // of var.
@@ -610,7 +965,8 @@ DependenceAnalysis::redundant_regions(Function f, int stage_num, string var,
     // Find the regions required to compute the region of f specified
     // by shifted_bounds.
     map<string, Box> regions_shifted = regions_required(
-        f, stage_num, shifted_bounds, prods, only_regions_computed, input_estimates);
+        f, stage_num, shifted_bounds, prods, only_regions_computed, input_estimates,
+        estimates_key);
 
     // Compute the overlaps between 'regions_shifted' and the original
     // regions required.
@@ -653,7 +1009,8 @@ DependenceAnalysis::overlap_regions(Function f, int stage_num,
                                     const DimBounds &bounds,
                                     const set<string> &prods,
                                     bool only_regions_computed,
-                                    const Scope<Interval> *input_estimates) {
+                                    const Scope<Interval> *input_estimates,
+                                    uint64_t estimates_key) {
     vector<map<string, Box>> conc_overlaps;
 
     const vector<Dim> &dims = get_stage_dims(f, stage_num);
@@ -661,7 +1018,8 @@ DependenceAnalysis::overlap_regions(Function f, int stage_num,
     // Get the redundant regions along each dimension of f.
     for (int d = 0; d < (int)dims.size() - 1; d++) {
         map<string, Box> conc_reg = redundant_regions(f, stage_num, dims[d].var, bounds,
-                                                      prods, only_regions_computed, input_estimates);
+                                                      prods, only_regions_computed, input_estimates,
+                                                      estimates_key);
         conc_overlaps.push_back(conc_reg);
     }
     return conc_overlaps;
@@ -673,6 +1031,7 @@ map<string, Box> get_pipeline_bounds(DependenceAnalysis &analysis,
                                      const vector<Function> &outputs,
                                      const Scope<Interval> *input_estimates) {
     map<string, Box> pipeline_bounds;
+    uint64_t estimates_key = analysis.estimates_fingerprint(input_estimates);
 
     // Find the regions required for each of the outputs and merge them
     // to compute the full pipeline_bounds.
@@ -702,7 +1061,7 @@ map<string, Box> get_pipeline_bounds(DependenceAnalysis &analysis,
         }
 
         map<string, Box> regions = analysis.regions_required(out, pure_bounds, prods,
-                                                             false, input_estimates);
+                                                             false, input_estimates, estimates_key);
 
         // Add the output region to the pipeline bounds as well.
         regions.emplace(out.name(), out_box);
@@ -746,6 +1105,32 @@ struct AutoSchedule {
     // function stages.
     map<string, map<int, set<string>>> used_vars;
 
+    // Store the intermediate Funcs introduced by rfactor(), keyed by their
+    // names. Their schedules are emitted right after the rfactor() call,
+    // within the schedule of the function they were created from.
+    struct RFactor {
+        string function;
+        size_t stage;
+        string call;
+        // The RVars of the stage before it was rfactored
+        vector<ReductionVariable> rvars;
+        map<int, vector<string>> schedules;
+    };
+    map<string, RFactor> rfactors;
+
+    // Store the schedules applied to specializations of some function stages,
+    // in the order the specializations were created, along with the
+    // string representation of their conditions.
+    map<string, map<int, vector<pair<string, vector<string>>>>> specializations;
+
+    // The condition of the specialization the schedules are currently
+    // applied to, or empty if they are applied to the stages themselves.
+    string specialization;
+
+    // The names of the input images the schedules refer to, which are
+    // declared before the Funcs.
+    set<string> inputs;
+
     AutoSchedule(const map<string, Function> &env, const vector<string> &order) : env(env) {
         for (size_t i = 0; i < order.size(); ++i) {
             realization_order.emplace(order[i], i);
@@ -765,6 +1150,40 @@ struct AutoSchedule {
         return "pipeline.get_func(" + std::to_string(index) + ")";
     }
 
+    // Given the name of an input image, return a string representation of
+    // its handle, which is declared in the schedule
+    string get_input_handle(const string &name) {
+        inputs.insert(name);
+        return get_sanitized_name(name);
+    }
+
+    // Print the schedules applied to the stages of the function 'fname'
+    static void print_schedules(std::ostream &stream, const string &fname,
+                                const map<int, vector<string>> &schedules) {
+        for (const auto &s : schedules) {
+            print_stage_schedules(stream, fname, s.first, "", s.second);
+        }
+    }
+
+    // Print the schedules applied to a stage of the function 'fname', or to
+    // one of its specializations if 'condition' is not empty
+    static void print_stage_schedules(std::ostream &stream, const string &fname,
+                                      int stage, const string &condition,
+                                      const vector<string> &schedules) {
+        internal_assert(!schedules.empty());
+        stream << "    " << fname;
+        if (stage > 0) {
+            stream << ".update(" << std::to_string(stage - 1) << ")";
+        }
+        if (!condition.empty()) {
+            stream << ".specialize(" << condition << ")";
+        }
+        for (size_t i = 0; i < schedules.size(); ++i) {
+            stream << "\n        ." << schedules[i];
+        }
+        stream << ";\n";
+    }
+
     friend std::ostream& operator<<(std::ostream &stream, const AutoSchedule &sched) {
         for (const auto &iter : sched.internal_vars) {
             if (iter.second.is_rvar) {
@@ -776,6 +1195,15 @@ struct AutoSchedule {
         }
         stream << "\n";
 
+        // Declare the input images referred to by the schedules
+        for (const string &name : sched.inputs) {
+            stream << "ImageParam " << get_sanitized_name(name)
+                   << " = pipeline.get_input(\"" << name << "\");\n";
+        }
+        if (!sched.inputs.empty()) {
+            stream << "\n";
+        }
+
         // Declare all the functions + schedules
         std::ostringstream func_ss;
         std::ostringstream schedule_ss;
@@ -797,8 +1225,14 @@ struct AutoSchedule {
             }
             set<string> declared_rvars;
             for (size_t i = 0; i < func.updates().size(); ++i) {
-                const vector<ReductionVariable> &rvars = func.updates()[i].schedule().rvars();
-                const set<string> &var_list = sched.used_vars.at(func.name()).at(i);
+                const vector<ReductionVariable> *stage_rvars = &func.updates()[i].schedule().rvars();
+                for (const auto &r : sched.rfactors) {
+                    if ((r.second.function == f.first) && (r.second.stage == i + 1)) {
+                        stage_rvars = &r.second.rvars;
+                    }
+                }
+                const vector<ReductionVariable> &rvars = *stage_rvars;
+                const set<string> &var_list = sched.used_vars.at(func.name()).at(i + 1);
                 for (size_t j = 0; j < rvars.size(); ++j) {
                     if ((var_list.find(rvars[j].var) == var_list.end()) ||
                         (declared_rvars.find(rvars[j].var) != declared_rvars.end())) {
@@ -810,16 +1244,30 @@ struct AutoSchedule {
                 }
             }
 
-            for (const auto &s : f.second) {
-                internal_assert(!s.second.empty());
-                schedule_ss << "    " << fname;
-                if (s.first > 0) {
-                    schedule_ss << ".update(" << std::to_string(s.first - 1) << ")";
+            // The specializations copy the schedule applied so far, so they
+            // are created first.
+            const auto &spec_iter = sched.specializations.find(f.first);
+            if (spec_iter != sched.specializations.end()) {
+                for (const auto &s : spec_iter->second) {
+                    for (const auto &spec : s.second) {
+                        print_stage_schedules(schedule_ss, fname, s.first, spec.first, spec.second);
+                    }
+                }
+            }
+
+            print_schedules(schedule_ss, fname, f.second);
+
+            for (const auto &r : sched.rfactors) {
+                if (r.second.function != f.first) {
+                    continue;
                 }
-                for (size_t i = 0; i < s.second.size(); ++i) {
-                    schedule_ss << "\n        ." << s.second[i];
+                const string &intm_name = get_sanitized_name(r.first);
+                schedule_ss << "    Func " << intm_name << " = " << fname;
+                if (r.second.stage > 0) {
+                    schedule_ss << ".update(" << std::to_string(r.second.stage - 1) << ")";
                 }
-                schedule_ss << ";\n";
+                schedule_ss << "." << r.second.call << ";\n";
+                print_schedules(schedule_ss, intm_name, r.second.schedules);
             }
 
             schedule_ss << "}\n";
@@ -836,11 +1284,39 @@ struct AutoSchedule {
         vector<string> v = split_string(stage_name, ".");
         internal_assert(!v.empty());
 
-        used_vars[v[0]][stage_num].insert(vars.begin(), vars.end());
+        // The Vars of an intermediate Func created by rfactor() are declared
+        // with the function it was created from.
+        const auto &iter = rfactors.find(v[0]);
+        if (iter != rfactors.end()) {
+            used_vars[iter->second.function][0].insert(vars.begin(), vars.end());
+        } else {
+            used_vars[v[0]][stage_num].insert(vars.begin(), vars.end());
+        }
+
+        vector<string> *stage_schedules = nullptr;
+        if (iter != rfactors.end()) {
+            stage_schedules = &iter->second.schedules[stage_num];
+        } else if (!specialization.empty()) {
+            // Make sure the function is printed even if only its
+            // specializations are scheduled.
+            func_schedules[v[0]];
+            auto &specs = specializations[v[0]][stage_num];
+            for (auto &spec : specs) {
+                if (spec.first == specialization) {
+                    stage_schedules = &spec.second;
+                }
+            }
+            if (!stage_schedules) {
+                specs.push_back({specialization, {}});
+                stage_schedules = &specs.back().second;
+            }
+        } else {
+            stage_schedules = &func_schedules[v[0]][stage_num];
+        }
 
         // If the previous schedule applied is the same as this one,
         // there is no need to re-apply the schedule
-        auto &schedules = func_schedules[v[0]][stage_num];
+        vector<string> &schedules = *stage_schedules;
         if (schedules.empty()) {
             schedules.push_back(sched);
         } else {
@@ -849,6 +1325,15 @@ struct AutoSchedule {
             }
         }
     }
+
+    void push_rfactor(const string &stage_name, size_t stage_num, const string &intm_name,
+                      const string &call, const vector<ReductionVariable> &rvars) {
+        vector<string> v = split_string(stage_name, ".");
+        internal_assert(!v.empty());
+
+        RFactor r = {v[0], stage_num, call, rvars, {}};
+        rfactors.emplace(intm_name, r);
+    }
 };
 
 // Implement the grouping algorithm and the cost model for making the grouping
@@ -909,13 +1394,16 @@ struct Partitioner {
     // can be integrated into the cost model with out significantly increasing
     // the time to analyze a grouping configuration.
     //
-    // TODO: Add sliding window optimizations. For start, it may be enough to
-    // implement sliding window as a post-pass by moving the store level of all
-    // the members of the group to the outermost serial loop. This could possibly
-    // be incorporated in the cost model with some effort. Line-buffering
-    // presents additional challenges for this post-processing strategy though.
-    // A typical line-buffer would use terrible tile size for tiling, but its
-    // performance will improve significantly once sliding window is turned on.
+    // Sliding window: the members of a group can also be stored one tile loop
+    // outside of the level at which they are computed ('sliding_var'), so that
+    // the sliding window optimization only computes the values that were not
+    // computed for the previous tile, and storage folding keeps the footprint
+    // of a tile. This covers line-buffering, which uses tile sizes that would
+    // be terrible without sliding window. The cost model accounts for it by
+    // ignoring the redundant work along 'sliding_var'.
+    //
+    // TODO: Sliding window is only considered for groups whose members are
+    // pure Funcs without update definitions.
     //
     // TODO: Register tiling is an important transformation especially for
     // benchmarks with significant reuse of the data (like matrix multiply and
@@ -932,6 +1420,9 @@ struct Partitioner {
         set<string> inlined;
         // Tile sizes along dimensions of the output function of the group.
         map<string, Expr> tile_sizes;
+        // Dimension of the output function of the group along which the
+        // members slide, or empty if they are stored at the compute level.
+        string sliding_var;
 
         Group(const FStage &output, const vector<FStage> &members)
             : output(output), members(members) {}
@@ -965,6 +1456,10 @@ struct Partitioner {
             }
             stream << "}" << '\n';
 
+            if (!g.sliding_var.empty()) {
+                stream << "Sliding along: " << g.sliding_var << '\n';
+            }
+
             return stream;
         }
     };
@@ -1001,12 +1496,15 @@ struct Partitioner {
 
     // Configuration of a group and the corresponding analysis. A group is the
     // set of functions that are computed together in tiles and the group config
-    // specifies at what granularity they are computed together ('tile_sizes').
+    // specifies at what granularity they are computed together ('tile_sizes'),
+    // and along which dimension they slide, if any ('sliding_var').
     struct GroupConfig {
         map<string, Expr> tile_sizes;
         GroupAnalysis analysis;
-        GroupConfig(const map<string, Expr> &tile_sizes, const GroupAnalysis &analysis)
-            : tile_sizes(tile_sizes), analysis(analysis) {}
+        string sliding_var;
+        GroupConfig(const map<string, Expr> &tile_sizes, const GroupAnalysis &analysis,
+                    const string &sliding_var = "")
+            : tile_sizes(tile_sizes), analysis(analysis), sliding_var(sliding_var) {}
         GroupConfig() : tile_sizes(map<string, Expr>()), analysis(GroupAnalysis()) {}
     };
 
@@ -1041,6 +1539,8 @@ struct Partitioner {
     // Parameters of the machine model that is used for estimating the cost of each
     // group in the pipeline.
     const MachineParams &arch_params;
+    // Target the pipeline is scheduled for. This determines the SIMD width.
+    const Target &target;
     // Dependency analysis of the pipeline. This support queries on regions
     // accessed and computed for producing some regions of some functions.
     DependenceAnalysis &dep_analysis;
@@ -1049,15 +1549,27 @@ struct Partitioner {
     RegionCosts &costs;
     // Output functions of the pipeline.
     const vector<Function> &outputs;
+    // Fingerprint of the estimates in effect, with which the regions required
+    // are cached. The estimates don't change while the partitioner is in use.
+    const uint64_t estimates_key;
+    // Thread pool on which grouping choices and tile configurations are
+    // evaluated. Null when evaluating them serially.
+    std::unique_ptr<ThreadPool<void>> pool;
 
     Partitioner(const map<string, Box> &_pipeline_bounds,
                 const MachineParams &_arch_params,
+                const Target &_target,
                 const vector<Function> &_outputs,
                 DependenceAnalysis &_dep_analysis,
                 RegionCosts &_costs);
 
     void initialize_groups();
 
+    // Call 'f(i)' for each 'i' in [0, n), in parallel on 'pool' if there is one.
+    // Calls made from within 'f' run serially, so that the threads never wait
+    // on each other. 'f' must only write to distinct locations for each 'i'.
+    void parallel_for(int n, const std::function<void(int)> &f);
+
     // Merge 'prod_group' into 'cons_group'. The output stage of 'cons_group'
     // will be the output stage of the merged group.
     Group merge_groups(const Group &prod_group, const Group &cons_group);
@@ -1081,8 +1593,9 @@ struct Partitioner {
     map<FStage, map<FStage, DimBounds>> group_loop_bounds();
 
     // Partition the pipeline by iteratively merging groups until a fixpoint is
-    // reached.
-    void group(Partitioner::Level level);
+    // reached, or until 'max_merges' merges have been done if it is not negative.
+    // Return the number of merges done.
+    int group(Partitioner::Level level, int max_merges = -1);
 
     // Given a grouping choice, return a configuration for the group that gives
     // the highest estimated benefits.
@@ -1105,14 +1618,28 @@ struct Partitioner {
     // Return the estimated size of the bounds.
     map<string, Expr> bounds_to_estimates(const DimBounds &bounds);
 
+    // Return the cost of a load relative to an arithmetic operation, when the
+    // data being accessed has a memory footprint of 'footprint' bytes.
+    Expr load_cost_factor(const Expr &footprint);
+
     // Given a function stage, return a vector of possible tile configurations for
     // that function stage.
     vector<map<string, Expr>> generate_tile_configs(const FStage &stg);
 
+    // Return the dimensions of the output of group 'g' along which its members
+    // can slide when it is tiled with 'tile_sizes'.
+    vector<string> sliding_candidates(const Group &g, const map<string, Expr> &tile_sizes);
+
     // Find the best tiling configuration for a group 'g' among a set of tile
-    // configurations. This returns a pair of configuration with the highest
-    // estimated benefit and the estimated benefit.
-    pair<map<string, Expr>, GroupAnalysis> find_best_tile_config(const Group &g);
+    // configurations, with or without sliding window. This returns the
+    // configuration with the highest estimated benefit and its analysis.
+    GroupConfig find_best_tile_config(const Group &g);
+
+    // Return the tiling configurations of a group 'g' ordered by decreasing
+    // estimated benefit. The first one is the configuration returned by
+    // 'find_best_tile_config'; configurations with an unknown benefit are
+    // left out.
+    vector<GroupConfig> rank_tile_configs(const Group &g);
 
     // Estimate the benefit (arithmetic + memory) of 'new_grouping' over 'old_grouping'.
     // Positive values indicates that 'new_grouping' may be preferrable over 'old_grouping'.
@@ -1164,14 +1691,29 @@ struct Partitioner {
     // auto scheduling.
     void generate_cpu_schedule(const Target &t, AutoSchedule &sched);
 
+    // Generate schedules for the specialization of the output stages of the
+    // groups in 'default_groups' under 'condition', for the pipeline bounds
+    // of this partitioner. Only the groups whose members are all inlined are
+    // specialized, since the compute levels of the other members depend on
+    // the loops of their group output. The tile sizes are chosen again for
+    // the pipeline bounds. This must be called before the schedules of
+    // 'default_groups' are applied, since a specialization copies the schedule
+    // of the stage.
+    void generate_specialized_cpu_schedule(const map<FStage, Group> &default_groups,
+                                           const Target &t, const Expr &condition,
+                                           AutoSchedule &sched);
+
     // Same as \ref Partitioner::generate_cpu_schedule, but this generates and
-    // applies schedules for a group of function stages.
+    // applies schedules for a group of function stages. If 'specialization'
+    // is defined, the schedule is applied to the specialization of the group
+    // output under that condition instead.
 
     void generate_group_cpu_schedule(const Group &g, const Target &t,
                                      const map<FStage, DimBounds> &group_loop_bounds,
                                      const map<string, Box> &group_storage_bounds,
                                      const set<string> &inlines,
-                                     AutoSchedule &sched);
+                                     AutoSchedule &sched,
+                                     const Expr &specialization = Expr());
 
     // Split the dimension of stage 'f_handle' along 'v' into inner and outer
     // dimensions. Modify 'estimates' according to the split and append the split
@@ -1182,11 +1724,37 @@ struct Partitioner {
         string out_suffix, map<string, Expr> &estimates, AutoSchedule &sched);
 
     // Loop over the dimensions of function stage 'f_handle' starting from innermost
-    // and vectorize the first pure dimension encountered.
+    // and vectorize the first pure dimension encountered. Stages which are cheap
+    // per point are vectorized at a multiple of the natural vector size.
     void vectorize_stage(
         const Group &g, Stage f_handle, int stage_num, Definition def,
         Function func, bool is_group_output, const Target &t, set<string> &rvars,
-        map<string, Expr> &estimates, AutoSchedule &sched);
+        map<string, Expr> &estimates, const set<string> &inlines, AutoSchedule &sched);
+
+    // Unroll the innermost loop of function stage 'f_handle' if it is over an
+    // RVar with a constant extent: fully if the unrolled body is small enough,
+    // or else by the largest factor dividing the extent that keeps it small.
+    void unroll_stage(
+        const Group &g, Stage f_handle, int stage_num, Definition def,
+        Function func, bool is_group_output, set<string> &rvars,
+        map<string, Expr> &estimates, const set<string> &inlines, AutoSchedule &sched);
+
+    // Prefetch the input images of the output stage of group 'g' which are too
+    // large for the last level cache, at the innermost serial loop whose
+    // iterations access at least a cache line. The distance is the number of
+    // iterations which cost as much as a load from memory.
+    void prefetch_inputs(
+        const Group &g, Stage f_handle, Definition def, const Target &t,
+        const map<string, Expr> &estimates, const set<string> &inlines,
+        AutoSchedule &sched);
+
+    // If the output of group 'g' is an associative reduction whose pure
+    // dimensions do not provide enough parallelism for the target machine,
+    // split its outermost RVar and rfactor() the outer part into a pure
+    // dimension of a parallel intermediate Func. Return true if the stage
+    // was rfactored, in which case it needs no further scheduling.
+    bool rfactor_group_output(const Group &g, Stage f_handle, Definition def,
+                              map<string, Expr> &estimates, AutoSchedule &sched);
 
     // Reorder the dimensions to preserve spatial locality. This function
     // checks the stride of each access. The dimensions of the loop are reordered
@@ -1292,11 +1860,20 @@ void Partitioner::disp_pipeline_costs() {
 // algorithm operates.
 Partitioner::Partitioner(const map<string, Box> &_pipeline_bounds,
                          const MachineParams &_arch_params,
+                         const Target &_target,
                          const vector<Function> &_outputs,
                          DependenceAnalysis &_dep_analysis,
                          RegionCosts &_costs)
-        : pipeline_bounds(_pipeline_bounds), arch_params(_arch_params),
-          dep_analysis(_dep_analysis), costs(_costs), outputs(_outputs) {
+        : pipeline_bounds(_pipeline_bounds), arch_params(_arch_params), target(_target),
+          dep_analysis(_dep_analysis), costs(_costs), outputs(_outputs),
+          estimates_key(_dep_analysis.estimates_fingerprint(&_costs.input_estimates)) {
+    // If we are running with HL_DEBUG_CODEGEN=1, evaluate the choices serially,
+    // so that the debug output won't be utterly incomprehensible.
+    const size_t num_threads = (debug::debug_level() > 0) ? 1 : ThreadPool<void>::num_processors_online();
+    if (num_threads > 1) {
+        pool.reset(new ThreadPool<void>(num_threads));
+    }
+
     // Place each stage of a function in its own group. Each stage is
     // a node in the pipeline graph.
     for (const auto &f : dep_analysis.env) {
@@ -1341,14 +1918,44 @@ Partitioner::Partitioner(const map<string, Box> &_pipeline_bounds,
 }
 
 void Partitioner::initialize_groups() {
+    vector<Group *> all_groups;
     for (pair<const FStage, Group> &g : groups) {
-        pair<map<string, Expr>, GroupAnalysis> best = find_best_tile_config(g.second);
-        g.second.tile_sizes = best.first;
-        group_costs.emplace(g.second.output, best.second);
+        all_groups.push_back(&g.second);
+    }
+    vector<GroupAnalysis> analyses(all_groups.size());
+    parallel_for(all_groups.size(), [&](int i) {
+        GroupConfig best = find_best_tile_config(*all_groups[i]);
+        all_groups[i]->tile_sizes = best.tile_sizes;
+        all_groups[i]->sliding_var = best.sliding_var;
+        analyses[i] = best.analysis;
+    });
+    for (size_t i = 0; i < all_groups.size(); i++) {
+        group_costs.emplace(all_groups[i]->output, analyses[i]);
     }
     grouping_cache.clear();
 }
 
+void Partitioner::parallel_for(int n, const std::function<void(int)> &f) {
+    static thread_local bool in_task = false;
+    if (!pool || in_task || (n < 2)) {
+        for (int i = 0; i < n; i++) {
+            f(i);
+        }
+        return;
+    }
+    vector<std::future<void>> futures;
+    for (int i = 0; i < n; i++) {
+        futures.push_back(pool->async([&f, i]() {
+            in_task = true;
+            f(i);
+            in_task = false;
+        }));
+    }
+    for (auto &future : futures) {
+        future.wait();
+    }
+}
+
 map<string, Expr> Partitioner::evaluate_reuse(const FStage &stg,
                                               const set<string> &prods) {
     map<string, Expr> reuse;
@@ -1371,7 +1978,7 @@ map<string, Expr> Partitioner::evaluate_reuse(const FStage &stg,
 
     vector<map<string, Box>> reuse_regions =
         dep_analysis.overlap_regions(stg.func, stg.stage_num, bounds, prods,
-                                     false, &costs.input_estimates);
+                                     false, &costs.input_estimates, estimates_key);
 
     for (int d = 0; d < (int)dims.size() - 1; d++) {
         Expr total_reuse = make_zero(Int(64));
@@ -1396,6 +2003,33 @@ map<string, Expr> Partitioner::evaluate_reuse(const FStage &stg,
 vector<pair<Partitioner::GroupingChoice, Partitioner::GroupConfig>>
 Partitioner::choose_candidate_grouping(const vector<pair<string, string>> &cands,
                                        Partitioner::Level level) {
+    // Evaluate the choices that have not been evaluated for grouping before
+    // in parallel, and cache the results.
+    vector<GroupingChoice> to_evaluate;
+    for (const auto &p : cands) {
+        const Function &prod_f = get_element(dep_analysis.env, p.first);
+        int final_stage = prod_f.updates().size();
+
+        FStage prod(prod_f, final_stage);
+
+        for (const FStage &c : get_element(children, prod)) {
+            GroupingChoice cand_choice(prod_f.name(), c);
+            if ((grouping_cache.find(cand_choice) == grouping_cache.end()) &&
+                (std::find(to_evaluate.begin(), to_evaluate.end(), cand_choice) == to_evaluate.end())) {
+                to_evaluate.push_back(cand_choice);
+            }
+        }
+    }
+    vector<GroupConfig> configs(to_evaluate.size());
+    parallel_for(to_evaluate.size(), [&](int i) {
+        configs[i] = evaluate_choice(to_evaluate[i], level);
+    });
+    for (size_t i = 0; i < to_evaluate.size(); i++) {
+        grouping_cache.emplace(to_evaluate[i], configs[i]);
+    }
+
+    // Pick the best choice in the order of the candidates, so that the result
+    // does not depend on the order in which the choices were evaluated.
     vector<pair<GroupingChoice, GroupConfig>> best_grouping;
     Expr best_benefit = make_zero(Int(64));
     for (const auto &p : cands) {
@@ -1408,20 +2042,8 @@ Partitioner::choose_candidate_grouping(const vector<pair<string, string>> &cands
         FStage prod(prod_f, final_stage);
 
         for (const FStage &c : get_element(children, prod)) {
-            GroupConfig best_config;
             GroupingChoice cand_choice(prod_f.name(), c);
-
-            // Check if the candidate has been evaluated for grouping before
-            const auto &iter = grouping_cache.find(cand_choice);
-            if (iter != grouping_cache.end()) {
-                best_config = iter->second;
-            } else {
-                best_config = evaluate_choice(cand_choice, level);
-                // Cache the result of the evaluation for the pair
-                grouping_cache.emplace(cand_choice, best_config);
-            }
-
-            grouping.push_back(make_pair(cand_choice, best_config));
+            grouping.push_back(make_pair(cand_choice, get_element(grouping_cache, cand_choice)));
         }
 
         bool no_redundant_work = false;
@@ -1468,11 +2090,18 @@ inline bool operator==(const map<string, Expr> &m1, const map<string, Expr> &m2)
 
 vector<map<string, Expr>> Partitioner::generate_tile_configs(const FStage &stg) {
     // TODO: This is a wart due to the cost model not taking vectorization
-    // and pre-fetching into account. Ensuring the innermost dimension has
-    // at least size of 64 gives enough values for vectorization and can help
+    // and pre-fetching into account. Ensuring the innermost dimension spans
+    // several SIMD vectors gives enough values for vectorization and can help
     // with prefetching. This also interacts with the number of parallel tasks
     // that are generated.
-    int min_inner_dim_size = 64;
+    const int vectors_per_inner_dim = 8;
+    int bytes_per_point = 0;
+    int min_inner_dim_size = 1;
+    for (const Type &t : stg.func.output_types()) {
+        bytes_per_point += t.bytes();
+        min_inner_dim_size = std::max(min_inner_dim_size,
+                                      vectors_per_inner_dim * target.natural_vector_size(t));
+    }
 
     const vector<Dim> &dims = get_stage_dims(stg.func, stg.stage_num);
 
@@ -1488,8 +2117,35 @@ vector<map<string, Expr>> Partitioner::generate_tile_configs(const FStage &stg)
     vector<int> size_variants = {1, 4, 8, 16, 32, 64, 128, 256};
     vector<map<string, Expr>> tile_configs;
 
+    // The sizes of the square tiles of the output that fit in each level of
+    // cache of a core. This ignores the footprint of the producers, which the
+    // cost model accounts for when comparing the configurations.
+    vector<int> cache_tile_sizes;
+    {
+        vector<Expr> cache_sizes = {arch_params.l1_cache_size, arch_params.l2_cache_size};
+        Expr llc = arch_params.last_level_cache_size;
+        if (!is_zero(arch_params.cores)) {
+            llc = llc / arch_params.cores;
+        }
+        cache_sizes.push_back(llc);
+        for (const Expr &size : cache_sizes) {
+            const int64_t *bytes = as_const_int(simplify(size));
+            if (!bytes || (*bytes <= 0) || tile_vars.empty()) {
+                continue;
+            }
+            double points = (double)*bytes / std::max(bytes_per_point, 1);
+            int side = (int)std::pow(points, 1.0 / tile_vars.size());
+            // Round down to a power of two.
+            int tile_size = 1;
+            while (tile_size * 2 <= side) {
+                tile_size *= 2;
+            }
+            cache_tile_sizes.push_back(tile_size);
+        }
+    }
+
     // For all the tile configurations generated, we force the innermost dimension
-    // to be at least of size 64 to ensure enough values for vectorization.
+    // to be at least 'min_inner_dim_size' to ensure enough values for vectorization.
 
     // Skewed tile configurations
     for (size_t i = 0; i < tile_vars.size(); i++) {
@@ -1534,6 +2190,24 @@ vector<map<string, Expr>> Partitioner::generate_tile_configs(const FStage &stg)
         }
     }
 
+    // Square tile configurations for each cache level
+    for (const auto &dim_size : cache_tile_sizes) {
+        map<string, Expr> tiling;
+        for (size_t j = 0; j < tile_vars.size(); j++) {
+            tiling.emplace(tile_vars[j],
+                           (j == 0) ? std::max(dim_size, min_inner_dim_size): dim_size);
+        }
+        if (!tiling.empty()) {
+            bool is_duplicate =
+                std::find_if(tile_configs.begin(), tile_configs.end(),
+                            [&tiling](const map<string, Expr> &m) { return (tiling == m);})
+                != tile_configs.end();
+            if (!is_duplicate) {
+                tile_configs.push_back(tiling);
+            }
+        }
+    }
+
     // Reorder tile configurations
     for (int i = 0; i < (1 << (tile_vars.size())); i++) {
         map<string, Expr> tiling;
@@ -1560,34 +2234,83 @@ vector<map<string, Expr>> Partitioner::generate_tile_configs(const FStage &stg)
     return tile_configs;
 }
 
-pair<map<string, Expr>, Partitioner::GroupAnalysis>
-Partitioner::find_best_tile_config(const Group &g) {
+vector<string> Partitioner::sliding_candidates(const Group &g,
+                                               const map<string, Expr> &tile_sizes) {
+    vector<string> vars;
+    if ((g.output.stage_num > 0) || g.output.func.has_extern_definition()) {
+        return vars;
+    }
+
+    // Sliding window needs members stored outside of their compute level.
+    // Only pure members without update definitions are considered.
+    bool has_stored_members = false;
+    for (const FStage &mem : g.members) {
+        if ((g.inlined.find(mem.func.name()) != g.inlined.end()) ||
+            (mem.func.name() == g.output.func.name())) {
+            continue;
+        }
+        if (!mem.func.updates().empty() || mem.func.has_extern_definition()) {
+            return vars;
+        }
+        has_stored_members = true;
+    }
+    if (!has_stored_members) {
+        return vars;
+    }
+
+    // The members can slide along any pure dimension which is tiled.
+    map<string, Expr> stg_estimates = bounds_to_estimates(get_bounds(g.output));
+    for (const auto &tile : tile_sizes) {
+        if (!g.output.func.is_pure_arg(tile.first)) {
+            continue;
+        }
+        const auto &iter = stg_estimates.find(tile.first);
+        if ((iter != stg_estimates.end()) && iter->second.defined() &&
+            can_prove(iter->second > tile.second)) {
+            vars.push_back(tile.first);
+        }
+    }
+    return vars;
+}
+
+Partitioner::GroupConfig Partitioner::find_best_tile_config(const Group &g) {
     // Initialize to no tiling
     map<string, Expr> no_tile_config;
     Group no_tile = g;
     no_tile.tile_sizes = no_tile_config;
+    no_tile.sliding_var = "";
 
     bool show_analysis = false;
     GroupAnalysis no_tile_analysis = analyze_group(no_tile, show_analysis);
 
-    GroupAnalysis best_analysis = no_tile_analysis;
-    map<string, Expr> best_config = no_tile_config;
-    if (!best_analysis.cost.defined()) {
-        return make_pair(best_config, best_analysis);
+    GroupConfig best(no_tile_config, no_tile_analysis);
+    if (!best.analysis.cost.defined()) {
+        return best;
     }
 
-    // Generate tiling configurations
-    vector<map<string, Expr>> configs = generate_tile_configs(g.output);
+    // Generate tiling configurations, and the ones sliding along each of the
+    // tiled dimensions.
+    vector<GroupConfig> configs;
+    for (const auto &tile_sizes : generate_tile_configs(g.output)) {
+        configs.push_back(GroupConfig(tile_sizes, GroupAnalysis()));
+        for (const string &var : sliding_candidates(g, tile_sizes)) {
+            configs.push_back(GroupConfig(tile_sizes, GroupAnalysis(), var));
+        }
+    }
 
-    Group best_group = g;
-    for (const auto &config : configs) {
+    // Analyze the configurations in parallel, then pick the best one in order.
+    parallel_for(configs.size(), [&](int i) {
         Group new_group = g;
-        new_group.tile_sizes = config;
+        new_group.tile_sizes = configs[i].tile_sizes;
+        new_group.sliding_var = configs[i].sliding_var;
+        configs[i].analysis = analyze_group(new_group, show_analysis);
+    });
 
-        GroupAnalysis new_analysis = analyze_group(new_group, show_analysis);
+    for (const auto &config : configs) {
+        const GroupAnalysis &new_analysis = config.analysis;
 
         bool no_redundant_work = false;
-        Expr benefit = estimate_benefit(best_analysis, new_analysis,
+        Expr benefit = estimate_benefit(best.analysis, new_analysis,
                                         no_redundant_work, true);
 
         if (show_analysis) {
@@ -1600,18 +2323,65 @@ Partitioner::find_best_tile_config(const Group &g) {
         }
 
         if (benefit.defined() && can_prove(benefit > 0)) {
-            best_config = config;
-            best_analysis = new_analysis;
-            best_group = new_group;
+            best = config;
+        }
+    }
+
+    return best;
+}
+
+vector<Partitioner::GroupConfig> Partitioner::rank_tile_configs(const Group &g) {
+    GroupConfig best = find_best_tile_config(g);
+    vector<GroupConfig> ranked = {best};
+    if (!best.analysis.cost.defined()) {
+        return ranked;
+    }
+
+    vector<GroupConfig> configs;
+    vector<map<string, Expr>> tile_configs = generate_tile_configs(g.output);
+    // No tiling is also a candidate.
+    tile_configs.push_back(map<string, Expr>());
+    for (const auto &tile_sizes : tile_configs) {
+        configs.push_back(GroupConfig(tile_sizes, GroupAnalysis()));
+        for (const string &var : sliding_candidates(g, tile_sizes)) {
+            configs.push_back(GroupConfig(tile_sizes, GroupAnalysis(), var));
         }
     }
 
-    return make_pair(best_config, best_analysis);
+    parallel_for(configs.size(), [&](int i) {
+        Group new_group = g;
+        new_group.tile_sizes = configs[i].tile_sizes;
+        new_group.sliding_var = configs[i].sliding_var;
+        configs[i].analysis = analyze_group(new_group, false);
+    });
+
+    vector<pair<int64_t, GroupConfig>> others;
+    for (const auto &config : configs) {
+        if ((config.tile_sizes == best.tile_sizes) &&
+            (config.sliding_var == best.sliding_var)) {
+            continue;
+        }
+        Expr benefit = estimate_benefit(best.analysis, config.analysis, false, true);
+        const int64_t *b = benefit.defined() ? as_const_int(benefit) : nullptr;
+        if (b) {
+            others.push_back(make_pair(*b, config));
+        }
+    }
+    std::stable_sort(others.begin(), others.end(),
+                     [](const pair<int64_t, GroupConfig> &a,
+                        const pair<int64_t, GroupConfig> &b) {
+                         return a.first > b.first;
+                     });
+    for (const auto &o : others) {
+        ranked.push_back(o.second);
+    }
+    return ranked;
 }
 
-void Partitioner::group(Partitioner::Level level) {
+int Partitioner::group(Partitioner::Level level, int max_merges) {
+    int merges = 0;
     bool fixpoint = false;
-    while (!fixpoint) {
+    while (!fixpoint && (max_merges < 0 || merges < max_merges)) {
         Cost pre_merge = get_pipeline_cost();
 
         fixpoint = true;
@@ -1703,6 +2473,7 @@ void Partitioner::group(Partitioner::Level level) {
             internal_assert(group.first.prod == prod);
             merge_groups(group.first, group.second, level);
         }
+        merges++;
 
         for (size_t s = 0; s < num_stages; s++) {
             FStage prod_group(prod_f, s);
@@ -1732,6 +2503,7 @@ void Partitioner::group(Partitioner::Level level) {
             disp_pipeline_costs();
         }
     }
+    return merges;
 }
 
 DimBounds Partitioner::get_bounds(const FStage &s) {
@@ -1779,6 +2551,28 @@ DimBounds Partitioner::get_bounds_from_tile_sizes(const FStage &s,
 }
 
 Partitioner::GroupAnalysis Partitioner::analyze_group(const Group &g, bool show_analysis) {
+    if (!g.sliding_var.empty()) {
+        // With sliding window, each value of the members is computed once
+        // along the sliding dimension, as if that dimension was not tiled.
+        // Storage folding keeps the footprint of a tile, and the tiles along
+        // the sliding dimension must be computed serially.
+        Group tiled = g;
+        tiled.sliding_var = "";
+        GroupAnalysis tiled_analysis = analyze_group(tiled, show_analysis);
+
+        Group untiled = tiled;
+        untiled.tile_sizes.erase(g.sliding_var);
+        GroupAnalysis untiled_analysis = analyze_group(untiled, show_analysis);
+
+        if (!tiled_analysis.defined() || !untiled_analysis.defined()) {
+            return GroupAnalysis();
+        }
+        GroupAnalysis analysis(Cost(untiled_analysis.cost.arith, tiled_analysis.cost.memory),
+                               untiled_analysis.parallelism);
+        analysis.simplify();
+        return analysis;
+    }
+
     set<string> group_inputs;
     set<string> group_members;
 
@@ -1835,10 +2629,12 @@ Partitioner::GroupAnalysis Partitioner::analyze_group(const Group &g, bool show_
     DimBounds tile_bounds = get_bounds_from_tile_sizes(g.output, g.tile_sizes);
 
     map<string, Box> alloc_regions = dep_analysis.regions_required(
-        g.output.func, g.output.stage_num, tile_bounds, group_members, false, &costs.input_estimates);
+        g.output.func, g.output.stage_num, tile_bounds, group_members, false, &costs.input_estimates,
+        estimates_key);
 
     map<string, Box> compute_regions = dep_analysis.regions_required(
-        g.output.func, g.output.stage_num, tile_bounds, group_members, true, &costs.input_estimates);
+        g.output.func, g.output.stage_num, tile_bounds, group_members, true, &costs.input_estimates,
+        estimates_key);
 
     map<string, Box> group_reg, prod_reg, input_reg;
 
@@ -1923,21 +2719,15 @@ Partitioner::GroupAnalysis Partitioner::analyze_group(const Group &g, bool show_
                                      tile_cost.second);
     }*/
 
-    // TODO: Use smooth step curve from Jon to better model cache behavior,
-    // where each step corresponds to different cache level.
-    //
-    // The current cost model drops off linearly. Larger memory footprint is
-    // penalized more than smaller memory footprint (since smaller one can fit
-    // more in the cache). The cost is clamped at 'balance', which is roughly at
-    // memory footprint equal to or larger than the last level cache size.
+    // The cost of a load increases with the memory footprint. Larger memory
+    // footprint is penalized more than smaller memory footprint (since smaller
+    // one can fit more in the cache). See 'load_cost_factor'.
 
     // If 'model_reuse' is set, the cost model should take into account memory
     // reuse within the tile, e.g. matrix multiply reuses inputs multiple times.
     // TODO: Implement a better reuse model.
     bool model_reuse = false;
 
-    // Linear dropoff
-    Expr load_slope = cast<float>(arch_params.balance) / arch_params.last_level_cache_size;
     for (const auto &f_load : group_load_costs) {
         internal_assert(g.inlined.find(f_load.first) == g.inlined.end())
             << "Intermediates of inlined pure fuction \"" << f_load.first
@@ -1979,8 +2769,7 @@ Partitioner::GroupAnalysis Partitioner::analyze_group(const Group &g, bool show_
             }
 
             if (model_reuse) {
-                Expr initial_factor =
-                    cast<int64_t>(min(1 + initial_footprint * load_slope, arch_params.balance));
+                Expr initial_factor = load_cost_factor(initial_footprint);
                 per_tile_cost.memory += initial_factor * footprint;
             } else {
                 footprint = initial_footprint;
@@ -1991,7 +2780,7 @@ Partitioner::GroupAnalysis Partitioner::analyze_group(const Group &g, bool show_
             }
         }
 
-        Expr cost_factor = cast<int64_t>(min(1 + footprint * load_slope, arch_params.balance));
+        Expr cost_factor = load_cost_factor(footprint);
         per_tile_cost.memory += cost_factor * f_load.second;
     }
 
@@ -2063,6 +2852,7 @@ void Partitioner::merge_groups(const GroupingChoice &choice, const GroupConfig &
     }
 
     child_group.tile_sizes = eval.tile_sizes;
+    child_group.sliding_var = eval.sliding_var;
 
     // Update group costs.
     // We could just reuse the analysis from 'eval' since it was computed
@@ -2091,6 +2881,7 @@ Partitioner::GroupConfig Partitioner::evaluate_choice(const GroupingChoice &choi
 
     GroupAnalysis group_analysis;
     map<string, Expr> best_tile_config;
+    string sliding_var;
 
     if (level == Partitioner::Level::Inline) {
         // Set the tile sizes to one along all dimensions of the consumer group
@@ -2104,6 +2895,7 @@ Partitioner::GroupConfig Partitioner::evaluate_choice(const GroupingChoice &choi
         }
 
         group.tile_sizes = tile_sizes;
+        group.sliding_var = "";
 
         for (const auto &prod_g : prod_groups) {
             for (const FStage &s : prod_g.members) {
@@ -2119,12 +2911,13 @@ Partitioner::GroupConfig Partitioner::evaluate_choice(const GroupingChoice &choi
         best_tile_config = tile_sizes;
 
     } else {
-        pair<map<string, Expr>, GroupAnalysis> config = find_best_tile_config(group);
-        best_tile_config = config.first;
-        group_analysis = config.second;
+        GroupConfig config = find_best_tile_config(group);
+        best_tile_config = config.tile_sizes;
+        group_analysis = config.analysis;
+        sliding_var = config.sliding_var;
     }
 
-    return GroupConfig(best_tile_config, group_analysis);
+    return GroupConfig(best_tile_config, group_analysis, sliding_var);
 }
 
 Expr Partitioner::estimate_benefit(const GroupAnalysis &old_grouping,
@@ -2204,6 +2997,59 @@ Expr Partitioner::estimate_benefit(
                             no_redundant_work, ensure_parallelism);
 }
 
+Expr Partitioner::load_cost_factor(const Expr &footprint) {
+    // The cost is piecewise linear in the footprint: it is 1 for an empty
+    // footprint, and reaches the cost of a load from the next level of the
+    // memory hierarchy when the footprint is the size of a cache. It is
+    // clamped at 'balance', which is roughly at memory footprint equal to or
+    // larger than the last level cache size. Without the sizes of the L1 and
+    // L2 caches, this is a linear dropoff to the last level cache.
+    Expr balance = cast<float>(arch_params.balance);
+    Expr llc_slope = balance / arch_params.last_level_cache_size;
+
+    // The cost of a load from a level with the given bandwidth. It is the
+    // ratio to the bandwidth of the L1 cache, where a load costs 1, or if
+    // that is unknown, the ratio to the bandwidth of main memory, where a
+    // load costs 'balance'. Unknown bandwidths are interpolated from the
+    // linear dropoff.
+    auto level_cost = [&](const Expr &bandwidth, const Expr &size) {
+        if (!is_zero(bandwidth) && !is_zero(arch_params.l1_bandwidth)) {
+            return clamp(cast<float>(arch_params.l1_bandwidth) / cast<float>(bandwidth), 1.0f, balance);
+        }
+        if (!is_zero(bandwidth) && !is_zero(arch_params.memory_bandwidth)) {
+            return clamp(balance * arch_params.memory_bandwidth / cast<float>(bandwidth), 1.0f, balance);
+        }
+        return min(1 + cast<float>(size) * llc_slope, balance);
+    };
+
+    vector<pair<Expr, Expr>> points = {{0, 1.0f}};
+    if (!is_zero(arch_params.l1_cache_size)) {
+        Expr next_bandwidth = is_zero(arch_params.l2_cache_size) ?
+            arch_params.last_level_cache_bandwidth : arch_params.l2_bandwidth;
+        points.push_back({arch_params.l1_cache_size,
+                          level_cost(next_bandwidth, arch_params.l1_cache_size)});
+    }
+    if (!is_zero(arch_params.l2_cache_size)) {
+        points.push_back({arch_params.l2_cache_size,
+                          level_cost(arch_params.last_level_cache_bandwidth,
+                                     arch_params.l2_cache_size)});
+    }
+    if (points.size() == 1) {
+        // Linear dropoff
+        return cast<int64_t>(min(1 + footprint * llc_slope, arch_params.balance));
+    }
+    points.push_back({arch_params.last_level_cache_size, balance});
+
+    Expr f = cast<float>(footprint);
+    Expr cost = balance;
+    for (size_t i = points.size() - 1; i > 0; i--) {
+        Expr x0 = cast<float>(points[i - 1].first), y0 = points[i - 1].second;
+        Expr x1 = cast<float>(points[i].first), y1 = points[i].second;
+        cost = select(f < x1, y0 + (f - x0) * (y1 - y0) / (x1 - x0), cost);
+    }
+    return cast<int64_t>(cost);
+}
+
 map<string, Expr> Partitioner::bounds_to_estimates(const DimBounds &bounds) {
     map<string, Expr> estimates;
     for (const auto &bound : bounds) {
@@ -2225,7 +3071,8 @@ map<FStage, map<string, Box>> Partitioner::group_storage_bounds() {
 
         map<string, Box> reg_alloc =
             dep_analysis.regions_required(g.output.func, g.output.stage_num,
-                                          bounds, prods, false, &costs.input_estimates);
+                                          bounds, prods, false, &costs.input_estimates,
+                                          estimates_key);
         map<string, Box> group_alloc;
         for (const FStage &s : g.members) {
             const auto &iter = reg_alloc.find(s.func.name());
@@ -2255,7 +3102,8 @@ map<FStage, map<FStage, DimBounds>> Partitioner::group_loop_bounds() {
 
         map<string, Box> reg_computed =
             dep_analysis.regions_required(g.output.func, g.output.stage_num,
-                                          bounds, prods, true, &costs.input_estimates);
+                                          bounds, prods, true, &costs.input_estimates,
+                                          estimates_key);
 
         for (const FStage &s : g.members) {
             const auto &iter = reg_computed.find(s.func.name());
@@ -2426,7 +3274,8 @@ pair<VarOrRVar, VarOrRVar> Partitioner::split_dim(
 void Partitioner::vectorize_stage(const Group &g, Stage f_handle, int stage_num,
                                   Definition def, Function func, bool is_group_output,
                                   const Target &t, set<string> &rvars,
-                                  map<string, Expr> &estimates, AutoSchedule &sched) {
+                                  map<string, Expr> &estimates, const set<string> &inlines,
+                                  AutoSchedule &sched) {
     vector<Dim> &dims = def.schedule().dims();
     int vec_dim_index = -1;
 
@@ -2437,6 +3286,20 @@ void Partitioner::vectorize_stage(const Group &g, Stage f_handle, int stage_num,
         vec_len = std::max(vec_len, t.natural_vector_size(type));
     }
 
+    // Wider vectors amortize the loop overhead and expose more instruction
+    // level parallelism, at the cost of more live registers per point. Use
+    // up to four native vectors when the stage does little work per point.
+    int vec_factor = 1;
+    {
+        Cost cost = costs.get_func_stage_cost(func, stage_num, inlines);
+        const int64_t *arith = cost.defined() ? as_const_int(simplify(cost.arith)) : nullptr;
+        if (arith && (*arith <= 4)) {
+            vec_factor = 4;
+        } else if (arith && (*arith <= 16)) {
+            vec_factor = 2;
+        }
+    }
+
     for (int d = 0; d < (int) dims.size() - 1; d++) {
         string dim_name = get_base_name(dims[d].var);
         bool can_vectorize = true;
@@ -2457,10 +3320,16 @@ void Partitioner::vectorize_stage(const Group &g, Stage f_handle, int stage_num,
         bool is_rvar = (rvars.find(vec_dim_name) != rvars.end());
         internal_assert(is_rvar == dims[vec_dim_index].is_rvar());
 
+        // Only widen the vectors if the dimension still has a few of them.
+        const Expr &extent = get_element(estimates, vec_dim_name);
+        while ((vec_factor > 1) && !can_prove(extent >= 2 * vec_factor * vec_len)) {
+            vec_factor /= 2;
+        }
+
         VarOrRVar vec_var(vec_dim_name, is_rvar);
         pair<VarOrRVar, VarOrRVar> split_vars =
-            split_dim(g, f_handle, stage_num, def, is_group_output, vec_var, vec_len,
-                      "_vi", "_vo", estimates, sched);
+            split_dim(g, f_handle, stage_num, def, is_group_output, vec_var,
+                      vec_factor * vec_len, "_vi", "_vo", estimates, sched);
 
         f_handle.vectorize(split_vars.first);
         sched.push_schedule(f_handle.name(), stage_num,
@@ -2484,10 +3353,266 @@ void Partitioner::vectorize_stage(const Group &g, Stage f_handle, int stage_num,
     }
 }
 
-// Return true if the vars/rvars in 'ordering' are in the same order as the
-// dim list.
-inline bool operator==(const vector<Dim> &dims, const vector<VarOrRVar> &ordering) {
-    if (dims.size() != ordering.size() + 1) { // The dim list also contains '__outermost'
+bool Partitioner::rfactor_group_output(const Group &g, Stage f_handle, Definition def,
+                                       map<string, Expr> &estimates, AutoSchedule &sched) {
+    Function g_out = g.output.func;
+    const int64_t *par = as_const_int(simplify(arch_params.parallelism));
+    if (!par || (*par <= 1)) {
+        return false;
+    }
+
+    // A stage with specializations cannot be rfactored.
+    if (!def.specializations().empty()) {
+        return false;
+    }
+
+    // Only one update of a function is rfactored, so that the name of the
+    // intermediate is unique.
+    if (sched.rfactors.find(g_out.name() + "_intm") != sched.rfactors.end()) {
+        return false;
+    }
+
+    // The other members of the group are computed within the loops of the
+    // output stage, which would move into the intermediate.
+    for (const FStage &mem : g.members) {
+        if ((mem.func.name() != g_out.name()) &&
+            (g.inlined.find(mem.func.name()) == g.inlined.end())) {
+            return false;
+        }
+    }
+
+    // Find the parallelism available without rfactor() and the outermost
+    // RVar which carries the reduction.
+    const vector<Dim> &dims = def.schedule().dims();
+    Expr def_par = 1;
+    string rvar;
+    for (int d = 0; d < (int)dims.size() - 1; d++) {
+        string var = get_base_name(dims[d].var);
+        const auto &iter = estimates.find(var);
+        if ((iter == estimates.end()) || !iter->second.defined()) {
+            return false;
+        }
+        if (dims[d].is_rvar() && !can_parallelize_rvar(var, g_out.name(), def)) {
+            rvar = var;
+        } else {
+            def_par = simplify(def_par * iter->second);
+        }
+    }
+    if (rvar.empty() || can_prove(def_par >= arch_params.parallelism)) {
+        return false;
+    }
+
+    if (!prove_associativity(g_out.name(), def.args(), def.values()).associative()) {
+        return false;
+    }
+
+    // Split the RVar into one chunk per core, as long as the chunks are
+    // still large enough to amortize the merge of the partial results.
+    const int64_t min_chunk_size = 16;
+    const int64_t *extent = as_const_int(simplify(get_element(estimates, rvar)));
+    if (!extent || (*extent < *par * min_chunk_size)) {
+        return false;
+    }
+    int factor = (int)((*extent + *par - 1) / *par);
+
+    // The schedule string starts from the RVars of the unscheduled stage.
+    vector<ReductionVariable> rvars = def.schedule().rvars();
+
+    pair<VarOrRVar, VarOrRVar> split_vars =
+        split_dim(g, f_handle, g.output.stage_num, def, true, VarOrRVar(rvar, true),
+                  factor, "_i", "_o", estimates, sched);
+
+    Var u(rvar + "_u");
+    sched.internal_vars.emplace(u.name(), VarOrRVar(u));
+
+    Func intm = f_handle.rfactor(split_vars.second.rvar, u);
+    sched.push_rfactor(f_handle.name(), g.output.stage_num, intm.name(),
+                       "rfactor(" + split_vars.second.name() + ", " + u.name() + ")", rvars);
+
+    intm.compute_root().parallel(u);
+    sched.push_schedule(intm.name(), 0, "compute_root()", {});
+    sched.push_schedule(intm.name(), 0, "parallel(" + u.name() + ")", {u.name()});
+
+    // Make the chunks the outermost loop of the partial reductions.
+    Stage intm_update = intm.update(0);
+    const vector<Dim> &intm_dims = intm.function().update(0).schedule().dims();
+    vector<VarOrRVar> ordering;
+    set<string> var_list;
+    string var_order;
+    for (int d = 0; d < (int)intm_dims.size() - 1; d++) {
+        if (!intm_dims[d].is_rvar() && (intm_dims[d].var != u.name())) {
+            ordering.push_back(Var(intm_dims[d].var));
+            var_list.insert(intm_dims[d].var);
+            var_order += intm_dims[d].var + ", ";
+        }
+    }
+    if (!ordering.empty()) {
+        ordering.push_back(u);
+        var_list.insert(u.name());
+        intm_update.reorder(ordering);
+        sched.push_schedule(intm_update.name(), 1, "reorder(" + var_order + u.name() + ")", var_list);
+    }
+    intm_update.parallel(u);
+    sched.push_schedule(intm_update.name(), 1, "parallel(" + u.name() + ")", {u.name()});
+
+    return true;
+}
+
+void Partitioner::unroll_stage(const Group &g, Stage f_handle, int stage_num,
+                               Definition def, Function func, bool is_group_output,
+                               set<string> &rvars, map<string, Expr> &estimates,
+                               const set<string> &inlines, AutoSchedule &sched) {
+    // Bound on the arithmetic cost of the unrolled body, to keep it within
+    // the instruction cache and the registers.
+    const int64_t max_unrolled_cost = 64;
+    const int64_t max_full_unroll = 16;
+
+    vector<Dim> &dims = def.schedule().dims();
+    if ((dims.size() < 2) || !dims[0].is_rvar() || (dims[0].for_type != ForType::Serial)) {
+        return;
+    }
+
+    // Use the extent of the RVar itself rather than its estimate, so that
+    // partial unrolling never needs a tail.
+    string var = get_base_name(dims[0].var);
+    const int64_t *extent = nullptr;
+    for (const ReductionVariable &rv : def.schedule().rvars()) {
+        if (rv.var == var) {
+            extent = as_const_int(simplify(rv.extent));
+        }
+    }
+    if (!extent || (*extent < 2)) {
+        return;
+    }
+
+    Cost cost = costs.get_func_stage_cost(func, stage_num, inlines);
+    const int64_t *arith = cost.defined() ? as_const_int(simplify(cost.arith)) : nullptr;
+    int64_t body_cost = arith ? std::max(*arith, (int64_t)1) : max_unrolled_cost;
+
+    VarOrRVar v(var, true);
+    if ((*extent <= max_full_unroll) && (*extent * body_cost <= max_unrolled_cost)) {
+        f_handle.unroll(v);
+        sched.push_schedule(f_handle.name(), stage_num, "unroll(" + var + ")", {var});
+        return;
+    }
+
+    for (int factor = 8; factor >= 2; factor /= 2) {
+        if ((*extent % factor == 0) && (*extent >= 2 * factor) &&
+            (factor * body_cost <= max_unrolled_cost)) {
+            pair<VarOrRVar, VarOrRVar> split_vars =
+                split_dim(g, f_handle, stage_num, def, is_group_output, v, factor,
+                          "_ui", "_uo", estimates, sched);
+            f_handle.unroll(split_vars.first);
+            sched.push_schedule(f_handle.name(), stage_num,
+                                "unroll(" + split_vars.first.name() + ")",
+                                {split_vars.first.name()});
+            rvars.erase(var);
+            rvars.insert(split_vars.first.name());
+            rvars.insert(split_vars.second.name());
+            return;
+        }
+    }
+}
+
+// Find all the input images accessed by an expression.
+class FindInputImages : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Call *call) override {
+        if ((call->call_type == Call::Image) && call->param.defined()) {
+            images.emplace(call->name, call->param);
+        }
+        IRVisitor::visit(call);
+    }
+public:
+    map<string, Parameter> images;
+};
+
+void Partitioner::prefetch_inputs(const Group &g, Stage f_handle, Definition def,
+                                  const Target &t, const map<string, Expr> &estimates,
+                                  const set<string> &inlines, AutoSchedule &sched) {
+    const int64_t max_prefetch_distance = 8;
+    const int64_t cache_line_size = 64;
+
+    FindInputImages find;
+    for (const auto &val : def.values()) {
+        perform_inline(val, dep_analysis.env, inlines).accept(&find);
+    }
+    for (const auto &arg : def.args()) {
+        perform_inline(arg, dep_analysis.env, inlines).accept(&find);
+    }
+
+    // Only the images which do not fit in the last level cache are streamed
+    // from memory.
+    vector<Parameter> streaming;
+    int bytes_per_point = 0;
+    for (const auto &image : find.images) {
+        const Parameter &param = image.second;
+        Expr size = make_const(Int(64), param.type().bytes());
+        for (int i = 0; i < param.dimensions(); i++) {
+            string extent_var = param.name() + ".extent." + std::to_string(i);
+            if (!costs.input_estimates.contains(extent_var)) {
+                size = Expr();
+                break;
+            }
+            size *= cast<int64_t>(costs.input_estimates.get(extent_var).max);
+        }
+        if (size.defined() && can_prove(size > arch_params.last_level_cache_size)) {
+            streaming.push_back(param);
+            bytes_per_point = std::max(bytes_per_point, param.type().bytes());
+        }
+    }
+    if (streaming.empty()) {
+        return;
+    }
+
+    Cost cost = costs.get_func_stage_cost(g.output.func, g.output.stage_num, inlines);
+    const int64_t *arith = cost.defined() ? as_const_int(simplify(cost.arith)) : nullptr;
+    const int64_t *memory = cost.defined() ? as_const_int(simplify(cost.memory)) : nullptr;
+    const int64_t *balance = as_const_int(simplify(arch_params.balance));
+    if (!arith || !memory || !balance) {
+        return;
+    }
+
+    const vector<Dim> &dims = def.schedule().dims();
+    int64_t points = 1;
+    for (int d = 0; d < (int)dims.size() - 1; d++) {
+        string var = get_base_name(dims[d].var);
+        const auto &iter = estimates.find(var);
+        const int64_t *extent = nullptr;
+        if ((iter != estimates.end()) && iter->second.defined()) {
+            extent = as_const_int(simplify(iter->second));
+        }
+        if (!extent || (dims[d].for_type == ForType::Parallel)) {
+            return;
+        }
+        if ((d > 0) && (dims[d].for_type == ForType::Serial) && (*extent > 1) &&
+            (points * bytes_per_point >= cache_line_size)) {
+            // A load from memory costs about 'balance' per byte of the cache
+            // line; prefetch far enough ahead to cover it.
+            int64_t iteration_cost = std::max(points * (*arith + *memory), (int64_t)1);
+            int64_t distance = (cache_line_size * (*balance) + iteration_cost - 1) / iteration_cost;
+            distance = std::min(std::max(distance, (int64_t)1),
+                                std::min(max_prefetch_distance, *extent - 1));
+
+            VarOrRVar v(var, dims[d].is_rvar());
+            for (const Parameter &param : streaming) {
+                f_handle.prefetch(param, v, (int)distance);
+                sched.push_schedule(f_handle.name(), g.output.stage_num,
+                                    "prefetch(" + sched.get_input_handle(param.name()) + ", " +
+                                    var + ", " + std::to_string(distance) + ")",
+                                    {var});
+            }
+            return;
+        }
+        points *= *extent;
+    }
+}
+
+// Return true if the vars/rvars in 'ordering' are in the same order as the
+// dim list.
+inline bool operator==(const vector<Dim> &dims, const vector<VarOrRVar> &ordering) {
+    if (dims.size() != ordering.size() + 1) { // The dim list also contains '__outermost'
         return false;
     }
     for (size_t i = 0; i < ordering.size(); ++i) {
@@ -2629,7 +3754,8 @@ void Partitioner::generate_group_cpu_schedule(
         const map<FStage, DimBounds> &group_loop_bounds,
         const map<string, Box> &group_storage_bounds,
         const set<string> &inlines,
-        AutoSchedule &sched) {
+        AutoSchedule &sched,
+        const Expr &specialization) {
     string out_f_name = g.output.func.name();
     Function g_out = g.output.func;
 
@@ -2655,7 +3781,7 @@ void Partitioner::generate_group_cpu_schedule(
     if (g.output.stage_num > 0) {
         int stage_num = g.output.stage_num;
         f_handle = Func(g_out).update(stage_num - 1);
-    } else {
+    } else if (!specialization.defined()) {
         Func(g_out).compute_root();
         sched.push_schedule(f_handle.name(), g.output.stage_num, "compute_root()", {});
     }
@@ -2667,6 +3793,22 @@ void Partitioner::generate_group_cpu_schedule(
     // Get the definition corresponding to the stage
     Definition def = get_stage_definition(g_out, g.output.stage_num);
 
+    if (specialization.defined()) {
+        f_handle = f_handle.specialize(specialization);
+        for (const Specialization &s : def.specializations()) {
+            if (equal(s.condition, specialization)) {
+                def = s.definition;
+            }
+        }
+    }
+
+    // Large associative reductions without enough pure parallelism are
+    // computed in parallel chunks by an rfactor() intermediate instead.
+    if ((g.output.stage_num > 0) && !specialization.defined() &&
+        rfactor_group_output(g, f_handle, def, stg_estimates, sched)) {
+        return;
+    }
+
     // 'dims' will get modified since we are going to apply the schedules
     // (e.g. tiling, reordering, etc.)
     vector<Dim> &dims = def.schedule().dims();
@@ -2726,6 +3868,22 @@ void Partitioner::generate_group_cpu_schedule(
         }
     }
 
+    // The members are computed at the innermost tile loop. When they slide,
+    // that loop must be the one along the sliding dimension.
+    string sliding_loop;
+    if (!g.sliding_var.empty()) {
+        for (size_t i = 0; i < outer_dims.size(); i++) {
+            string name = outer_dims[i].name();
+            if ((name == g.sliding_var) || (name == g.sliding_var + "_o")) {
+                sliding_loop = name;
+                VarOrRVar v = outer_dims[i];
+                outer_dims.erase(outer_dims.begin() + i);
+                outer_dims.insert(outer_dims.begin(), v);
+                break;
+            }
+        }
+    }
+
     // Reorder the tile dimensions
     if (!outer_dims.empty()) {
 
@@ -2752,7 +3910,10 @@ void Partitioner::generate_group_cpu_schedule(
     }
 
     vectorize_stage(g, f_handle, g.output.stage_num, def, g_out, true, t,
-                    rvars, stg_estimates, sched);
+                    rvars, stg_estimates, inlines, sched);
+
+    unroll_stage(g, f_handle, g.output.stage_num, def, g_out, true, rvars,
+                 stg_estimates, inlines, sched);
 
     // Parallelize definition
     Expr def_par = 1;
@@ -2773,6 +3934,10 @@ void Partitioner::generate_group_cpu_schedule(
             }
 
             string var = get_base_name(dims[d].var);
+            if (var == sliding_loop) {
+                // Sliding window requires the loop to be serial.
+                break;
+            }
             bool is_rvar = (rvars.find(var) != rvars.end());
             internal_assert(is_rvar == dims[d].is_rvar());
             VarOrRVar v(var, is_rvar);
@@ -2812,6 +3977,8 @@ void Partitioner::generate_group_cpu_schedule(
         user_warning << "Insufficient parallelism for " << f_handle.name() << '\n';
     }
 
+    prefetch_inputs(g, f_handle, def, t, stg_estimates, inlines, sched);
+
     // Find the level at which group members will be computed.
     int tile_inner_index = dims.size() - outer_dims.size() - 1;
     VarOrRVar tile_inner_var("", false);
@@ -2821,6 +3988,16 @@ void Partitioner::generate_group_cpu_schedule(
         tile_inner_var = VarOrRVar(var_name, is_rvar);
     }
 
+    // When sliding, the members are stored at the next tile loop out, or at
+    // root if there is none.
+    bool sliding = !sliding_loop.empty() && (tile_inner_var.name() == sliding_loop);
+    VarOrRVar tile_store_var("", false);
+    if (sliding && (tile_inner_index + 1 < (int)dims.size() - 1)) {
+        string var_name = get_base_name(dims[tile_inner_index + 1].var);
+        bool is_rvar = (rvars.find(var_name) != rvars.end());
+        tile_store_var = VarOrRVar(var_name, is_rvar);
+    }
+
     for (const FStage &mem : g.members) {
         // Skip member stages that have been inlined or stage that is the
         // output stage of the group
@@ -2860,6 +4037,41 @@ void Partitioner::generate_group_cpu_schedule(
                 sched.push_schedule(mem_handle.name(), mem.stage_num,
                                     "compute_at(" + sanitized_g_out + ", " + tile_inner_var.name() + ")",
                                     {sanitized_g_out, tile_inner_var.name()});
+
+                if (sliding) {
+                    if (tile_store_var.name().empty()) {
+                        Func(mem.func).store_root();
+                        sched.push_schedule(mem_handle.name(), mem.stage_num, "store_root()", {});
+                    } else {
+                        if (tile_store_var.is_rvar) {
+                            Func(mem.func).store_at(Func(g_out), tile_store_var.rvar);
+                        } else {
+                            Func(mem.func).store_at(Func(g_out), tile_store_var.var);
+                        }
+                        sched.push_schedule(mem_handle.name(), mem.stage_num,
+                                            "store_at(" + sanitized_g_out + ", " + tile_store_var.name() + ")",
+                                            {sanitized_g_out, tile_store_var.name()});
+                    }
+
+                    // Fold the storage along the sliding dimension to the
+                    // footprint of a tile, if the member has that dimension.
+                    const auto &iter = mem_estimates.find(g.sliding_var);
+                    const int64_t *extent = nullptr;
+                    if (mem.func.is_pure_arg(g.sliding_var) && (iter != mem_estimates.end()) &&
+                        iter->second.defined()) {
+                        extent = as_const_int(simplify(iter->second));
+                    }
+                    if (extent && (*extent > 0)) {
+                        int64_t factor = 1;
+                        while (factor < *extent) {
+                            factor *= 2;
+                        }
+                        Func(mem.func).fold_storage(Var(g.sliding_var), (int)factor);
+                        sched.push_schedule(mem_handle.name(), mem.stage_num,
+                                            "fold_storage(" + g.sliding_var + ", " + std::to_string(factor) + ")",
+                                            {g.sliding_var});
+                    }
+                }
             } else {
                 user_warning << "Degenerate tiling. No dimensions are tiled" << '\n';
                 user_warning << "Computing \"" <<  mem.func.name() << "\" at root" << '\n';
@@ -2879,7 +4091,10 @@ void Partitioner::generate_group_cpu_schedule(
         }
 
         vectorize_stage(g, mem_handle, mem.stage_num, mem_def, mem.func, false,
-                        t, mem_rvars, mem_estimates, sched);
+                        t, mem_rvars, mem_estimates, inlines, sched);
+
+        unroll_stage(g, mem_handle, mem.stage_num, mem_def, mem.func, false,
+                     mem_rvars, mem_estimates, inlines, sched);
     }
 }
 
@@ -2912,6 +4127,48 @@ void Partitioner::generate_cpu_schedule(const Target &t, AutoSchedule &sched) {
     }
 }
 
+void Partitioner::generate_specialized_cpu_schedule(const map<FStage, Group> &default_groups,
+                                                    const Target &t, const Expr &condition,
+                                                    AutoSchedule &sched) {
+    set<string> inlines;
+    for (const auto &g : default_groups) {
+        for (const string &inline_func : g.second.inlined) {
+            inlines.insert(inline_func);
+        }
+    }
+
+    groups.clear();
+    for (const auto &g : default_groups) {
+        if (g.second.output.func.has_extern_definition()) {
+            continue;
+        }
+        bool self_contained = true;
+        for (const FStage &mem : g.second.members) {
+            if ((mem.func.name() != g.second.output.func.name()) &&
+                (g.second.inlined.find(mem.func.name()) == g.second.inlined.end())) {
+                self_contained = false;
+            }
+        }
+        if (!self_contained) {
+            continue;
+        }
+        Group group = g.second;
+        GroupConfig config = find_best_tile_config(group);
+        group.tile_sizes = config.tile_sizes;
+        group.sliding_var = "";
+        groups.emplace(g.first, group);
+    }
+
+    map<FStage, map<FStage, DimBounds>> loop_bounds = group_loop_bounds();
+    map<FStage, map<string, Box>> storage_bounds = group_storage_bounds();
+
+    for (const auto &g : groups) {
+        generate_group_cpu_schedule(g.second, t, get_element(loop_bounds, g.first),
+                                    get_element(storage_bounds, g.first), inlines,
+                                    sched, condition);
+    }
+}
+
 Expr Partitioner::find_max_access_stride(const Scope<> &vars,
                                          const string &func_acc,
                                          const vector<Expr> &acc_exprs,
@@ -3311,13 +4568,291 @@ bool inline_unbounded(const vector<Function> &outputs,
     return inlined;
 }
 
-} // anonymous namespace
+// The alternatives to the cost model's choices that were available while
+// scheduling a pipeline.
+struct ScheduleAlternatives {
+    // Number of merges done when grouping for fast memory.
+    int fast_mem_merges = 0;
+    // Number of ranked tile configurations of each group, by output stage.
+    map<string, int> tile_configs;
+};
+
+// Calibrate the cost model against the time measured for the functions in
+// 'profile'. The time of a function is modeled as (alpha * arith + gamma *
+// memory), where 'arith' and 'memory' are the costs of computing it over its
+// pipeline bounds. The producers which were inlined into it when the pipeline
+// was profiled do not appear in the profile, so their costs are added to
+// it. 'alpha' and 'gamma' are fit by least squares, and the balance is set to
+// their ratio. The arithmetic cost of each function is then scaled so that
+// the model matches its measured time. Return the number of functions
+// calibrated.
+int calibrate_costs(const AutoScheduleProfile &profile,
+                    const map<string, Box> &pipeline_bounds,
+                    RegionCosts &costs, MachineParams &arch_params) {
+    struct Sample {
+        vector<string> funcs;
+        double time, arith, memory;
+    };
+    vector<Sample> samples;
+
+    for (const auto &kv : costs.env) {
+        const auto &iter = profile.funcs.find(kv.first);
+        if ((iter == profile.funcs.end()) || (iter->second.time <= 0) ||
+            kv.second.has_extern_definition()) {
+            continue;
+        }
+
+        Sample sample = {{}, iter->second.time, 0, 0};
+        vector<string> pending = {kv.first};
+        bool known = true;
+        while (!pending.empty() && known) {
+            string name = pending.back();
+            pending.pop_back();
+            if (std::find(sample.funcs.begin(), sample.funcs.end(), name) != sample.funcs.end()) {
+                continue;
+            }
+            sample.funcs.push_back(name);
+
+            const auto &bounds = pipeline_bounds.find(name);
+            if (bounds == pipeline_bounds.end()) {
+                known = false;
+                break;
+            }
+            Cost cost = costs.region_cost(name, bounds->second);
+            const int64_t *arith = cost.defined() ? as_const_int(simplify(cost.arith)) : nullptr;
+            const int64_t *memory = cost.defined() ? as_const_int(simplify(cost.memory)) : nullptr;
+            if (!arith || !memory) {
+                known = false;
+                break;
+            }
+            sample.arith += *arith;
+            sample.memory += *memory;
+
+            for (const auto &prod : find_direct_calls(get_element(costs.env, name))) {
+                if ((costs.env.find(prod.first) != costs.env.end()) &&
+                    (profile.funcs.find(prod.first) == profile.funcs.end()) &&
+                    !prod.second.has_extern_definition()) {
+                    pending.push_back(prod.first);
+                }
+            }
+        }
+        if (known && (sample.arith > 0)) {
+            samples.push_back(sample);
+        }
+    }
+
+    if (samples.empty()) {
+        return 0;
+    }
+
+    double aa = 0, am = 0, mm = 0, ta = 0, tm = 0;
+    for (const Sample &s : samples) {
+        aa += s.arith * s.arith;
+        am += s.arith * s.memory;
+        mm += s.memory * s.memory;
+        ta += s.time * s.arith;
+        tm += s.time * s.memory;
+    }
+    double alpha = 0, gamma = 0;
+    double det = aa * mm - am * am;
+    if ((samples.size() >= 2) && (det > 1e-6 * aa * mm)) {
+        alpha = (ta * mm - tm * am) / det;
+        gamma = (aa * tm - am * ta) / det;
+    }
+    if ((alpha > 0) && (gamma > 0)) {
+        arch_params.balance = (int)std::min(std::max(std::round(gamma / alpha), 1.0), 10000.0);
+    } else {
+        // The samples do not determine the balance, so keep it and only fit
+        // the overall scale.
+        const int64_t *balance = as_const_int(simplify(arch_params.balance));
+        double b = balance ? (double)*balance : 1.0;
+        double time = 0, cost = 0;
+        for (const Sample &s : samples) {
+            time += s.time;
+            cost += s.arith + b * s.memory;
+        }
+        alpha = time / cost;
+        gamma = alpha * b;
+    }
+
+    // Producers which were inlined into several consumers get the scale of
+    // the first one.
+    map<string, float> scale;
+    for (const Sample &s : samples) {
+        double factor = (s.time - gamma * s.memory) / (alpha * s.arith);
+        factor = std::min(std::max(factor, 1.0 / 16), 16.0);
+        for (const string &f : s.funcs) {
+            scale.emplace(f, (float)factor);
+        }
+    }
+    costs.calibrate(scale);
+
+    return (int)samples.size();
+}
+
+// Specialize the schedules of the group outputs in 'groups' for the estimates
+// of the size class number 'index' in 'size_classes'. This returns the string
+// representation of the condition of the specializations.
+string generate_size_class_schedule(const vector<AutoScheduleSizeClass> &size_classes, size_t index,
+                                    const vector<Function> &outputs, const Target &target,
+                                    const MachineParams &params,
+                                    DependenceAnalysis &dep_analysis, RegionCosts &costs,
+                                    const map<FStage, Partitioner::Group> &groups,
+                                    AutoSchedule &sched) {
+    const AutoScheduleSizeClass &size_class = size_classes[index];
+    FindInputImages find;
+    for (const auto &f : dep_analysis.env) {
+        f.second.accept(&find);
+    }
+
+    // Override the estimates on the inputs, and dispatch to the size class
+    // when each extent of the inputs is closer to its estimate than to the
+    // estimates of the other size classes and the default ones.
+    Expr condition;
+    string condition_str;
+    vector<string> overridden;
+    bool differs = false;
+    for (const auto &iter : find.images) {
+        const auto &est = size_class.estimates.find(iter.first);
+        if (est == size_class.estimates.end()) {
+            continue;
+        }
+        const Parameter &param = iter.second;
+        user_assert((int)est->second.size() == param.dimensions())
+            << "AutoSchedule: Size class " << index << " has estimates for "
+            << est->second.size() << " dimensions of ImageParam \"" << iter.first
+            << "\", which has " << param.dimensions() << ".\n";
+
+        for (int i = 0; i < param.dimensions(); i++) {
+            const Range &r = est->second[i];
+            const int64_t *extent = r.extent.defined() ? as_const_int(r.extent) : nullptr;
+            user_assert(r.min.defined() && extent)
+                << "AutoSchedule: Estimate of the extent of ImageParam \"" << iter.first
+                << "\" in dimension " << i << " of size class " << index
+                << " is not a constant.\n";
+
+            string min_var = param.name() + ".min." + std::to_string(i);
+            string extent_var = param.name() + ".extent." + std::to_string(i);
+
+            // Sort the extents of this dimension in the default estimates and
+            // in all the size classes. The size class owns the sizes up to
+            // halfway to its neighbours on either side.
+            vector<int64_t> extents;
+            if (costs.input_estimates.contains(extent_var)) {
+                const int64_t *e = as_const_int(costs.input_estimates.get(extent_var).max);
+                if (e) {
+                    extents.push_back(*e);
+                    differs = differs || (*e != *extent);
+                }
+            }
+            for (const auto &other : size_classes) {
+                const auto &o = other.estimates.find(iter.first);
+                if ((o == other.estimates.end()) || ((int)o->second.size() <= i)) {
+                    continue;
+                }
+                const Expr &other_extent = o->second[i].extent;
+                const int64_t *e = other_extent.defined() ? as_const_int(other_extent) : nullptr;
+                if (e && (*e != *extent)) {
+                    extents.push_back(*e);
+                }
+            }
+            std::sort(extents.begin(), extents.end());
+            auto upper = std::upper_bound(extents.begin(), extents.end(), *extent);
+            auto lower = std::lower_bound(extents.begin(), extents.end(), *extent);
+
+            Expr dim_extent = Variable::make(Int(32), extent_var, param);
+            string dim_extent_str = sched.get_input_handle(param.name()) +
+                ".dim(" + std::to_string(i) + ").extent()";
+            vector<pair<Expr, string>> bounds;
+            if (lower != extents.begin()) {
+                int mid = (int)((*(lower - 1) + *extent) / 2);
+                bounds.push_back({dim_extent > mid, dim_extent_str + " > " + std::to_string(mid)});
+            }
+            if (upper != extents.end()) {
+                int mid = (int)((*extent + *upper) / 2);
+                bounds.push_back({dim_extent <= mid, dim_extent_str + " <= " + std::to_string(mid)});
+            }
+            for (const auto &b : bounds) {
+                condition = condition.defined() ? (condition && b.first) : b.first;
+                condition_str += (condition_str.empty() ? "" : " && ") + b.second;
+            }
+
+            costs.input_estimates.push(min_var, Interval(r.min, r.min));
+            costs.input_estimates.push(extent_var, Interval(r.extent, r.extent));
+            overridden.push_back(min_var);
+            overridden.push_back(extent_var);
+        }
+    }
+    user_assert(differs && condition.defined())
+        << "AutoSchedule: The estimates of size class " << index
+        << " do not differ from the default estimates on the extent of any input ImageParam.\n";
+
+    // Override the estimates on the outputs. The most recent estimate of a
+    // dimension is used, so they are appended, and removed afterwards.
+    vector<pair<Function, size_t>> num_estimates;
+    for (Function out : outputs) {
+        const auto &est = size_class.estimates.find(out.name());
+        if (est == size_class.estimates.end()) {
+            continue;
+        }
+        user_assert(est->second.size() == out.args().size())
+            << "AutoSchedule: Size class " << index << " has estimates for "
+            << est->second.size() << " dimensions of Func \"" << out.name()
+            << "\", which has " << out.args().size() << ".\n";
+
+        vector<Bound> &estimates = out.schedule().estimates();
+        num_estimates.push_back({out, estimates.size()});
+        for (size_t i = 0; i < out.args().size(); i++) {
+            Bound b;
+            b.var = out.args()[i];
+            b.min = est->second[i].min;
+            b.extent = est->second[i].extent;
+            estimates.push_back(b);
+        }
+    }
+
+    for (const auto &est : size_class.estimates) {
+        bool is_output = false;
+        for (const Function &out : outputs) {
+            is_output = is_output || (out.name() == est.first);
+        }
+        user_assert(is_output || (find.images.find(est.first) != find.images.end()))
+            << "AutoSchedule: Size class " << index << " has estimates for \""
+            << est.first << "\", which is neither an output nor an input ImageParam "
+            << "of the pipeline.\n";
+    }
+
+    map<string, Box> pipeline_bounds =
+        get_pipeline_bounds(dep_analysis, outputs, &costs.input_estimates);
+    Partitioner part(pipeline_bounds, params, target, outputs, dep_analysis, costs);
+
+    sched.specialization = condition_str;
+    part.generate_specialized_cpu_schedule(groups, target, condition, sched);
+    sched.specialization = "";
+
+    for (auto &n : num_estimates) {
+        n.first.schedule().estimates().resize(n.second);
+    }
+    for (const string &var : overridden) {
+        costs.input_estimates.pop(var);
+    }
+
+    return condition_str;
+}
 
 // Generate schedules for all functions in the pipeline required to compute the
-// outputs. This applies the schedules and returns a string representation of
-// the schedules. The target architecture is specified by 'target'.
-string generate_schedules(const vector<Function> &outputs, const Target &target,
-                          const MachineParams &arch_params) {
+// outputs, following 'choice' where it departs from the cost model. This
+// applies the schedules and returns a string representation of the schedules.
+// The target architecture is specified by 'target'. If 'profile' is not empty,
+// the cost model is calibrated against it. The schedules are specialized for
+// each of the 'size_classes'. If 'alternatives' is not null, the alternatives
+// available are recorded in it.
+string generate_schedules_for_choice(const vector<Function> &outputs, const Target &target,
+                                     const MachineParams &arch_params,
+                                     const AutoScheduleChoice &choice,
+                                     const AutoScheduleProfile &profile,
+                                     const vector<AutoScheduleSizeClass> &size_classes,
+                                     ScheduleAlternatives *alternatives) {
     // Make an environment map which is used throughout the auto scheduling process.
     map<string, Function> env;
     for (Function f : outputs) {
@@ -3450,8 +4985,18 @@ string generate_schedules(const vector<Function> &outputs, const Target &target,
         pipeline_bounds = get_pipeline_bounds(dep_analysis, outputs, &costs.input_estimates);
     }
 
+    MachineParams params = arch_params;
+    int calibrated = 0;
+    if (!profile.empty()) {
+        debug(2) << "Calibrating costs against the profile...\n";
+        calibrated = calibrate_costs(profile, pipeline_bounds, costs, params);
+        if (debug::debug_level() >= 3) {
+            costs.disp_func_costs();
+        }
+    }
+
     debug(2) << "Initializing partitioner...\n";
-    Partitioner part(pipeline_bounds, arch_params, outputs, dep_analysis, costs);
+    Partitioner part(pipeline_bounds, params, target, outputs, dep_analysis, costs);
 
     // Compute and display reuse
     /* TODO: Use the reuse estimates to reorder loops
@@ -3491,7 +5036,33 @@ string generate_schedules(const vector<Function> &outputs, const Target &target,
 
     debug(2) << "Partitioner computing fast-mem group...\n";
     part.grouping_cache.clear();
-    part.group(Partitioner::Level::FastMem);
+    int merges = part.group(Partitioner::Level::FastMem, choice.max_fast_mem_merges);
+    if (alternatives) {
+        alternatives->fast_mem_merges = merges;
+    }
+
+    if (alternatives || !choice.tile_config_ranks.empty()) {
+        debug(2) << "Ranking tile configurations...\n";
+        for (auto &g : part.groups) {
+            std::ostringstream key;
+            key << g.first;
+            const auto &iter = choice.tile_config_ranks.find(key.str());
+            if (!alternatives && (iter == choice.tile_config_ranks.end())) {
+                continue;
+            }
+            vector<Partitioner::GroupConfig> ranked = part.rank_tile_configs(g.second);
+            if (alternatives) {
+                alternatives->tile_configs[key.str()] = (int)ranked.size();
+            }
+            if ((iter != choice.tile_config_ranks.end()) &&
+                (iter->second < (int)ranked.size())) {
+                g.second.tile_sizes = ranked[iter->second].tile_sizes;
+                g.second.sliding_var = ranked[iter->second].sliding_var;
+                part.group_costs[g.first] = ranked[iter->second].analysis;
+            }
+        }
+    }
+
     if (debug::debug_level() >= 3) {
         part.disp_pipeline_costs();
         part.disp_grouping();
@@ -3500,12 +5071,41 @@ string generate_schedules(const vector<Function> &outputs, const Target &target,
 
     debug(2) << "Initializing AutoSchedule...\n";
     AutoSchedule sched(env, full_order);
+
+    // The specializations copy the schedule of a stage, so they are created
+    // before the default schedule is applied.
+    vector<string> size_class_conditions;
+    for (size_t i = 0; i < size_classes.size(); i++) {
+        debug(2) << "Generating CPU schedule for size class " << i << "...\n";
+        size_class_conditions.push_back(
+            generate_size_class_schedule(size_classes, i, outputs, target, params,
+                                         dep_analysis, costs, part.groups, sched));
+    }
+
     debug(2) << "Generating CPU schedule...\n";
     part.generate_cpu_schedule(target, sched);
 
     std::ostringstream oss;
     oss << "// Target: " << target.to_string() << "\n";
     oss << "// MachineParams: " << arch_params.to_string() << "\n";
+    if (!profile.empty()) {
+        oss << "// Profile: " << calibrated << " Funcs calibrated, balance " << params.balance << "\n";
+    }
+    for (size_t i = 0; i < size_class_conditions.size(); i++) {
+        oss << "// Size class " << i << ": " << size_class_conditions[i] << "\n";
+    }
+    Cost cost = part.get_pipeline_cost();
+    if (cost.defined()) {
+        // Print the costs as plain numbers, so that the header is easy to
+        // parse, rather than as Int(64) constants.
+        auto cost_string = [](const Expr &e) -> string {
+            const int64_t *c = as_const_int(simplify(e));
+            return c ? std::to_string(*c) : "unknown";
+        };
+        oss << "// Estimated cost: " << cost_string(cost.arith + cost.memory)
+            << " (arith " << cost_string(cost.arith) << ", memory "
+            << cost_string(cost.memory) << ")\n";
+    }
     oss << "\n";
     oss << sched;
     string sched_string = oss.str();
@@ -3513,6 +5113,8 @@ string generate_schedules(const vector<Function> &outputs, const Target &target,
     debug(3) << "\n\n*******************************\nSchedule:\n"
              << "*******************************\n" << sched_string << "\n\n";
 
+    RegionsRequiredCache::get().save();
+
     // TODO: Unify both inlining and grouping for fast mem
     // TODO: GPU scheduling
     // TODO: Hierarchical tiling
@@ -3520,27 +5122,213 @@ string generate_schedules(const vector<Function> &outputs, const Target &target,
     return sched_string;
 }
 
+} // anonymous namespace
+
+string generate_schedules(const vector<Function> &outputs, const Target &target,
+                          const MachineParams &arch_params) {
+    return generate_schedules_for_choice(outputs, target, arch_params, AutoScheduleChoice(),
+                                         AutoScheduleProfile(), {}, nullptr);
+}
+
+string generate_schedules(const vector<Function> &outputs, const Target &target,
+                          const MachineParams &arch_params,
+                          const AutoScheduleChoice &choice) {
+    return generate_schedules_for_choice(outputs, target, arch_params, choice,
+                                         AutoScheduleProfile(), {}, nullptr);
+}
+
+string generate_schedules(const vector<Function> &outputs, const Target &target,
+                          const MachineParams &arch_params,
+                          const AutoScheduleProfile &profile) {
+    return generate_schedules_for_choice(outputs, target, arch_params,
+                                         AutoScheduleChoice(), profile, {}, nullptr);
+}
+
+string generate_schedules(const vector<Function> &outputs, const Target &target,
+                          const MachineParams &arch_params,
+                          const vector<AutoScheduleSizeClass> &size_classes,
+                          const AutoScheduleProfile &profile) {
+    return generate_schedules_for_choice(outputs, target, arch_params,
+                                         AutoScheduleChoice(), profile, size_classes, nullptr);
+}
+
+AutoScheduleCacheStats auto_schedule_cache_stats() {
+    return RegionsRequiredCache::get().get_stats();
+}
+
+void clear_auto_schedule_cache() {
+    RegionsRequiredCache::get().clear();
+}
+
+vector<AutoScheduleChoice> enumerate_schedule_choices(const vector<Function> &outputs,
+                                                      const Target &target,
+                                                      const MachineParams &arch_params,
+                                                      int count, uint32_t seed) {
+    // Schedule a copy of the pipeline, so that the Funcs are left untouched.
+    map<string, Function> env;
+    for (Function f : outputs) {
+        map<string, Function> more_funcs = find_transitive_calls(f);
+        env.insert(more_funcs.begin(), more_funcs.end());
+    }
+    vector<Function> copies = deep_copy(outputs, env).first;
+
+    ScheduleAlternatives alternatives;
+    generate_schedules_for_choice(copies, target, arch_params,
+                                  AutoScheduleChoice(), AutoScheduleProfile(), {}, &alternatives);
+
+    // Only the few best-ranked tile configurations of each group are
+    // considered; the cost model is rarely off by more than that.
+    const int max_rank = 4;
+
+    vector<AutoScheduleChoice> choices(1);
+    std::mt19937 rng(seed);
+    for (int attempt = 0; (int)choices.size() < count && attempt < 100 * count; attempt++) {
+        AutoScheduleChoice choice;
+        // Half of the candidates stop grouping early.
+        if ((alternatives.fast_mem_merges > 0) && (rng() % 2)) {
+            choice.max_fast_mem_merges = rng() % alternatives.fast_mem_merges;
+        }
+        for (const auto &t : alternatives.tile_configs) {
+            int ranks = std::min(t.second, max_rank);
+            if ((ranks > 1) && (rng() % 2)) {
+                choice.tile_config_ranks[t.first] = 1 + rng() % (ranks - 1);
+            }
+        }
+        if (std::find(choices.begin(), choices.end(), choice) == choices.end()) {
+            choices.push_back(choice);
+        }
+    }
+    return choices;
+}
+
+}
+
+AutoScheduleProfile AutoScheduleProfile::load(const std::string &filename,
+                                              const std::string &pipeline_name) {
+    std::ifstream file(filename);
+    user_assert(file) << "Unable to open profile " << filename << "\n";
+
+    AutoScheduleProfile profile;
+    bool matched = false;
+    int64_t runs = 0;
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream tokens(line);
+        std::string kind, name;
+        tokens >> kind >> name;
+        if (kind == "pipeline") {
+            uint64_t time = 0;
+            tokens >> runs >> time;
+            user_assert(tokens && (runs > 0)) << "Malformed profile line: " << line << "\n";
+            matched = pipeline_name.empty() || (name == pipeline_name);
+        } else if (kind == "func") {
+            uint64_t time = 0, memory_peak = 0;
+            tokens >> time >> memory_peak;
+            user_assert(tokens && (runs > 0)) << "Malformed profile line: " << line << "\n";
+            if (matched) {
+                FuncStats &stats = profile.funcs[name];
+                stats.time += (double)time / (runs * 1000000.0);
+                stats.memory_peak = std::max(stats.memory_peak, memory_peak);
+            }
+        } else {
+            user_assert(kind.empty()) << "Malformed profile line: " << line << "\n";
+        }
+    }
+    return profile;
 }
 
 MachineParams MachineParams::generic() {
   return MachineParams(16, 16 * 1024 * 1024, 40);
 }
 
+MachineParams MachineParams::host() {
+    MachineParams params = generic();
+#ifdef __linux__
+    // Read the sizes of the data caches of the first core from sysfs.
+    int64_t l1 = 0, l2 = 0, llc = 0;
+    for (int index = 0; ; index++) {
+        std::string dir = "/sys/devices/system/cpu/cpu0/cache/index" + std::to_string(index) + "/";
+        std::ifstream level_file(dir + "level"), type_file(dir + "type"), size_file(dir + "size");
+        int level = 0;
+        std::string type, size;
+        if (!(level_file >> level) || !(type_file >> type) || !(size_file >> size) || size.empty()) {
+            break;
+        }
+        if (type == "Instruction") {
+            continue;
+        }
+        int64_t bytes = std::atoll(size.c_str());
+        if (size.back() == 'K') {
+            bytes *= 1024;
+        } else if (size.back() == 'M') {
+            bytes *= 1024 * 1024;
+        }
+        if (level == 1) {
+            l1 = bytes;
+        } else if (level == 2) {
+            l2 = bytes;
+        }
+        if (level >= 2) {
+            llc = bytes;
+        }
+    }
+    if (l1 > 0 && l2 > 0 && llc > 0 && llc < ((int64_t)1 << 31)) {
+        params.l1_cache_size = (int32_t)l1;
+        params.l2_cache_size = (int32_t)l2;
+        params.last_level_cache_size = (int32_t)llc;
+    }
+#endif
+    // This counts hardware threads, including SMT siblings.
+    int cores = (int)std::thread::hardware_concurrency();
+    if (cores > 0) {
+        params.parallelism = cores;
+        params.cores = cores;
+    }
+    return params;
+}
+
 std::string MachineParams::to_string() const {
+    const Expr optional[] = {l1_cache_size, l2_cache_size, l1_bandwidth, l2_bandwidth,
+                             last_level_cache_bandwidth, memory_bandwidth, cores};
     internal_assert(parallelism.type().is_int() &&
                     last_level_cache_size.type().is_int() &&
                     balance.type().is_int());
     std::ostringstream o;
     o << parallelism << "," << last_level_cache_size << "," << balance;
+    bool any_known = false;
+    for (const Expr &e : optional) {
+        internal_assert(e.type().is_int());
+        any_known = any_known || !is_zero(e);
+    }
+    if (any_known) {
+        for (const Expr &e : optional) {
+            o << "," << e;
+        }
+    }
     return o.str();
 }
 
-MachineParams::MachineParams(const std::string &s) {
+MachineParams::MachineParams(const std::string &s)
+    : l1_cache_size(0), l2_cache_size(0), l1_bandwidth(0), l2_bandwidth(0),
+      last_level_cache_bandwidth(0), memory_bandwidth(0), cores(0) {
+    if (s == "host") {
+        *this = host();
+        return;
+    }
     std::vector<std::string> v = Internal::split_string(s, ",");
-    user_assert(v.size() == 3) << "Unable to parse MachineParams: " << s;
+    user_assert(v.size() == 3 || v.size() == 10) << "Unable to parse MachineParams: " << s;
     parallelism = Internal::string_to_int(v[0]);
     last_level_cache_size = Internal::string_to_int(v[1]);
     balance = Internal::string_to_int(v[2]);
+    if (v.size() == 10) {
+        l1_cache_size = Internal::string_to_int(v[3]);
+        l2_cache_size = Internal::string_to_int(v[4]);
+        l1_bandwidth = Internal::string_to_int(v[5]);
+        l2_bandwidth = Internal::string_to_int(v[6]);
+        last_level_cache_bandwidth = Internal::string_to_int(v[7]);
+        memory_bandwidth = Internal::string_to_int(v[8]);
+        cores = Internal::string_to_int(v[9]);
+    }
 }
 
 }
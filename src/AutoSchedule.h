@@ -6,35 +6,112 @@
  * Defines the method that does automatic scheduling of Funcs within a pipeline.
  */
 
+#include <map>
+
 #include "Function.h"
+#include "IR.h"
 #include "Target.h"
 
 namespace Halide {
 
 /** A struct representing the machine parameters to generate the auto-scheduled
- * code for. */
+ * code for. The SIMD width is derived from the Target being scheduled for.
+ * The cache sizes, bandwidths and core count beyond the first three
+ * parameters are optional: a value of zero means unknown, in which case the
+ * cost model falls back to only using the last level cache. */
 struct MachineParams {
     /** Maximum level of parallelism avalaible. */
     Expr parallelism;
-    /** Size of the last-level cache (in KB). */
+    /** Size of the last-level cache (in bytes). */
     Expr last_level_cache_size;
     /** Indicates how much more expensive is the cost of a load compared to
      * the cost of an arithmetic operation at last level cache. */
     Expr balance;
+    /** Sizes of the L1 and L2 data caches of a core (in bytes). */
+    Expr l1_cache_size, l2_cache_size;
+    /** Bandwidths of the L1, L2 and last-level caches and of main memory
+     * (in bytes per cycle per core). Only their ratios matter: a load from
+     * a level costs the ratio of the L1 bandwidth to its bandwidth, up to
+     * 'balance'. */
+    Expr l1_bandwidth, l2_bandwidth, last_level_cache_bandwidth, memory_bandwidth;
+    /** Number of hardware threads sharing the last-level cache, which is
+     * divided evenly among them when sizing tiles. host() counts SMT
+     * threads, as std::thread::hardware_concurrency() does, so this can be
+     * twice the number of physical cores. */
+    Expr cores;
 
     explicit MachineParams(int32_t parallelism, int32_t llc, int32_t balance)
-        : parallelism(parallelism), last_level_cache_size(llc), balance(balance) {}
+        : parallelism(parallelism), last_level_cache_size(llc), balance(balance),
+          l1_cache_size(0), l2_cache_size(0), l1_bandwidth(0), l2_bandwidth(0),
+          last_level_cache_bandwidth(0), memory_bandwidth(0), cores(0) {}
 
     /** Default machine parameters for generic CPU architecture. */
     static MachineParams generic();
 
-    /** Convert the MachineParams into canonical string form. */
+    /** Machine parameters detected on the host: the cache sizes and core
+     * count are read from the operating system where possible, and the
+     * others are the generic ones. */
+    static MachineParams host();
+
+    /** Convert the MachineParams into canonical string form: the first three
+     * parameters, followed by the optional ones in declaration order if any
+     * of them is known. */
     std::string to_string() const;
 
-    /** Reconstruct a MachineParams from canonical string form. */
+    /** Reconstruct a MachineParams from canonical string form, or
+     * detect them on the host if the string is "host". */
     explicit MachineParams(const std::string &s);
 };
 
+/** A struct representing the parameters of the autotuning mode of the
+ * auto-scheduler, which benchmarks a number of candidate schedules instead
+ * of relying only on the cost model. */
+struct AutotuneParams {
+    /** Number of candidate schedules to compile and benchmark. The first
+     * candidate is always the one chosen by the cost model. */
+    int candidates;
+    /** Maximum time (in seconds) to spend benchmarking all the candidates. */
+    double budget;
+    /** Seed used to sample the candidates. */
+    uint32_t seed;
+
+    explicit AutotuneParams(int candidates = 8, double budget = 30, uint32_t seed = 0)
+        : candidates(candidates), budget(budget), seed(seed) {}
+};
+
+/** The time and memory of each Func of a pipeline, measured by a previous
+ * run compiled with Target::Profile and saved by halide_profiler_save().
+ * The auto-scheduler calibrates the arithmetic cost of each Func and the
+ * balance of its cost model against the measured times. */
+struct AutoScheduleProfile {
+    struct FuncStats {
+        /** Average time spent computing the Func per run (in milliseconds). */
+        double time = 0;
+        /** Peak heap memory allocated by the Func (in bytes). */
+        uint64_t memory_peak = 0;
+    };
+    /** The Funcs of the pipeline which were computed (not inlined) when it
+     * was profiled, by name. */
+    std::map<std::string, FuncStats> funcs;
+
+    bool empty() const { return funcs.empty(); }
+
+    /** Load a profile saved by halide_profiler_save(). If the file contains
+     * several pipelines, only the one named 'pipeline_name' is used, or all
+     * of them if it is empty. */
+    static AutoScheduleProfile load(const std::string &filename,
+                                    const std::string &pipeline_name = "");
+};
+
+/** A class of sizes a pipeline is run at, described by estimates on the
+ * regions of its outputs and input images. They replace the estimates set
+ * with Func::estimate() and set_bounds_estimate() for the Funcs and
+ * ImageParams named here; the others keep their estimates. */
+struct AutoScheduleSizeClass {
+    /** The estimated region of each output Func or input ImageParam, by name. */
+    std::map<std::string, Internal::Region> estimates;
+};
+
 namespace Internal {
 
 /** Generate schedules for Funcs within a pipeline. The Funcs should not already
@@ -46,6 +123,75 @@ std::string generate_schedules(const std::vector<Function> &outputs,
                                const Target &target,
                                const MachineParams &arch_params);
 
+/** One of the alternatives to the schedule picked by the cost model of the
+ * auto-scheduler. A default-constructed choice is the cost model's pick. */
+struct AutoScheduleChoice {
+    /** Stop grouping for fast memory after this many merges. A negative
+     * value does not limit the grouping. */
+    int max_fast_mem_merges = -1;
+    /** For the groups named here by their output stage, use the tile
+     * configuration with the given rank in the cost model's estimate
+     * instead of the best one. */
+    std::map<std::string, int> tile_config_ranks;
+
+    bool operator==(const AutoScheduleChoice &other) const {
+        return max_fast_mem_merges == other.max_fast_mem_merges &&
+            tile_config_ranks == other.tile_config_ranks;
+    }
+};
+
+/** Same as above, but applies the given alternative to the choices made by
+ * the cost model. */
+std::string generate_schedules(const std::vector<Function> &outputs,
+                               const Target &target,
+                               const MachineParams &arch_params,
+                               const AutoScheduleChoice &choice);
+
+/** Same as above, but calibrates the cost model against the measured time
+ * of the Funcs in 'profile'. */
+std::string generate_schedules(const std::vector<Function> &outputs,
+                               const Target &target,
+                               const MachineParams &arch_params,
+                               const AutoScheduleProfile &profile);
+
+/** Same as above, but also specializes the schedules of the pipeline for
+ * each of the 'size_classes'. The Funcs whose loop nests can differ between
+ * sizes get a specialization per size class, conditioned on each extent of
+ * the input images being closer to the estimate of that class than to the
+ * estimates of the other classes and to the default estimates, and
+ * scheduled for the estimates of that class. The default schedule is used
+ * when no class matches. */
+std::string generate_schedules(const std::vector<Function> &outputs,
+                               const Target &target,
+                               const MachineParams &arch_params,
+                               const std::vector<AutoScheduleSizeClass> &size_classes,
+                               const AutoScheduleProfile &profile);
+
+/** Statistics of the cache of the regions required by the dependence
+ * analysis of the auto-scheduler, which is shared by all its runs in the
+ * process. If the environment variable HL_AUTO_SCHEDULE_CACHE names a file,
+ * the cache is also loaded from and saved to that file. */
+struct AutoScheduleCacheStats {
+    int64_t hits = 0;
+    int64_t misses = 0;
+    size_t entries = 0;
+};
+
+/** Return the statistics of the analysis cache of the auto-scheduler. */
+AutoScheduleCacheStats auto_schedule_cache_stats();
+
+/** Empty the analysis cache of the auto-scheduler and reset its statistics. */
+void clear_auto_schedule_cache();
+
+/** Enumerate up to 'count' distinct alternatives among the groupings and tile
+ * configurations considered by the auto-scheduler for the pipeline. The first
+ * one is always the cost model's pick; the others are sampled using
+ * 'seed'. This does not modify the Funcs. */
+std::vector<AutoScheduleChoice> enumerate_schedule_choices(const std::vector<Function> &outputs,
+                                                           const Target &target,
+                                                           const MachineParams &arch_params,
+                                                           int count, uint32_t seed);
+
 }
 }
 
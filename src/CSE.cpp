@@ -1,4 +1,5 @@
 #include <map>
+#include <unordered_map>
 
 #include "CSE.h"
 #include "IRMutator.h"
@@ -88,7 +89,7 @@ public:
     };
     vector<Entry> entries;
 
-    typedef map<ExprWithCompareCache, int> CacheType;
+    typedef std::unordered_map<ExprWithCompareCache, int, ExprWithCompareCache::Hash> CacheType;
     CacheType numbering;
 
     map<Expr, int, ExprCompare> shallow_numbering;
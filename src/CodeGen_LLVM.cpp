@@ -12,6 +12,7 @@
 #include "Simplify.h"
 #include "JITModule.h"
 #include "CodeGen_Internal.h"
+#include "CompileTimeProfiler.h"
 #include "Lerp.h"
 #include "Util.h"
 #include "LLVM_Runtime_Linker.h"
@@ -523,6 +524,7 @@ std::unique_ptr<llvm::Module> CodeGen_LLVM::compile(const Module &input) {
 
     // Generate the code for this module.
     debug(1) << "Generating llvm bitcode...\n";
+    LLVMPassTimer ir_timer("LLVM IR generation", *module);
     for (const auto &b : input.buffers()) {
         compile_buffer(b);
     }
@@ -544,6 +546,8 @@ std::unique_ptr<llvm::Module> CodeGen_LLVM::compile(const Module &input) {
         }
     }
 
+    ir_timer.stop();
+
     debug(2) << module.get() << "\n";
 
     // Verify the module is ok
@@ -551,7 +555,10 @@ std::unique_ptr<llvm::Module> CodeGen_LLVM::compile(const Module &input) {
     debug(2) << "Done generating llvm bitcode\n";
 
     // Optimize
-    CodeGen_LLVM::optimize_module();
+    {
+        LLVMPassTimer timer("LLVM optimization", *module);
+        CodeGen_LLVM::optimize_module();
+    }
 
     input_module = nullptr;
 
@@ -0,0 +1,261 @@
+#include "CompileTimeProfiler.h"
+#include "IRVisitor.h"
+#include "LLVM_Headers.h"
+#include "Util.h"
+
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <vector>
+
+namespace Halide {
+namespace Internal {
+
+using std::string;
+using std::vector;
+
+namespace {
+
+struct CompileTimeRecord {
+    string pipeline, pass;
+    double seconds;
+    int64_t size_before, size_after;
+};
+
+struct CompileTimeRecords {
+    std::mutex mutex;
+    vector<CompileTimeRecord> records;
+};
+
+CompileTimeRecords &compile_time_records() {
+    static CompileTimeRecords records;
+    return records;
+}
+
+enum class ReportFormat {
+    None,
+    Table,
+    JSON
+};
+
+ReportFormat report_format() {
+    static ReportFormat format = []() {
+        string value = get_env_variable("HL_COMPILE_PROFILE");
+        if (value == "table" || value == "1") {
+            return ReportFormat::Table;
+        } else if (value == "json") {
+            return ReportFormat::JSON;
+        }
+        user_assert(value.empty() || value == "0")
+            << "HL_COMPILE_PROFILE must be \"table\" or \"json\", not \"" << value << "\"\n";
+        return ReportFormat::None;
+    }();
+    return format;
+}
+
+class CountNodes : public IRGraphVisitor {
+    std::set<const IRNode *> seen;
+
+    void include(const Expr &e) override {
+        if (seen.insert(e.get()).second) {
+            count++;
+            e.accept(this);
+        }
+    }
+
+    void include(const Stmt &s) override {
+        if (seen.insert(s.get()).second) {
+            count++;
+            s.accept(this);
+        }
+    }
+
+public:
+    int64_t count = 0;
+
+    void count_nodes(const Stmt &s) {
+        include(s);
+    }
+};
+
+string json_string(const string &s) {
+    std::ostringstream out;
+    out << '"';
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else if ((unsigned char)c < 0x20) {
+            out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int)c << std::dec;
+        } else {
+            out << c;
+        }
+    }
+    out << '"';
+    return out.str();
+}
+
+void print_table(std::ostream &out, const string &title, const vector<CompileTimeRecord> &records) {
+    size_t pipeline_width = 8, pass_width = 4;
+    double total = 0;
+    for (const CompileTimeRecord &r : records) {
+        pipeline_width = std::max(pipeline_width, r.pipeline.size());
+        pass_width = std::max(pass_width, r.pass.size());
+        total += r.seconds;
+    }
+
+    out << "Compile time profile of " << title << ":\n"
+        << std::left
+        << std::setw(pipeline_width) << "pipeline" << "  "
+        << std::setw(pass_width) << "pass" << "  "
+        << std::right
+        << std::setw(12) << "time (ms)" << "  "
+        << std::setw(8) << "%" << "  "
+        << std::setw(12) << "size before" << "  "
+        << std::setw(12) << "size after" << "\n";
+    for (const CompileTimeRecord &r : records) {
+        out << std::left
+            << std::setw(pipeline_width) << r.pipeline << "  "
+            << std::setw(pass_width) << r.pass << "  "
+            << std::right << std::fixed
+            << std::setprecision(3) << std::setw(12) << r.seconds * 1000 << "  "
+            << std::setprecision(2) << std::setw(8) << (total > 0 ? 100 * r.seconds / total : 0) << "  "
+            << std::setw(12) << r.size_before << "  "
+            << std::setw(12) << r.size_after << "\n";
+    }
+    out << std::left << std::setw(pipeline_width + pass_width + 2) << "total" << "  "
+        << std::right << std::setprecision(3) << std::setw(12) << total * 1000 << "\n";
+}
+
+void print_json(std::ostream &out, const string &title, const vector<CompileTimeRecord> &records) {
+    out << "{\"title\": " << json_string(title) << ", \"passes\": [";
+    for (size_t i = 0; i < records.size(); i++) {
+        const CompileTimeRecord &r = records[i];
+        out << (i > 0 ? ",\n  " : "\n  ")
+            << "{\"pipeline\": " << json_string(r.pipeline)
+            << ", \"pass\": " << json_string(r.pass)
+            << ", \"time_ms\": " << std::setprecision(6) << r.seconds * 1000
+            << ", \"size_before\": " << r.size_before
+            << ", \"size_after\": " << r.size_after << "}";
+    }
+    out << "\n]}\n";
+}
+
+double seconds_since(std::chrono::high_resolution_clock::time_point start) {
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
+}
+
+}  // namespace
+
+bool compile_time_profiling_enabled() {
+    return report_format() != ReportFormat::None;
+}
+
+int64_t count_ir_nodes(const Stmt &s) {
+    if (!s.defined()) {
+        return 0;
+    }
+    CountNodes counter;
+    counter.count_nodes(s);
+    return counter.count;
+}
+
+int64_t count_llvm_instructions(const llvm::Module &m) {
+    int64_t count = 0;
+    for (const llvm::Function &f : m) {
+        for (const llvm::BasicBlock &b : f) {
+            count += b.size();
+        }
+    }
+    return count;
+}
+
+void record_compile_time(const string &pipeline, const string &pass,
+                         double seconds, int64_t size_before, int64_t size_after) {
+    CompileTimeRecords &r = compile_time_records();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.records.push_back({pipeline, pass, seconds, size_before, size_after});
+}
+
+void report_compile_times(const string &title) {
+    ReportFormat format = report_format();
+    if (format == ReportFormat::None) {
+        return;
+    }
+
+    vector<CompileTimeRecord> records;
+    {
+        CompileTimeRecords &r = compile_time_records();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        records.swap(r.records);
+    }
+    if (records.empty()) {
+        return;
+    }
+
+    std::ostringstream report;
+    if (format == ReportFormat::Table) {
+        print_table(report, title, records);
+    } else {
+        print_json(report, title, records);
+    }
+
+    string filename = get_env_variable("HL_COMPILE_PROFILE_FILE");
+    if (filename.empty()) {
+        std::cerr << report.str();
+    } else {
+        std::ofstream file(filename, std::ios_base::app);
+        user_assert(file) << "Could not open " << filename << " to write the compile time profile\n";
+        file << report.str();
+    }
+}
+
+LoweringPassTimer::LoweringPassTimer(const string &pipeline)
+    : pipeline(pipeline), enabled(compile_time_profiling_enabled()) {
+}
+
+void LoweringPassTimer::pass(const string &name, const Stmt &s) {
+    if (!enabled) {
+        return;
+    }
+    finish(s);
+    current_pass = name;
+    size_before = count_ir_nodes(s);
+    // Start the clock after counting, so that it isn't included.
+    start = std::chrono::high_resolution_clock::now();
+}
+
+void LoweringPassTimer::finish(const Stmt &s) {
+    if (!enabled || current_pass.empty()) {
+        return;
+    }
+    double seconds = seconds_since(start);
+    record_compile_time(pipeline, current_pass, seconds, size_before, count_ir_nodes(s));
+    current_pass.clear();
+}
+
+LLVMPassTimer::LLVMPassTimer(const string &pass, const llvm::Module &module)
+    : pipeline(module.getModuleIdentifier()), pass(pass), module(module),
+      running(compile_time_profiling_enabled()) {
+    if (running) {
+        size_before = count_llvm_instructions(module);
+        start = std::chrono::high_resolution_clock::now();
+    }
+}
+
+LLVMPassTimer::~LLVMPassTimer() {
+    stop();
+}
+
+void LLVMPassTimer::stop() {
+    if (running) {
+        double seconds = seconds_since(start);
+        record_compile_time(pipeline, pass, seconds, size_before, count_llvm_instructions(module));
+        running = false;
+    }
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,86 @@
+#ifndef HALIDE_COMPILE_TIME_PROFILER_H
+#define HALIDE_COMPILE_TIME_PROFILER_H
+
+/** \file
+ * Defines a profiler for the time spent in each pass of the compiler.
+ */
+
+#include <chrono>
+#include <stdint.h>
+#include <string>
+
+#include "Expr.h"
+
+namespace llvm {
+class Module;
+}
+
+namespace Halide {
+namespace Internal {
+
+/** Return whether compile-time profiling is enabled. It is enabled by
+ * setting the environment variable HL_COMPILE_PROFILE to "table" or
+ * "json", which selects the format of the report. */
+bool compile_time_profiling_enabled();
+
+/** Count the IR nodes in a statement. Shared subexpressions are only
+ * counted once. */
+int64_t count_ir_nodes(const Stmt &s);
+
+/** Count the instructions in an LLVM module. */
+int64_t count_llvm_instructions(const llvm::Module &m);
+
+/** Record that a compiler pass over a pipeline took the given number
+ * of seconds. The sizes are the number of IR nodes for lowering
+ * passes, and the number of LLVM instructions for LLVM passes, or -1
+ * if unknown. This is safe to call from several threads. */
+void record_compile_time(const std::string &pipeline, const std::string &pass,
+                         double seconds, int64_t size_before, int64_t size_after);
+
+/** Print the compile times recorded so far in the format selected by
+ * HL_COMPILE_PROFILE, to the file named by HL_COMPILE_PROFILE_FILE,
+ * or to stderr, and forget them. Does nothing if profiling is
+ * disabled or nothing was recorded. */
+void report_compile_times(const std::string &title);
+
+/** Times the passes of lowering a pipeline. Each call to pass() ends
+ * the previous pass and starts a new one. This does nothing if
+ * profiling is disabled. */
+class LoweringPassTimer {
+    const std::string pipeline;
+    const bool enabled;
+    std::string current_pass;
+    int64_t size_before = 0;
+    std::chrono::high_resolution_clock::time_point start;
+
+public:
+    LoweringPassTimer(const std::string &pipeline);
+
+    /** Start timing a pass named 'name', which starts from the
+     * statement 's'. */
+    void pass(const std::string &name, const Stmt &s);
+
+    /** End the current pass, which produced the statement 's'. */
+    void finish(const Stmt &s);
+};
+
+/** Times a pass over an LLVM module, until stop() is called or it
+ * goes out of scope. This does nothing if profiling is disabled. */
+class LLVMPassTimer {
+    const std::string pipeline, pass;
+    const llvm::Module &module;
+    bool running;
+    int64_t size_before = 0;
+    std::chrono::high_resolution_clock::time_point start;
+
+public:
+    LLVMPassTimer(const std::string &pass, const llvm::Module &module);
+    ~LLVMPassTimer();
+
+    void stop();
+};
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
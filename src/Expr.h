@@ -5,6 +5,7 @@
  * Base classes for Halide expressions (\ref Halide::Expr) and statements (\ref Halide::Internal::Stmt)
  */
 
+#include <atomic>
 #include <string>
 #include <vector>
 
@@ -75,7 +76,7 @@ struct IRNode {
      * visitors.
      */
     virtual void accept(IRVisitor *v) const = 0;
-    IRNode(IRNodeType t) : node_type(t) {}
+    IRNode(IRNodeType t) : node_type(t), structural_hash(0) {}
     virtual ~IRNode() {}
 
     /** These classes are all managed with intrusive reference
@@ -96,6 +97,13 @@ struct IRNode {
      * anyway, so this doesn't increase the memory footprint of an IR node.
      */
     IRNodeType node_type;
+
+    /** A hash of the value of this node, which is equal for any two
+     * nodes that compare equal with the functions in
+     * IREquality.h. It is computed lazily by structural_hash(), and
+     * is zero until then. IR nodes are immutable once made, so it
+     * never needs to be recomputed. */
+    mutable std::atomic<uint64_t> structural_hash;
 };
 
 template<>
@@ -2413,6 +2413,39 @@ Func &Func::trace_realizations() {
     return *this;
 }
 
+Func &Func::trace_region(const Region &region) {
+    invalidate_cache();
+    user_assert((int)region.size() == dimensions())
+        << "Func " << name() << " has " << dimensions()
+        << " dimensions, but the tracing region has " << region.size() << "\n";
+    TraceFilter &filter = func.trace_filter();
+    filter.region_min.clear();
+    filter.region_extent.clear();
+    for (const Range &r : region) {
+        filter.region_min.push_back(cast<int>(r.min));
+        filter.region_extent.push_back(cast<int>(r.extent));
+    }
+    return *this;
+}
+
+Func &Func::trace_sample(int every, int tile_size) {
+    invalidate_cache();
+    user_assert(every > 0 && tile_size > 0)
+        << "Tracing sample rate and tile size for Func " << name()
+        << " must be positive\n";
+    func.trace_filter().sample_every = every;
+    func.trace_filter().sample_tile = tile_size;
+    return *this;
+}
+
+Func &Func::trace_limit(int max_events) {
+    invalidate_cache();
+    user_assert(max_events > 0)
+        << "Tracing limit for Func " << name() << " must be positive\n";
+    func.trace_filter().event_limit = max_events;
+    return *this;
+}
+
 void Func::debug_to_file(const string &filename) {
     invalidate_cache();
     func.debug_file() = filename;
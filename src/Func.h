@@ -2242,6 +2242,23 @@ public:
      * halide_trace. */
     Func &trace_realizations();
 
+    /** Restrict tracing of loads and stores of this Func to
+     * coordinates inside the given box. Accesses outside of it are
+     * skipped in the generated code without calling
+     * halide_trace. Vector accesses are traced if any lane falls
+     * inside the box. */
+    Func &trace_region(const Internal::Region &region);
+
+    /** Only trace loads and stores of this Func that fall in every
+     * Nth tile along each dimension, where tiles are tile_size
+     * wide. With the default tile size of one this traces every Nth
+     * coordinate in each dimension. */
+    Func &trace_sample(int every, int tile_size = 1);
+
+    /** Only trace the first max_events loads and stores of this Func
+     * per invocation of the pipeline. */
+    Func &trace_limit(int max_events);
+
     /** Get a handle on the internal halide function that this Func
      * represents. Useful if you want to do introspection on Halide
      * functions */
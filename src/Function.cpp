@@ -88,6 +88,7 @@ struct FunctionContents {
     Expr extern_proxy_expr;
 
     bool trace_loads = false, trace_stores = false, trace_realizations = false;
+    TraceFilter trace_filter;
 
     bool frozen = false;
 
@@ -116,6 +117,11 @@ struct FunctionContents {
             }
         }
 
+        for (size_t i = 0; i < trace_filter.region_min.size(); i++) {
+            trace_filter.region_min[i].accept(visitor);
+            trace_filter.region_extent[i].accept(visitor);
+        }
+
         for (Parameter i : output_buffers) {
             for (size_t j = 0; j < args.size(); j++) {
                 if (i.min_constraint(j).defined()) {
@@ -150,6 +156,11 @@ struct FunctionContents {
             }
             extern_proxy_expr = mutator->mutate(extern_proxy_expr);
         }
+
+        for (size_t i = 0; i < trace_filter.region_min.size(); i++) {
+            trace_filter.region_min[i] = mutator->mutate(trace_filter.region_min[i]);
+            trace_filter.region_extent[i] = mutator->mutate(trace_filter.region_extent[i]);
+        }
     }
 };
 
@@ -340,6 +351,7 @@ void Function::deep_copy(FunctionPtr copy, DeepCopyMap &copied_map) const {
     copy->trace_loads = contents->trace_loads;
     copy->trace_stores = contents->trace_stores;
     copy->trace_realizations = contents->trace_realizations;
+    copy->trace_filter = contents->trace_filter;
     copy->frozen = contents->frozen;
     copy->output_buffers = contents->output_buffers;
     copy->func_schedule = contents->func_schedule.deep_copy(copied_map);
@@ -894,6 +906,12 @@ bool Function::is_tracing_stores() const {
 bool Function::is_tracing_realizations() const {
     return contents->trace_realizations;
 }
+const TraceFilter &Function::trace_filter() const {
+    return contents->trace_filter;
+}
+TraceFilter &Function::trace_filter() {
+    return contents->trace_filter;
+}
 
 void Function::freeze() {
     contents->frozen = true;
@@ -61,6 +61,28 @@ namespace Internal {
 
 struct Call;
 
+/** Restrictions on which loads and stores of a Function get
+ * traced. The filtering is done inside the generated code, so
+ * accesses that are filtered out never reach halide_trace. */
+struct TraceFilter {
+    /** Only trace accesses inside this box, given as a min and
+     * extent per dimension. Empty means unrestricted. */
+    std::vector<Expr> region_min, region_extent;
+
+    /** Only trace accesses that fall in every sample_every'th tile
+     * along each dimension, where tiles are sample_tile wide. */
+    int sample_every = 1, sample_tile = 1;
+
+    /** Trace at most this many loads and stores of the Function per
+     * pipeline invocation. Zero means no limit. */
+    int event_limit = 0;
+
+    /** Check if this filter drops any events at all. */
+    bool defined() const {
+        return !region_min.empty() || sample_every > 1 || event_limit > 0;
+    }
+};
+
 /** A reference-counted handle to Halide's internal representation of
  * a function. Similar to a front-end Func object, but with no
  * syntactic sugar to help with definitions. */
@@ -283,6 +305,13 @@ public:
     bool is_tracing_realizations() const;
     // @}
 
+    /** Get a handle to the filter restricting which loads and stores
+     * of this Function are traced. */
+    // @{
+    const TraceFilter &trace_filter() const;
+    TraceFilter &trace_filter();
+    // @}
+
     /** Replace this Function's LoopLevels with locked copies that
      * cannot be mutated further. */
     void lock_loop_levels();
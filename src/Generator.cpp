@@ -3,6 +3,8 @@
 #include <set>
 
 #include "Generator.h"
+#include "CompileTimeProfiler.h"
+#include "MemoryEstimate.h"
 #include "Outputs.h"
 #include "Simplify.h"
 
@@ -96,6 +98,9 @@ Outputs compute_outputs(const Target &target,
     if (options.emit_schedule) {
         output_files.schedule_name = base_path + get_extension(".schedule", options);
     }
+    if (options.emit_memory_estimate) {
+        output_files.memory_estimate_name = base_path + get_extension(".memory_estimate", options);
+    }
     return output_files;
 }
 
@@ -695,12 +700,14 @@ std::string halide_type_to_c_type(const Type &t) {
 }
 
 int generate_filter_main(int argc, char **argv, std::ostream &cerr) {
-    const char kUsage[] = "gengen [-g GENERATOR_NAME] [-f FUNCTION_NAME] [-o OUTPUT_DIR] [-r RUNTIME_NAME] [-e EMIT_OPTIONS] [-x EXTENSION_OPTIONS] [-n FILE_BASE_NAME] "
+    const char kUsage[] = "gengen [-g GENERATOR_NAME] [-f FUNCTION_NAME] [-o OUTPUT_DIR] [-r RUNTIME_NAME] [-e EMIT_OPTIONS] [-x EXTENSION_OPTIONS] [-n FILE_BASE_NAME] [-p PROFILE] "
                           "target=target-string[,target-string...] [generator_arg=value [...]]\n\n"
                           "  -e  A comma separated list of files to emit. Accepted values are "
-                          "[assembly, bitcode, cpp, h, html, o, static_library, stmt, cpp_stub, schedule]. If omitted, default value is [static_library, h].\n"
+                          "[assembly, bitcode, cpp, h, html, o, static_library, stmt, cpp_stub, schedule, memory_estimate]. If omitted, default value is [static_library, h].\n"
                           "  -x  A comma separated list of file extension pairs to substitute during file naming, "
-                          "in the form [.old=.new[,.old2=.new2]]\n";
+                          "in the form [.old=.new[,.old2=.new2]]\n"
+                          "  -p  A profile saved by halide_profiler_save() from a previous run of the pipeline, "
+                          "used to calibrate the auto-scheduler when auto_schedule=true.\n";
 
     std::map<std::string, std::string> flags_info = { { "-f", "" },
                                                       { "-g", "" },
@@ -708,7 +715,8 @@ int generate_filter_main(int argc, char **argv, std::ostream &cerr) {
                                                       { "-e", "" },
                                                       { "-n", "" },
                                                       { "-x", "" },
-                                                      { "-r", "" }};
+                                                      { "-r", "" },
+                                                      { "-p", "" }};
     GeneratorParamsMap generator_args;
 
     for (int i = 1; i < argc; ++i) {
@@ -815,9 +823,11 @@ int generate_filter_main(int argc, char **argv, std::ostream &cerr) {
                 emit_options.emit_cpp_stub = true;
             } else if (opt == "schedule") {
                 emit_options.emit_schedule = true;
+            } else if (opt == "memory_estimate") {
+                emit_options.emit_memory_estimate = true;
             } else if (!opt.empty()) {
                 cerr << "Unrecognized emit option: " << opt
-                     << " not one of [assembly, bitcode, cpp, h, html, o, static_library, stmt, cpp_stub], ignoring.\n";
+                     << " not one of [assembly, bitcode, cpp, h, html, o, static_library, stmt, cpp_stub, schedule, memory_estimate], ignoring.\n";
             }
         }
     }
@@ -852,6 +862,11 @@ int generate_filter_main(int argc, char **argv, std::ostream &cerr) {
         compile_standalone_runtime(output_files, targets[0]);
     }
 
+    AutoScheduleProfile auto_schedule_profile;
+    if (!flags_info["-p"].empty()) {
+        auto_schedule_profile = AutoScheduleProfile::load(flags_info["-p"]);
+    }
+
     if (!generator_name.empty()) {
         std::string base_path = compute_base_path(output_dir, function_name, file_base_name);
         debug(1) << "Generator " << generator_name << " has base_path " << base_path << "\n";
@@ -865,14 +880,17 @@ int generate_filter_main(int argc, char **argv, std::ostream &cerr) {
         // Don't bother with this if we're just emitting a cpp_stub.
         if (!stub_only) {
             Outputs output_files = compute_outputs(targets[0], base_path, emit_options);
-            auto module_producer = [&generator_name, &generator_args]
+            auto module_producer = [&generator_name, &generator_args, &auto_schedule_profile, &emit_options]
                 (const std::string &name, const Target &target) -> Module {
                     auto sub_generator_args = generator_args;
                     sub_generator_args.erase("target");
                     // Must re-create each time since each instance will have a different Target.
-                    auto gen = GeneratorRegistry::create(generator_name, GeneratorContext(target));
+                    auto gen = GeneratorRegistry::create(generator_name,
+                                                         GeneratorContext(target, false, MachineParams::generic(),
+                                                                          auto_schedule_profile));
                     gen->set_generator_param_values(sub_generator_args);
-                    return gen->build_module(name);
+                    return gen->build_module(name, LoweredFunc::ExternalPlusMetadata,
+                                             emit_options.emit_memory_estimate);
                 };
             if (targets.size() > 1 || !emit_options.substitutions.empty()) {
                 compile_multitarget(function_name, output_files, targets, module_producer, emit_options.substitutions);
@@ -885,6 +903,8 @@ int generate_filter_main(int argc, char **argv, std::ostream &cerr) {
         }
     }
 
+    report_compile_times(generator_name.empty() ? runtime_name : generator_name);
+
     return 0;
 }
 
@@ -1300,11 +1320,14 @@ Pipeline GeneratorBase::get_pipeline() {
 }
 
 Module GeneratorBase::build_module(const std::string &function_name,
-                                   const LoweredFunc::LinkageType linkage_type) {
+                                   const LoweredFunc::LinkageType linkage_type,
+                                   bool with_memory_estimate) {
     std::string auto_schedule_result;
     Pipeline pipeline = build_pipeline();
     if (get_auto_schedule()) {
-        auto_schedule_result = pipeline.auto_schedule(get_target(), get_machine_params());
+        auto_schedule_result = pipeline.auto_schedule(get_target(), get_machine_params(),
+                                                      auto_schedule_size_classes,
+                                                      get_auto_schedule_profile());
     }
 
     // Special-case here: for certain legacy Generators, building the pipeline
@@ -1348,6 +1371,29 @@ Module GeneratorBase::build_module(const std::string &function_name,
 
     result.set_auto_schedule(auto_schedule_result);
 
+    if (with_memory_estimate) {
+        std::vector<Parameter> params;
+        for (auto param : pi.filter_params) {
+            params.push_back(*param);
+        }
+        for (auto input : pi.filter_inputs) {
+            for (const auto &p : input->parameters_) {
+                params.push_back(p);
+            }
+        }
+        std::vector<Function> output_functions;
+        for (const Func &f : outputs) {
+            output_functions.push_back(f.function());
+        }
+        for (const LoweredFunc &f : result.functions()) {
+            if (f.linkage == linkage_type) {
+                result.set_memory_estimate(estimate_memory(f.body, output_functions,
+                                                           params, get_machine_params()));
+                break;
+            }
+        }
+    }
+
     return result;
 }
 
@@ -192,7 +192,11 @@
  *  - 'machine_params' is only used if auto_schedule is true; it is ignored
  *    if auto_schedule is false. It provides details about the machine architecture
  *    being targeted which may be used to enhance the automatically-generated
- *    schedule.
+ *    schedule. The value "host" detects the machine parameters of the host.
+ *
+ *  GenGen's '-p' flag provides a profile of a previous run of the Generator's
+ *  pipeline, saved by halide_profiler_save(), against which the auto-scheduler
+ *  calibrates its cost model (see AutoScheduleProfile).
  *
  * Generators are added to a global registry to simplify AOT build mechanics; this
  * is done by simply using the HALIDE_REGISTER_GENERATOR macro at global scope:
@@ -2387,10 +2391,12 @@ public:
 
     explicit GeneratorContext(const Target &t,
                               bool auto_schedule = false,
-                              const MachineParams &machine_params = MachineParams::generic()) :
+                              const MachineParams &machine_params = MachineParams::generic(),
+                              const AutoScheduleProfile &auto_schedule_profile = AutoScheduleProfile()) :
         target("target", t),
         auto_schedule("auto_schedule", auto_schedule),
         machine_params("machine_params", machine_params),
+        auto_schedule_profile(auto_schedule_profile),
         externs_map(std::make_shared<ExternsMap>()),
         value_tracker(std::make_shared<Internal::ValueTracker>()) {}
     virtual ~GeneratorContext() {}
@@ -2398,6 +2404,7 @@ public:
     inline Target get_target() const { return target; }
     inline bool get_auto_schedule() const { return auto_schedule; }
     inline MachineParams get_machine_params() const { return machine_params; }
+    inline const AutoScheduleProfile &get_auto_schedule_profile() const { return auto_schedule_profile; }
 
     /** Generators can register ExternalCode objects onto
      * themselves. The Generator infrastructure will arrange to have
@@ -2434,6 +2441,7 @@ protected:
     GeneratorParam<Target> target;
     GeneratorParam<bool> auto_schedule;
     GeneratorParam<MachineParams> machine_params;
+    AutoScheduleProfile auto_schedule_profile;
     std::shared_ptr<ExternsMap> externs_map;
     std::shared_ptr<Internal::ValueTracker> value_tracker;
 
@@ -2443,6 +2451,7 @@ protected:
         target.set(context.get_target());
         auto_schedule.set(context.get_auto_schedule());
         machine_params.set(context.get_machine_params());
+        auto_schedule_profile = context.get_auto_schedule_profile();
         value_tracker = context.get_value_tracker();
         externs_map = context.get_externs_map();
     }
@@ -2533,6 +2542,7 @@ public:
         bool emit_static_library{true};
         bool emit_cpp_stub{false};
         bool emit_schedule{false};
+        bool emit_memory_estimate{false};
         // This is an optional map used to replace the default extensions generated for
         // a file: if an key matches an output extension, emit those files with the
         // corresponding value instead (e.g., ".s" -> ".assembly_text"). This is
@@ -2563,8 +2573,11 @@ public:
 
     // Call build() and produce a Module for the result.
     // If function_name is empty, generator_name() will be used for the function.
+    // If with_memory_estimate is true, the Module also carries a static
+    // estimate of the memory used by the pipeline (see estimate_memory()).
     Module build_module(const std::string &function_name = "",
-                        const LoweredFunc::LinkageType linkage_type = LoweredFunc::ExternalPlusMetadata);
+                        const LoweredFunc::LinkageType linkage_type = LoweredFunc::ExternalPlusMetadata,
+                        bool with_memory_estimate = false);
 
     /**
      * set_inputs is a variadic wrapper around set_inputs_vector, which makes usage much simpler
@@ -2621,6 +2634,15 @@ protected:
 
     void track_parameter_values(bool include_outputs);
 
+    /** Add a class of sizes the pipeline is run at. When auto_schedule is
+     * true, the auto-scheduler specializes the schedule of the pipeline for
+     * each of them, dispatching at run time on the extents of the inputs
+     * (see AutoScheduleSizeClass). Call this from generate(). */
+    void add_auto_schedule_size_class(const AutoScheduleSizeClass &size_class) {
+        auto_schedule_size_classes.push_back(size_class);
+    }
+    std::vector<AutoScheduleSizeClass> auto_schedule_size_classes;
+
     void pre_build();
     void post_build();
     void pre_generate();
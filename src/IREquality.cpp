@@ -2,6 +2,8 @@
 #include "IRVisitor.h"
 #include "IROperator.h"
 
+#include <string.h>
+
 namespace Halide {
 namespace Internal {
 
@@ -33,12 +35,24 @@ public:
      * subexpressions, it's worth passing in a cache to use.
      * Currently this is only done in common-subexpression
      * elimination. */
-    IRComparer(IRCompareCache *c = nullptr) : result(Equal), cache(c) {}
+    IRComparer(IRCompareCache *c = nullptr) : result(Equal), cache(c), equality_only(false) {}
+
+    /** If we only want to know whether the nodes are equal, any
+     * unequal result will do, so nodes with different hashes can be
+     * told apart without looking at their children. */
+    static IRComparer equality(IRCompareCache *c = nullptr) {
+        IRComparer cmp(c);
+        cmp.equality_only = true;
+        return cmp;
+    }
 
 private:
     Expr expr;
     Stmt stmt;
     IRCompareCache *cache;
+    bool equality_only;
+
+    CmpResult compare_hashes(const IRNode *a, const IRNode *b);
 
     CmpResult compare_names(const std::string &a, const std::string &b);
     CmpResult compare_types(Type a, Type b);
@@ -130,11 +144,9 @@ IRComparer::CmpResult IRComparer::compare_expr(const Expr &a, const Expr &b) {
         return result;
     }
 
-    // If in the future we have hashes for Exprs, this is a good place
-    // to compare the hashes:
-    // if (compare_scalar(a.hash(), b.hash()) != Equal) {
-    //   return result;
-    // }
+    if (compare_hashes(a.get(), b.get()) != Equal) {
+        return result;
+    }
 
     if (compare_scalar(a->node_type, b->node_type) != Equal) {
         return result;
@@ -185,6 +197,10 @@ IRComparer::CmpResult IRComparer::compare_stmt(const Stmt &a, const Stmt &b) {
         return result;
     }
 
+    if (compare_hashes(a.get(), b.get()) != Equal) {
+        return result;
+    }
+
     if (compare_scalar(a->node_type, b->node_type) != Equal) {
         return result;
     }
@@ -195,6 +211,20 @@ IRComparer::CmpResult IRComparer::compare_stmt(const Stmt &a, const Stmt &b) {
     return result;
 }
 
+IRComparer::CmpResult IRComparer::compare_hashes(const IRNode *a, const IRNode *b) {
+    if (result != Equal || !equality_only) return result;
+
+    // Only use hashes that have already been computed. Computing
+    // them here would cost more than most comparisons.
+    uint64_t ha = a->structural_hash.load(std::memory_order_relaxed);
+    uint64_t hb = b->structural_hash.load(std::memory_order_relaxed);
+    if (ha != 0 && hb != 0) {
+        compare_scalar(ha, hb);
+    }
+
+    return result;
+}
+
 IRComparer::CmpResult IRComparer::compare_types(Type a, Type b) {
     if (result != Equal) return result;
 
@@ -462,26 +492,301 @@ void IRComparer::visit(const Prefetch *op) {
     }
 }
 
+/** The class that computes the hash of one IR node from its fields
+ * and the hashes of its children. It must hash (a subset of) the
+ * fields that IRComparer compares. */
+class StructuralHasher : public IRVisitor {
+public:
+    uint64_t hash;
+
+    StructuralHasher() : hash(0) {}
+
+    void mix(uint64_t v) {
+        hash ^= v + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+    }
+
+    void mix(const string &s) {
+        // FNV-1a, so that hashes don't depend on the standard library.
+        uint64_t h = 0xcbf29ce484222325ULL;
+        for (char c : s) {
+            h = (h ^ (uint8_t)c) * 0x100000001b3ULL;
+        }
+        mix(h);
+    }
+
+    void mix(const Expr &e) {
+        mix(structural_hash(e));
+    }
+
+    void mix(const Stmt &s) {
+        mix(structural_hash(s));
+    }
+
+    void mix(const vector<Expr> &v) {
+        mix((uint64_t)v.size());
+        for (const Expr &e : v) {
+            mix(e);
+        }
+    }
+
+    // The handle type is compared by address, which changes from run
+    // to run, so it is left out of the hash.
+    void mix(Type t) {
+        mix((uint64_t)t.code());
+        mix((uint64_t)t.bits());
+        mix((uint64_t)t.lanes());
+    }
+
+private:
+    template<typename T>
+    void visit_binary_operator(const T *op) {
+        mix(op->a);
+        mix(op->b);
+    }
+
+    void visit(const IntImm *op) override {
+        mix((uint64_t)op->value);
+    }
+
+    void visit(const UIntImm *op) override {
+        mix(op->value);
+    }
+
+    void visit(const FloatImm *op) override {
+        // -0.0 and 0.0 compare equal, and so must hash equal. NaNs
+        // aren't ordered, so any hash will do.
+        double value = op->value == 0 ? 0.0 : op->value;
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        mix(bits);
+    }
+
+    void visit(const StringImm *op) override {
+        mix(op->value);
+    }
+
+    void visit(const Cast *op) override {
+        mix(op->value);
+    }
+
+    void visit(const Variable *op) override {
+        mix(op->name);
+    }
+
+    void visit(const Add *op) override {visit_binary_operator(op);}
+    void visit(const Sub *op) override {visit_binary_operator(op);}
+    void visit(const Mul *op) override {visit_binary_operator(op);}
+    void visit(const Div *op) override {visit_binary_operator(op);}
+    void visit(const Mod *op) override {visit_binary_operator(op);}
+    void visit(const Min *op) override {visit_binary_operator(op);}
+    void visit(const Max *op) override {visit_binary_operator(op);}
+    void visit(const EQ *op) override {visit_binary_operator(op);}
+    void visit(const NE *op) override {visit_binary_operator(op);}
+    void visit(const LT *op) override {visit_binary_operator(op);}
+    void visit(const LE *op) override {visit_binary_operator(op);}
+    void visit(const GT *op) override {visit_binary_operator(op);}
+    void visit(const GE *op) override {visit_binary_operator(op);}
+    void visit(const And *op) override {visit_binary_operator(op);}
+    void visit(const Or *op) override {visit_binary_operator(op);}
+
+    void visit(const Not *op) override {
+        mix(op->a);
+    }
+
+    void visit(const Select *op) override {
+        mix(op->condition);
+        mix(op->true_value);
+        mix(op->false_value);
+    }
+
+    void visit(const Load *op) override {
+        mix(op->name);
+        mix(op->predicate);
+        mix(op->index);
+    }
+
+    void visit(const Ramp *op) override {
+        mix(op->base);
+        mix(op->stride);
+    }
+
+    void visit(const Broadcast *op) override {
+        mix(op->value);
+    }
+
+    void visit(const Call *op) override {
+        mix(op->name);
+        mix((uint64_t)op->call_type);
+        mix((uint64_t)op->value_index);
+        mix(op->args);
+    }
+
+    void visit(const Let *op) override {
+        mix(op->name);
+        mix(op->value);
+        mix(op->body);
+    }
+
+    void visit(const LetStmt *op) override {
+        mix(op->name);
+        mix(op->value);
+        mix(op->body);
+    }
+
+    void visit(const AssertStmt *op) override {
+        mix(op->condition);
+        mix(op->message);
+    }
+
+    void visit(const ProducerConsumer *op) override {
+        mix(op->name);
+        mix((uint64_t)op->is_producer);
+        mix(op->body);
+    }
+
+    void visit(const For *op) override {
+        mix(op->name);
+        mix((uint64_t)op->for_type);
+        mix(op->min);
+        mix(op->extent);
+        mix(op->body);
+    }
+
+    void visit(const Store *op) override {
+        mix(op->name);
+        mix(op->predicate);
+        mix(op->value);
+        mix(op->index);
+    }
+
+    void visit(const Provide *op) override {
+        mix(op->name);
+        mix(op->args);
+        mix(op->values);
+    }
+
+    void visit(const Allocate *op) override {
+        mix(op->name);
+        mix(op->extents);
+        mix(op->body);
+        mix(op->condition);
+        mix(op->new_expr);
+        mix(op->free_function);
+    }
+
+    void visit(const Free *op) override {
+        mix(op->name);
+    }
+
+    void visit(const Realize *op) override {
+        mix(op->name);
+        mix((uint64_t)op->types.size());
+        for (Type t : op->types) {
+            mix(t);
+        }
+        mix((uint64_t)op->bounds.size());
+        for (const Range &r : op->bounds) {
+            mix(r.min);
+            mix(r.extent);
+        }
+        mix(op->body);
+        mix(op->condition);
+    }
+
+    void visit(const Prefetch *op) override {
+        mix(op->name);
+        mix((uint64_t)op->bounds.size());
+        for (const Range &r : op->bounds) {
+            mix(r.min);
+            mix(r.extent);
+        }
+    }
+
+    void visit(const Block *op) override {
+        mix(op->first);
+        mix(op->rest);
+    }
+
+    void visit(const IfThenElse *op) override {
+        mix(op->condition);
+        mix(op->then_case);
+        mix(op->else_case);
+    }
+
+    void visit(const Evaluate *op) override {
+        mix(op->value);
+    }
+
+    void visit(const Shuffle *op) override {
+        mix(op->vectors);
+        mix((uint64_t)op->indices.size());
+        for (int i : op->indices) {
+            mix((uint64_t)i);
+        }
+    }
+};
+
+// Compute the hash of a node, if it isn't cached already.
+uint64_t hash_node(const IRNode *n, const Type *type) {
+    uint64_t hash = n->structural_hash.load(std::memory_order_relaxed);
+    if (hash == 0) {
+        StructuralHasher hasher;
+        hasher.mix((uint64_t)n->node_type);
+        if (type) {
+            hasher.mix(*type);
+        }
+        n->accept(&hasher);
+        // Zero means not computed yet.
+        hash = hasher.hash ? hasher.hash : 1;
+        // Other threads may be computing it at the same time, but
+        // they will all get the same result.
+        n->structural_hash.store(hash, std::memory_order_relaxed);
+    }
+    return hash;
+}
+
 } // namespace
 
+uint64_t structural_hash(const Expr &e) {
+    if (!e.defined()) {
+        return 0;
+    }
+    Type t = e.type();
+    return hash_node(e.get(), &t);
+}
+
+uint64_t structural_hash(const Stmt &s) {
+    if (!s.defined()) {
+        return 0;
+    }
+    return hash_node(s.get(), nullptr);
+}
 
 // Now the methods exposed in the header.
 bool equal(const Expr &a, const Expr &b) {
-    return IRComparer().compare_expr(a, b) == IRComparer::Equal;
+    return IRComparer::equality().compare_expr(a, b) == IRComparer::Equal;
 }
 
 bool graph_equal(const Expr &a, const Expr &b) {
     IRCompareCache cache(8);
-    return IRComparer(&cache).compare_expr(a, b) == IRComparer::Equal;
+    return IRComparer::equality(&cache).compare_expr(a, b) == IRComparer::Equal;
 }
 
 bool equal(const Stmt &a, const Stmt &b) {
-    return IRComparer().compare_stmt(a, b) == IRComparer::Equal;
+    return IRComparer::equality().compare_stmt(a, b) == IRComparer::Equal;
 }
 
 bool graph_equal(const Stmt &a, const Stmt &b) {
     IRCompareCache cache(8);
-    return IRComparer(&cache).compare_stmt(a, b) == IRComparer::Equal;
+    return IRComparer::equality(&cache).compare_stmt(a, b) == IRComparer::Equal;
+}
+
+bool IRDeepEqual::operator()(const Expr &a, const Expr &b) const {
+    return equal(a, b);
+}
+
+bool IRDeepEqual::operator()(const Stmt &a, const Stmt &b) const {
+    return equal(a, b);
 }
 
 bool IRDeepCompare::operator()(const Expr &a, const Expr &b) const {
@@ -502,6 +807,12 @@ bool ExprWithCompareCache::operator<(const ExprWithCompareCache &other) const {
     return cmp.result == IRComparer::LessThan;
 }
 
+bool ExprWithCompareCache::operator==(const ExprWithCompareCache &other) const {
+    IRComparer cmp = IRComparer::equality(cache);
+    cmp.compare_expr(expr, other.expr);
+    return cmp.result == IRComparer::Equal;
+}
+
 // Testing code
 namespace {
 
@@ -560,6 +871,18 @@ void ir_equality_test() {
     e2 = e2*e2 + e2;
     check_not_equal(e1, e2);
 
+    // Hashing must also only visit each node once, and equal values
+    // must have equal hashes.
+    Expr e3 = x;
+    for (int i = 0; i < 101; i++) {
+        e3 = e3*e3 + e3;
+    }
+    internal_assert(structural_hash(e2) == structural_hash(e3));
+    internal_assert(structural_hash(e1) != structural_hash(e2));
+    internal_assert(equal(e2, e3) && !equal(e1, e2));
+    internal_assert(structural_hash(FloatImm::make(Float(32), 0.0)) ==
+                    structural_hash(FloatImm::make(Float(32), -0.0)));
+
     debug(0) << "ir_equality_test passed\n";
 }
 
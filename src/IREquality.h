@@ -17,6 +17,36 @@ struct IRDeepCompare {
     bool operator()(const Stmt &a, const Stmt &b) const;
 };
 
+/** Compute a hash of the value of an Expr or Stmt, such that any two
+ * equal() IR nodes have the same hash. The hash of each node is
+ * cached in the node, so hashing a node again, or hashing a larger
+ * expression that contains it, only costs the work on the new nodes,
+ * and IR graphs with many shared subexpressions are hashed in linear
+ * time. Hashes are deterministic across runs. */
+// @{
+uint64_t structural_hash(const Expr &e);
+uint64_t structural_hash(const Stmt &s);
+// @}
+
+/** Hash and equality functors on the values of IR nodes, for use
+ * in unordered containers, e.g.
+ * std::unordered_map<Expr, int, IRDeepHash, IRDeepEqual>. */
+// @{
+struct IRDeepHash {
+    size_t operator()(const Expr &e) const {
+        return (size_t)structural_hash(e);
+    }
+    size_t operator()(const Stmt &s) const {
+        return (size_t)structural_hash(s);
+    }
+};
+
+struct IRDeepEqual {
+    bool operator()(const Expr &a, const Expr &b) const;
+    bool operator()(const Stmt &a, const Stmt &b) const;
+};
+// @}
+
 /** Lossily track known equal exprs with a cache. On collision, the
  * old pair is evicted. Used below by ExprWithCompareCache. */
 class IRCompareCache {
@@ -99,6 +129,16 @@ struct ExprWithCompareCache {
 
     /** The comparison uses (and updates) the cache */
     bool operator<(const ExprWithCompareCache &other) const;
+
+    /** Equality also uses the cache. Together with Hash, this
+     * lets these be used as keys of unordered containers. */
+    bool operator==(const ExprWithCompareCache &other) const;
+
+    struct Hash {
+        size_t operator()(const ExprWithCompareCache &e) const {
+            return (size_t)structural_hash(e.expr);
+        }
+    };
 };
 
 /** Compare IR nodes for equality of value. Traverses entire IR
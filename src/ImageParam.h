@@ -19,8 +19,9 @@ template<typename T2> class GeneratorInput_Buffer;
 /** An Image parameter to a halide pipeline. E.g., the input image. */
 class ImageParam : public OutputImageParam {
     template<typename T2> friend class ::Halide::Internal::GeneratorInput_Buffer;
+    friend class Pipeline;
 
-    // Only for use of Generator
+    // Only for use of Generator and Pipeline
     ImageParam(const Internal::Parameter &p, Func f) : OutputImageParam(p, Argument::InputBuffer, f) {}
 
     /** Helper function to initialize the Func representation of this ImageParam. */
@@ -1,19 +1,28 @@
 #include <string>
 #include <stdint.h>
+#include <fstream>
+#include <functional>
+#include <limits>
 #include <mutex>
 #include <set>
+#include <sstream>
 
 #ifndef _WIN32
 #include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #endif
 
 #include "CodeGen_Internal.h"
+#include "CompileTimeProfiler.h"
 #include "JITModule.h"
 #include "LLVM_Headers.h"
 #include "LLVM_Runtime_Linker.h"
 #include "Debug.h"
 #include "LLVM_Output.h"
 #include "CodeGen_LLVM.h"
+#include "IRMutator.h"
+#include "IRPrinter.h"
 #include "Pipeline.h"
 
 
@@ -160,7 +169,8 @@ JITModule::Symbol compile_and_get_function(ExecutionEngine &ee, const string &na
         internal_error << "Compiling " << name << " returned nullptr\n";
     }
 
-    JITModule::Symbol symbol(f, fn->getFunctionType());
+    // Modules loaded from the object cache don't contain the function.
+    JITModule::Symbol symbol(f, fn ? fn->getFunctionType() : nullptr);
 
     debug(2) << "Function " << name << " is at " << f << "\n";
 
@@ -233,6 +243,435 @@ public:
     }
 };
 
+// The directory of the object cache, and its statistics.
+struct ObjectCacheState {
+    std::mutex mutex;
+    string dir;
+    JITObjectCacheStats stats;
+
+    ObjectCacheState() : dir(get_env_variable("HL_JIT_CACHE_DIR")) {}
+};
+
+ObjectCacheState &object_cache_state() {
+    static ObjectCacheState state;
+    return state;
+}
+
+// Hands MCJIT the object code loaded from the cache directory, if
+// any, and keeps the object code that MCJIT compiles otherwise.
+class HalideJITObjectCache : public llvm::ObjectCache {
+public:
+    std::unique_ptr<llvm::MemoryBuffer> cached;
+    string compiled;
+
+    void notifyObjectCompiled(const llvm::Module *, llvm::MemoryBufferRef object) override {
+        compiled.assign(object.getBufferStart(), object.getBufferSize());
+    }
+
+    std::unique_ptr<llvm::MemoryBuffer> getObject(const llvm::Module *) override {
+        return std::move(cached);
+    }
+};
+
+// Prints the IR with the types that the IRPrinter leaves out, and
+// with enough digits to tell floating point constants apart, so that
+// two lowered modules only print the same way if they compile to the
+// same code.
+class ObjectCacheKeyPrinter : public IRPrinter {
+    using IRPrinter::visit;
+
+    void visit(const Variable *op) override {
+        stream << op->type << " ";
+        IRPrinter::visit(op);
+    }
+
+    void visit(const Load *op) override {
+        stream << op->type << " ";
+        IRPrinter::visit(op);
+    }
+
+    void visit(const Call *op) override {
+        stream << op->type << " " << (int)op->call_type << " ";
+        IRPrinter::visit(op);
+    }
+
+public:
+    ObjectCacheKeyPrinter(std::ostream &s) : IRPrinter(s) {
+        s.precision(std::numeric_limits<double>::max_digits10);
+    }
+};
+
+// Rename everything the lowered IR defines by the order in which it
+// is defined, so that the names generated by unique_name, which depend
+// on everything compiled before in the process, don't make the object
+// cache key differ. Names defined elsewhere, such as the arguments,
+// extern functions and the strings in error messages, are kept.
+class CanonicalizeNames : public IRMutator {
+    using IRMutator::visit;
+
+    std::map<string, string> names;
+
+    string define(const string &name) {
+        auto it = names.find(name);
+        if (it == names.end()) {
+            it = names.emplace(name, "%" + std::to_string(names.size())).first;
+        }
+        return it->second;
+    }
+
+    string rename(const string &name) const {
+        auto it = names.find(name);
+        return it == names.end() ? name : it->second;
+    }
+
+    void visit(const Variable *op) override {
+        expr = Variable::make(op->type, rename(op->name), op->image, op->param, op->reduction_domain);
+    }
+
+    void visit(const Load *op) override {
+        Expr index = mutate(op->index), predicate = mutate(op->predicate);
+        expr = Load::make(op->type, rename(op->name), index, op->image, op->param, predicate);
+    }
+
+    void visit(const Let *op) override {
+        string name = define(op->name);
+        Expr value = mutate(op->value), body = mutate(op->body);
+        expr = Let::make(name, value, body);
+    }
+
+    void visit(const LetStmt *op) override {
+        string name = define(op->name);
+        Expr value = mutate(op->value);
+        Stmt body = mutate(op->body);
+        stmt = LetStmt::make(name, value, body);
+    }
+
+    void visit(const For *op) override {
+        string name = define(op->name);
+        Expr min = mutate(op->min), extent = mutate(op->extent);
+        Stmt body = mutate(op->body);
+        stmt = For::make(name, min, extent, op->for_type, op->device_api, body);
+    }
+
+    void visit(const Allocate *op) override {
+        string name = define(op->name);
+        std::vector<Expr> extents;
+        for (const Expr &e : op->extents) {
+            extents.push_back(mutate(e));
+        }
+        Expr condition = mutate(op->condition);
+        Expr new_expr = op->new_expr.defined() ? mutate(op->new_expr) : Expr();
+        Stmt body = mutate(op->body);
+        stmt = Allocate::make(name, op->type, op->memory_type, extents, condition, body,
+                              new_expr, op->free_function);
+    }
+
+    void visit(const Free *op) override {
+        stmt = Free::make(rename(op->name));
+    }
+
+    void visit(const Store *op) override {
+        Expr value = mutate(op->value), index = mutate(op->index), predicate = mutate(op->predicate);
+        stmt = Store::make(rename(op->name), value, index, op->param, predicate);
+    }
+
+    void visit(const ProducerConsumer *op) override {
+        Stmt body = mutate(op->body);
+        stmt = ProducerConsumer::make(rename(op->name), op->is_producer, body);
+    }
+};
+
+void print_object_cache_key(std::ostream &s, const Module &m) {
+    for (const Module &sub : m.submodules()) {
+        print_object_cache_key(s, sub);
+    }
+
+    ObjectCacheKeyPrinter printer(s);
+    s << "module " << m.name() << " " << m.target().to_string() << "\n";
+    for (const Buffer<> &b : m.buffers()) {
+        s << "buffer " << b.name() << " " << b.type();
+        for (int i = 0; i < b.dimensions(); i++) {
+            s << " " << b.dim(i).min() << " " << b.dim(i).extent() << " " << b.dim(i).stride();
+        }
+        s << "\n";
+        if (b.data()) {
+            s.write((const char *)b.data(), b.size_in_bytes());
+        }
+        s << "\n";
+    }
+    for (const ExternalCode &c : m.external_code()) {
+        s << "external_code " << c.name() << "\n";
+        s.write((const char *)c.contents().data(), c.contents().size());
+        s << "\n";
+    }
+    for (const LoweredFunc &f : m.functions()) {
+        s << f.linkage << " func " << f.name << " " << (int)f.name_mangling << "\n";
+        for (const LoweredArgument &arg : f.args) {
+            s << "arg " << arg.name << " " << (int)arg.kind << " " << arg.type << " "
+              << (int)arg.dimensions << " " << arg.alignment.modulus << " " << arg.alignment.remainder;
+            for (const Expr &e : {arg.def, arg.min, arg.max}) {
+                s << " ";
+                if (e.defined()) {
+                    printer.print(e);
+                }
+            }
+            s << "\n";
+        }
+        printer.print(CanonicalizeNames().mutate(f.body));
+    }
+}
+
+// Identify the build of Halide by the file it was loaded from, so
+// that rebuilding Halide invalidates the object cache.
+string halide_build_id() {
+#ifndef _WIN32
+    Dl_info info;
+    struct stat st;
+    if (dladdr((void *)&halide_build_id, &info) && info.dli_fname &&
+        stat(info.dli_fname, &st) == 0) {
+        return string(info.dli_fname) + " " + std::to_string((long long)st.st_size) +
+            " " + std::to_string((long long)st.st_mtime);
+    }
+#endif
+    return "";
+}
+
+// Get the directory of the object cache, or the empty string if it is
+// disabled.
+string object_cache_dir() {
+    ObjectCacheState &state = object_cache_state();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    return state.dir;
+}
+
+// Get the name of the file in 'dir' caching the object code described
+// by 'key'. The key is extended with the build of Halide and LLVM.
+string object_cache_file(const string &dir, const string &name, const string &key) {
+    std::ostringstream full_key;
+    full_key << "halide " << halide_build_id() << "\n"
+             << "llvm " << LLVM_VERSION_STRING << "\n"
+             << "llvm_args " << get_env_variable("HL_LLVM_ARGS") << "\n"
+             << key;
+
+    // 64-bit FNV-1a
+    uint64_t h = 14695981039346656037ULL;
+    for (char c : full_key.str()) {
+        h = (h ^ (uint8_t)c) * 1099511628211ULL;
+    }
+    std::ostringstream filename;
+    filename << dir << "/";
+    for (char c : name) {
+        filename << (isalnum(c) ? c : '_');
+    }
+    filename << "_" << std::hex << h << ".o";
+    return filename.str();
+}
+
+// The object code of a module, with the target options to load it
+// with, and what to export and run from it.
+struct CachedObject {
+    string triple, data_layout, mcpu, mattrs;
+    bool use_soft_float_abi = false;
+    std::vector<string> exports;
+    std::vector<std::pair<int, string>> constructors, destructors;
+    string object;
+};
+
+// Get the static constructors or destructors of a module. Make them
+// visible in its object code, so that they can still be found when the
+// object code is loaded from the cache.
+std::vector<std::pair<int, string>> get_static_initializers(llvm::Module &module, const char *name) {
+    std::vector<std::pair<int, string>> result;
+    llvm::GlobalVariable *gv = module.getNamedGlobal(name);
+    if (!gv || !gv->hasInitializer()) {
+        return result;
+    }
+    llvm::ConstantArray *init = llvm::dyn_cast<llvm::ConstantArray>(gv->getInitializer());
+    if (!init) {
+        return result;
+    }
+    for (llvm::Value *op : init->operands()) {
+        llvm::ConstantStruct *entry = llvm::dyn_cast<llvm::ConstantStruct>(op);
+        internal_assert(entry) << "Unexpected entry in " << name << "\n";
+        llvm::Function *f = llvm::dyn_cast<llvm::Function>(entry->getOperand(1)->stripPointerCasts());
+        internal_assert(f) << "Unexpected entry in " << name << "\n";
+        if (f->hasLocalLinkage()) {
+            f->setLinkage(llvm::GlobalValue::ExternalLinkage);
+        }
+        int priority = (int)llvm::cast<llvm::ConstantInt>(entry->getOperand(0))->getSExtValue();
+        result.push_back({priority, f->getName().str()});
+    }
+    return result;
+}
+
+// Describe the target options and static initializers of a module
+// that is about to be compiled and added to the object cache.
+CachedObject describe_module(llvm::Module &module) {
+    CachedObject cached;
+    llvm::TargetOptions options;
+    get_target_options(module, options, cached.mcpu, cached.mattrs);
+    cached.triple = module.getTargetTriple();
+    cached.data_layout = module.getDataLayout().getStringRepresentation();
+    cached.use_soft_float_abi = options.FloatABIType == llvm::FloatABI::Soft;
+    cached.constructors = get_static_initializers(module, "llvm.global_ctors");
+    cached.destructors = get_static_initializers(module, "llvm.global_dtors");
+    return cached;
+}
+
+const char *cached_object_magic = "halide_jit_object 2";
+
+bool read_cached_object(const string &filename, CachedObject &cached) {
+    std::ifstream f(filename, std::ios::binary);
+    string magic;
+    if (!std::getline(f, magic) || magic != cached_object_magic) {
+        return false;
+    }
+    std::getline(f, cached.triple);
+    std::getline(f, cached.data_layout);
+    std::getline(f, cached.mcpu);
+    std::getline(f, cached.mattrs);
+    f >> cached.use_soft_float_abi;
+
+    string tag;
+    size_t count = 0;
+    f >> tag >> count;
+    if (!f || tag != "exports") {
+        return false;
+    }
+    cached.exports.resize(count);
+    for (string &e : cached.exports) {
+        f >> e;
+    }
+    for (auto *initializers : {&cached.constructors, &cached.destructors}) {
+        f >> tag >> count;
+        if (!f || (tag != "constructors" && tag != "destructors")) {
+            return false;
+        }
+        initializers->resize(count);
+        for (auto &i : *initializers) {
+            f >> i.first >> i.second;
+        }
+    }
+
+    size_t size = 0;
+    f >> tag >> size;
+    f.get();
+    if (!f || tag != "object" || size == 0) {
+        return false;
+    }
+    cached.object.resize(size);
+    f.read(&cached.object[0], size);
+    return (bool)f;
+}
+
+void write_cached_object(const string &filename, const CachedObject &cached) {
+    // Write to a temporary file first, so that other processes never
+    // read a partially written object.
+#ifdef _WIN32
+    string tmp = filename + "." + std::to_string((long long)GetCurrentProcessId()) + ".tmp";
+#else
+    string tmp = filename + "." + std::to_string((long long)getpid()) + ".tmp";
+#endif
+    {
+        std::ofstream f(tmp, std::ios::binary);
+        f << cached_object_magic << "\n"
+          << cached.triple << "\n"
+          << cached.data_layout << "\n"
+          << cached.mcpu << "\n"
+          << cached.mattrs << "\n"
+          << cached.use_soft_float_abi << "\n"
+          << "exports " << cached.exports.size() << "\n";
+        for (const string &e : cached.exports) {
+            f << e << "\n";
+        }
+        f << "constructors " << cached.constructors.size() << "\n";
+        for (const auto &i : cached.constructors) {
+            f << i.first << " " << i.second << "\n";
+        }
+        f << "destructors " << cached.destructors.size() << "\n";
+        for (const auto &i : cached.destructors) {
+            f << i.first << " " << i.second << "\n";
+        }
+        f << "object " << cached.object.size() << "\n";
+        f.write(cached.object.data(), cached.object.size());
+        if (!f) {
+            debug(1) << "Could not write " << tmp << " to the JIT object cache\n";
+            return;
+        }
+    }
+    if (std::rename(tmp.c_str(), filename.c_str()) != 0) {
+        debug(1) << "Could not add " << filename << " to the JIT object cache\n";
+        file_unlink(tmp);
+    }
+}
+
+// Make a module without any code, that only carries the target
+// options and the static constructors and destructors of a cached
+// object.
+std::unique_ptr<llvm::Module> make_cached_module(const string &name, const CachedObject &cached,
+                                                 llvm::LLVMContext &context) {
+    std::unique_ptr<llvm::Module> module(new llvm::Module(name, context));
+    module->setTargetTriple(cached.triple);
+    module->setDataLayout(cached.data_layout);
+    module->addModuleFlag(llvm::Module::Warning, "halide_use_soft_float_abi", cached.use_soft_float_abi ? 1 : 0);
+    module->addModuleFlag(llvm::Module::Warning, "halide_mcpu", llvm::MDString::get(context, cached.mcpu));
+    module->addModuleFlag(llvm::Module::Warning, "halide_mattrs", llvm::MDString::get(context, cached.mattrs));
+
+    llvm::FunctionType *void_fn = llvm::FunctionType::get(llvm::Type::getVoidTy(context), false);
+    for (const auto &i : cached.constructors) {
+        llvm::Function *f = llvm::Function::Create(void_fn, llvm::GlobalValue::ExternalLinkage, i.second, module.get());
+        llvm::appendToGlobalCtors(*module, f, i.first);
+    }
+    for (const auto &i : cached.destructors) {
+        llvm::Function *f = llvm::Function::Create(void_fn, llvm::GlobalValue::ExternalLinkage, i.second, module.get());
+        llvm::appendToGlobalDtors(*module, f, i.first);
+    }
+    return module;
+}
+
+// Look the object code of a module up in the object cache, or prepare
+// to add it. If the object code is in the cache, return a module
+// without any code to compile instead of calling 'make_module', and
+// hand the object code to MCJIT through 'object_cache'. Return whether
+// the object code was found.
+bool use_object_cache(const string &cache_file, const string &name,
+                      std::function<std::unique_ptr<llvm::Module>()> make_module,
+                      llvm::LLVMContext &context, HalideJITObjectCache &object_cache,
+                      std::unique_ptr<llvm::Module> &module, CachedObject &cached) {
+    if (!cache_file.empty() && read_cached_object(cache_file, cached)) {
+        debug(1) << "Loading " << name << " from the JIT object cache " << cache_file << "\n";
+        module = make_cached_module(name, cached, context);
+        object_cache.cached = llvm::MemoryBuffer::getMemBufferCopy(cached.object, name);
+        return true;
+    }
+    module = make_module();
+    if (!cache_file.empty()) {
+        cached = describe_module(*module);
+    }
+    return false;
+}
+
+// Add the object code MCJIT compiled to the object cache, and count the
+// hit or miss.
+void update_object_cache(const string &cache_file, bool hit, bool runtime,
+                         const HalideJITObjectCache &object_cache, CachedObject &cached) {
+    if (cache_file.empty()) {
+        return;
+    }
+    if (!hit) {
+        internal_assert(!object_cache.compiled.empty()) << "MCJIT did not hand over the object code for " << cache_file << "\n";
+        cached.object = object_cache.compiled;
+        write_cached_object(cache_file, cached);
+    }
+    ObjectCacheState &state = object_cache_state();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    if (runtime) {
+        (hit ? state.stats.runtime_hits : state.stats.runtime_misses)++;
+    } else {
+        (hit ? state.stats.hits : state.stats.misses)++;
+    }
+}
+
 }
 
 JITModule::JITModule() {
@@ -242,16 +681,35 @@ JITModule::JITModule() {
 JITModule::JITModule(const Module &m, const LoweredFunc &fn,
                      const std::vector<JITModule> &dependencies) {
     jit_module = new JITModuleContents();
-    std::unique_ptr<llvm::Module> llvm_module(compile_module_to_llvm_module(m, jit_module->context));
+
+    string cache_file, dir = object_cache_dir();
+    if (!dir.empty()) {
+        std::ostringstream key;
+        print_object_cache_key(key, m);
+        cache_file = object_cache_file(dir, m.name(), key.str());
+    }
+
+    // If the object code of the module is in the object cache, skip
+    // the code generation entirely.
+    HalideJITObjectCache object_cache;
+    CachedObject cached;
+    std::unique_ptr<llvm::Module> llvm_module;
+    bool hit = use_object_cache(cache_file, fn.name,
+                                [&]() { return compile_module_to_llvm_module(m, jit_module->context); },
+                                jit_module->context, object_cache, llvm_module, cached);
+
     std::vector<JITModule> deps_with_runtime = dependencies;
     std::vector<JITModule> shared_runtime = JITSharedRuntime::get(llvm_module.get(), m.target());
     deps_with_runtime.insert(deps_with_runtime.end(), shared_runtime.begin(), shared_runtime.end());
-    compile_module(std::move(llvm_module), fn.name, m.target(), deps_with_runtime);
+    compile_module(std::move(llvm_module), fn.name, m.target(), deps_with_runtime,
+                   std::vector<string>(), cache_file.empty() ? nullptr : &object_cache);
+    update_object_cache(cache_file, hit, false, object_cache, cached);
 }
 
 void JITModule::compile_module(std::unique_ptr<llvm::Module> m, const string &function_name, const Target &target,
                                const std::vector<JITModule> &dependencies,
-                               const std::vector<std::string> &requested_exports) {
+                               const std::vector<std::string> &requested_exports,
+                               llvm::ObjectCache *object_cache) {
 
     // Ensure that LLVM is initialized
     CodeGen_LLVM::initialize_llvm();
@@ -268,6 +726,7 @@ void JITModule::compile_module(std::unique_ptr<llvm::Module> m, const string &fu
 
     DataLayout initial_module_data_layout = m->getDataLayout();
     string module_name = m->getModuleIdentifier();
+    const llvm::Module &module = *m;
 
     llvm::EngineBuilder engine_builder((std::move(m)));
     engine_builder.setTargetOptions(options);
@@ -297,6 +756,10 @@ void JITModule::compile_module(std::unique_ptr<llvm::Module> m, const string &fu
     if (!ee) std::cerr << error_string << "\n";
     internal_assert(ee) << "Couldn't create execution engine\n";
 
+    if (object_cache) {
+        ee->setObjectCache(object_cache);
+    }
+
     // Do any target-specific initialization
     std::vector<llvm::JITEventListener *> listeners;
 
@@ -316,6 +779,16 @@ void JITModule::compile_module(std::unique_ptr<llvm::Module> m, const string &fu
 
     std::map<std::string, Symbol> exports;
 
+    // The execution engine owns the module from here on.
+    LLVMPassTimer timer("LLVM JIT code generation", module);
+
+    if (object_cache) {
+        // A module loaded from the object cache doesn't define the
+        // functions, so MCJIT won't load it when asked for them. Load
+        // (or compile) it up front instead.
+        ee->finalizeObject();
+    }
+
     Symbol entrypoint;
     Symbol argv_entrypoint;
     if (!function_name.empty()) {
@@ -332,6 +805,8 @@ void JITModule::compile_module(std::unique_ptr<llvm::Module> m, const string &fu
     debug(2) << "Finalizing object\n";
     ee->finalizeObject();
     memory_manager->work_around_llvm_bugs();
+    ee->setObjectCache(nullptr);
+    timer.stop();
 
     // Do any target-specific post-compilation module meddling
     for (size_t i = 0; i < listeners.size(); i++) {
@@ -457,8 +932,24 @@ bool JITModule::compiled() const {
   return jit_module->execution_engine != nullptr;
 }
 
+void JITModule::set_object_cache_directory(const std::string &dir) {
+    ObjectCacheState &state = object_cache_state();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.dir = dir;
+    state.stats = JITObjectCacheStats();
+}
+
+JITObjectCacheStats JITModule::object_cache_stats() {
+    ObjectCacheState &state = object_cache_state();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    return state.stats;
+}
+
 namespace {
 
+// Guards the handlers below, so that pipelines can be run while
+// others are compiled, and their runtime made, on other threads.
+std::mutex handlers_mutex;
 JITHandlers runtime_internal_handlers;
 JITHandlers default_handlers;
 JITHandlers active_handlers;
@@ -681,29 +1172,65 @@ JITModule &make_module(llvm::Module *for_module, Target target,
             break;
         }
 
-        // This function is protected by a mutex so this is thread safe.
-        std::unique_ptr<llvm::Module> module(get_initial_module_for_target(one_gpu,
-            &runtime.jit_module->context, true, runtime_kind != MainShared));
-        if (for_module) {
-            clone_target_options(*for_module, *module);
+        // The runtime depends on the target, and on the target options
+        // of the module it is made for.
+        string cache_file, dir = object_cache_dir();
+        if (!dir.empty()) {
+            std::ostringstream key;
+            key << "runtime " << module_name << " " << one_gpu.to_string() << "\n";
+            if (for_module) {
+                llvm::TargetOptions options;
+                string mcpu, mattrs;
+                get_target_options(*for_module, options, mcpu, mattrs);
+                key << for_module->getTargetTriple() << "\n"
+                    << mcpu << "\n"
+                    << mattrs << "\n"
+                    << (options.FloatABIType == llvm::FloatABI::Soft) << "\n";
+            }
+            cache_file = object_cache_file(dir, "halide_runtime_" + module_name, key.str());
         }
-        module->setModuleIdentifier(module_name);
 
-        std::set<std::string> halide_exports_unique;
+        // If the runtime is in the object cache, skip loading and
+        // compiling its bitcode entirely.
+        HalideJITObjectCache object_cache;
+        CachedObject cached;
+        std::unique_ptr<llvm::Module> module;
+        bool hit = use_object_cache(cache_file, module_name, [&]() {
+                // This function is protected by a mutex so this is thread safe.
+                std::unique_ptr<llvm::Module> module(get_initial_module_for_target(one_gpu,
+                    &runtime.jit_module->context, true, runtime_kind != MainShared));
+                if (for_module) {
+                    clone_target_options(*for_module, *module);
+                }
+                return module;
+            }, runtime.jit_module->context, object_cache, module, cached);
+        module->setModuleIdentifier(module_name);
 
-        // Enumerate the functions.
-        for (auto &f : *module) {
-            // LLVM_Runtime_Linker has marked everything that should be exported as weak
-            if (f.hasWeakLinkage()) {
-                halide_exports_unique.insert(f.getName());
+        std::vector<std::string> halide_exports;
+        if (hit) {
+            halide_exports = cached.exports;
+        } else {
+            std::set<std::string> halide_exports_unique;
+
+            // Enumerate the functions.
+            for (auto &f : *module) {
+                // LLVM_Runtime_Linker has marked everything that should be exported as weak
+                if (f.hasWeakLinkage()) {
+                    halide_exports_unique.insert(f.getName());
+                }
             }
-        }
 
-        std::vector<std::string> halide_exports(halide_exports_unique.begin(), halide_exports_unique.end());
+            halide_exports.assign(halide_exports_unique.begin(), halide_exports_unique.end());
+            cached.exports = halide_exports;
+        }
 
-        runtime.compile_module(std::move(module), "", target, deps, halide_exports);
+        runtime.compile_module(std::move(module), "", target, deps, halide_exports,
+                               cache_file.empty() ? nullptr : &object_cache);
+        update_object_cache(cache_file, hit, true, object_cache, cached);
 
         if (runtime_kind == MainShared) {
+            std::lock_guard<std::mutex> lock(handlers_mutex);
+
             runtime_internal_handlers.custom_print =
                 hook_function(runtime.exports(), "halide_set_custom_print", print_handler);
 
@@ -828,6 +1355,7 @@ std::vector<JITModule> JITSharedRuntime::get(llvm::Module *for_module, const Tar
 // calls another callback which is not overriden by the caller.)
 void JITSharedRuntime::init_jit_user_context(JITUserContext &jit_user_context,
                                              void *user_context, const JITHandlers &handlers) {
+    std::lock_guard<std::mutex> lock(handlers_mutex);
     jit_user_context.handlers = active_handlers;
     jit_user_context.user_context = user_context;
     merge_handlers(jit_user_context.handlers, handlers);
@@ -842,6 +1370,7 @@ void JITSharedRuntime::release_all() {
 }
 
 JITHandlers JITSharedRuntime::set_default_handlers(const JITHandlers &handlers) {
+    std::lock_guard<std::mutex> lock(handlers_mutex);
     JITHandlers result = default_handlers;
     default_handlers = handlers;
     active_handlers = runtime_internal_handlers;
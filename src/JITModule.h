@@ -8,6 +8,7 @@
 
 #include <map>
 #include <memory>
+#include <string>
 
 #include "IntrusivePtr.h"
 #include "Type.h"
@@ -15,6 +16,7 @@
 
 namespace llvm {
 class Module;
+class ObjectCache;
 class Type;
 }
 
@@ -30,6 +32,14 @@ namespace Internal {
 class JITModuleContents;
 struct LoweredFunc;
 
+/** The number of pipelines and of shared runtime modules found in the
+ * JIT object cache, and the number compiled and added to it, since the
+ * cache was last enabled. */
+struct JITObjectCacheStats {
+    int64_t hits = 0, misses = 0;
+    int64_t runtime_hits = 0, runtime_misses = 0;
+};
+
 struct JITModule {
     IntrusivePtr<JITModuleContents> jit_module;
 
@@ -74,7 +84,8 @@ struct JITModule {
      * via an array of void * pointers to the arguments for the
      * call. Returning a Symbol allows access to the LLVM type as well
      * as the address. The address and type will be nullptr if the module
-     * has not been compiled. */
+     * has not been compiled. The type is also nullptr if the module was
+     * loaded from the object cache. */
     Symbol argv_entrypoint_symbol() const;
 
     /** A slightly more type-safe wrapper around the raw halide
@@ -107,11 +118,32 @@ struct JITModule {
     Symbol find_symbol_by_name(const std::string &) const;
 
     /** Take an llvm module and compile it. The requested exports will
-        be available via the exports method. */
+        be available via the exports method. If an object cache is
+        given, the object code is looked up in it before compiling
+        the module, and handed to it after compiling the module. */
     void compile_module(std::unique_ptr<llvm::Module> mod,
                         const std::string &function_name, const Target &target,
                         const std::vector<JITModule> &dependencies = std::vector<JITModule>(),
-                        const std::vector<std::string> &requested_exports = std::vector<std::string>());
+                        const std::vector<std::string> &requested_exports = std::vector<std::string>(),
+                        llvm::ObjectCache *object_cache = nullptr);
+
+    /** Cache the object code of the pipelines compiled by the
+     * JITModule constructor, and of the shared runtime modules, in
+     * the directory 'dir', and load it from there instead of
+     * compiling them again, also in later processes. The directory
+     * can be filled ahead of time, e.g. when deploying a service, so
+     * that no process compiles the runtime. The cache is keyed by the
+     * lowered module or the runtime target, the target and the build
+     * of Halide and LLVM. The names generated for unnamed Funcs and
+     * parameters depend on the order in which they are created, so
+     * pipelines with explicit names are more likely to be found in
+     * the cache. The directory must exist. An empty string disables
+     * the cache. The cache is disabled by default, unless the
+     * environment variable HL_JIT_CACHE_DIR names a directory. */
+    static void set_object_cache_directory(const std::string &dir);
+
+    /** Get the number of hits and misses of the object cache. */
+    static JITObjectCacheStats object_cache_stats();
 
     /** Encapsulate device (GPU) and buffer interactions. */
     void memoization_cache_set_size(int64_t size) const;
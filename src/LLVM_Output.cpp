@@ -4,9 +4,13 @@
 #include "CodeGen_LLVM.h"
 #include "CodeGen_C.h"
 #include "CodeGen_Internal.h"
+#include "CompileTimeProfiler.h"
+#include "ThreadPool.h"
 
-#include <iostream>
 #include <fstream>
+#include <functional>
+#include <iostream>
+#include <set>
 
 #ifdef _WIN32
 #ifndef NOMINMAX
@@ -315,6 +319,15 @@ std::unique_ptr<llvm::raw_fd_ostream> make_raw_fd_ostream(const std::string &fil
 
 namespace {
 
+// Parse a module serialized as bitcode into the given context.
+std::unique_ptr<llvm::Module> parse_bitcode(const llvm::SmallVectorImpl<char> &bitcode, llvm::LLVMContext &context) {
+    llvm::MemoryBufferRef buffer_ref(llvm::StringRef(bitcode.data(), bitcode.size()), "clone_buffer");
+    auto module = llvm::parseBitcodeFile(buffer_ref, context);
+    internal_assert(module);
+
+    return std::move(module.get());
+}
+
 // llvm::CloneModule has issues with debug info. As a workaround,
 // serialize it to bitcode in memory, and then parse the bitcode back in.
 std::unique_ptr<llvm::Module> clone_module(const llvm::Module &module_in) {
@@ -326,11 +339,7 @@ std::unique_ptr<llvm::Module> clone_module(const llvm::Module &module_in) {
     WriteBitcodeToFile(&module_in, clone_ostream);
 
     // Read it back in.
-    llvm::MemoryBufferRef buffer_ref(llvm::StringRef(clone_buffer.data(), clone_buffer.size()), "clone_buffer");
-    auto cloned_module = llvm::parseBitcodeFile(buffer_ref, module_in.getContext());
-    internal_assert(cloned_module);
-
-    return std::move(cloned_module.get());
+    return parse_bitcode(clone_buffer, module_in.getContext());
 }
 
 }  // namespace
@@ -376,6 +385,8 @@ void emit_file(const llvm::Module &module_in, Internal::LLVMOStream& out, llvm::
     // Ask the target to add backend passes as necessary.
     target_machine->addPassesToEmitFile(pass_manager, out, file_type);
 
+    Internal::LLVMPassTimer timer(file_type == llvm::TargetMachine::CGFT_ObjectFile ?
+                                  "LLVM code generation" : "LLVM assembly generation", *module);
     pass_manager.run(*module);
 }
 
@@ -387,6 +398,122 @@ void compile_llvm_module_to_object(llvm::Module &module, Internal::LLVMOStream&
     emit_file(module, out, llvm::TargetMachine::CGFT_ObjectFile);
 }
 
+void compile_llvm_module_to_objects(const llvm::Module &module_in, const std::vector<Internal::LLVMOStream *> &outs) {
+    internal_assert(!outs.empty());
+    if (outs.size() == 1) {
+        emit_file(module_in, *outs[0], llvm::TargetMachine::CGFT_ObjectFile);
+        return;
+    }
+
+    std::unique_ptr<llvm::Module> module = clone_module(module_in);
+
+    // Functions with local linkage (e.g. the closures of parallel
+    // loops) must be visible from the other partitions, or they will
+    // all be kept in the partition of their caller. Give them a name
+    // unique to this module, and hide them outside of the library.
+    const std::string prefix = module->getModuleIdentifier() + ".";
+    int unnamed = 0;
+    for (llvm::Function &f : *module) {
+        if (f.isDeclaration() || !f.hasLocalLinkage()) {
+            continue;
+        }
+        if (f.hasName()) {
+            f.setName(prefix + f.getName().str());
+        } else {
+            f.setName(prefix + "unnamed." + std::to_string(unnamed++));
+        }
+        f.setLinkage(llvm::GlobalValue::ExternalLinkage);
+        f.setVisibility(llvm::GlobalValue::HiddenVisibility);
+    }
+
+    // The objects are members of a static library, and the linker only
+    // pulls in the members something refers to, so the constructors and
+    // destructors, and everything they call, must be in the same
+    // partition as the entry points. Nothing refers to them otherwise.
+    // SplitModule keeps the members of a comdat together, so put them
+    // in a temporary one, which is removed from the partitions.
+    const std::string pinned_name = prefix + "pinned";
+    {
+        std::vector<llvm::GlobalObject *> pinned;
+        std::vector<llvm::Function *> callees;
+        std::set<llvm::Function *> seen;
+        std::function<void(llvm::Value *)> find_functions = [&](llvm::Value *v) {
+            if (llvm::Function *f = llvm::dyn_cast<llvm::Function>(v)) {
+                if (!f->isDeclaration() && seen.insert(f).second) {
+                    callees.push_back(f);
+                }
+            } else if (llvm::isa<llvm::Constant>(v) && !llvm::isa<llvm::GlobalValue>(v)) {
+                for (llvm::Value *op : llvm::cast<llvm::Constant>(v)->operands()) {
+                    find_functions(op);
+                }
+            }
+        };
+        for (const char *name : {"llvm.global_ctors", "llvm.global_dtors"}) {
+            llvm::GlobalVariable *list = module->getGlobalVariable(name);
+            if (list && list->hasInitializer()) {
+                pinned.push_back(list);
+                find_functions(list->getInitializer());
+            }
+        }
+        for (size_t i = 0; i < callees.size(); i++) {
+            for (llvm::BasicBlock &b : *callees[i]) {
+                for (llvm::Instruction &inst : b) {
+                    for (llvm::Value *op : inst.operands()) {
+                        find_functions(op);
+                    }
+                }
+            }
+        }
+        if (!pinned.empty()) {
+            pinned.insert(pinned.end(), callees.begin(), callees.end());
+            for (llvm::Function &f : *module) {
+                if (!f.isDeclaration() && f.hasExternalLinkage() && !f.hasHiddenVisibility()) {
+                    pinned.push_back(&f);
+                }
+            }
+            llvm::Comdat *comdat = module->getOrInsertComdat(pinned_name);
+            for (llvm::GlobalObject *g : pinned) {
+                if (!g->hasComdat()) {
+                    g->setComdat(comdat);
+                }
+            }
+        }
+    }
+
+    // Split the module, and serialize each partition, as each of them
+    // needs its own context to be compiled on its own thread.
+    std::vector<llvm::SmallVector<char, 16>> partitions;
+    llvm::SplitModule(std::move(module), outs.size(),
+                      [&](std::unique_ptr<llvm::Module> partition) {
+                          for (llvm::GlobalObject &g : partition->global_objects()) {
+                              if (g.hasComdat() && g.getComdat()->getName() == pinned_name) {
+                                  g.setComdat(nullptr);
+                              }
+                          }
+                          partition->getComdatSymbolTable().erase(pinned_name);
+                          partitions.emplace_back();
+                          llvm::raw_svector_ostream partition_ostream(partitions.back());
+                          WriteBitcodeToFile(partition.get(), partition_ostream);
+                      },
+                      /* PreserveLocals */ true);
+    internal_assert(partitions.size() == outs.size());
+    Internal::debug(1) << "compile_llvm_module_to_objects: compiling "
+                       << partitions.size() << " partitions\n";
+
+    Internal::ThreadPool<void> pool(partitions.size());
+    std::vector<std::future<void>> futures;
+    for (size_t i = 0; i < partitions.size(); i++) {
+        futures.emplace_back(pool.async([&](size_t i) {
+            llvm::LLVMContext context;
+            std::unique_ptr<llvm::Module> partition = parse_bitcode(partitions[i], context);
+            emit_file(*partition, *outs[i], llvm::TargetMachine::CGFT_ObjectFile);
+        }, i));
+    }
+    for (auto &f : futures) {
+        f.get();
+    }
+}
+
 void compile_llvm_module_to_assembly(llvm::Module &module, Internal::LLVMOStream& out) {
     emit_file(module, out, llvm::TargetMachine::CGFT_AssemblyFile);
 }
@@ -39,6 +39,12 @@ void compile_llvm_module_to_object(llvm::Module &module, Internal::LLVMOStream&
 void compile_llvm_module_to_assembly(llvm::Module &module, Internal::LLVMOStream& out);
 // @}
 
+/** Split an LLVM module into outs.size() partitions, and compile
+ * each of them to an object on its own thread. Local functions of the
+ * module, such as the closures of parallel loops, become hidden
+ * symbols so that the objects can be linked together. */
+void compile_llvm_module_to_objects(const llvm::Module &module, const std::vector<Internal::LLVMOStream *> &outs);
+
 /** Compile an LLVM module to LLVM targets (bitcode, LLVM assembly). */
 // @{
 void compile_llvm_module_to_llvm_bitcode(llvm::Module &module, Internal::LLVMOStream& out);
@@ -1,4 +1,5 @@
 #include <iostream>
+#include <memory>
 #include <set>
 #include <sstream>
 #include <algorithm>
@@ -13,6 +14,7 @@
 #include "BoundSmallAllocations.h"
 #include "CSE.h"
 #include "CanonicalizeGPUVars.h"
+#include "CompileTimeProfiler.h"
 #include "Debug.h"
 #include "DebugArguments.h"
 #include "DebugToFile.h"
@@ -81,6 +83,15 @@ Module lower(const vector<Function> &output_funcs, const string &pipeline_name,
 
     Module result_module(simple_pipeline_name, t);
 
+    // Lowering simplifies many equal expressions over and over (e.g.
+    // in bounds inference and loop partitioning). Caching the results
+    // is off by default until it is shown to pay off on real pipelines;
+    // set HL_SIMPLIFY_CACHE=1 to turn it on.
+    std::unique_ptr<SimplifyCache> simplify_cache;
+    if (get_env_variable("HL_SIMPLIFY_CACHE") == "1") {
+        simplify_cache.reset(new SimplifyCache);
+    }
+
     // Compute an environment
     map<string, Function> env;
     for (Function f : output_funcs) {
@@ -114,17 +125,22 @@ Module lower(const vector<Function> &output_funcs, const string &pipeline_name,
     // specializations' conditions
     simplify_specializations(env);
 
+    LoweringPassTimer timer(pipeline_name);
+
     debug(1) << "Creating initial loop nests...\n";
+    timer.pass("Creating initial loop nests", Stmt());
     bool any_memoized = false;
     Stmt s = schedule_functions(outputs, fused_groups, env, t, any_memoized);
     debug(2) << "Lowering after creating initial loop nests:\n" << s << '\n';
 
     debug(1) << "Canonicalizing GPU var names...\n";
+    timer.pass("Canonicalizing GPU var names", s);
     s = canonicalize_gpu_vars(s);
     debug(2) << "Lowering after canonicalizing GPU var names:\n" << s << '\n';
 
     if (any_memoized) {
         debug(1) << "Injecting memoization...\n";
+        timer.pass("Injecting memoization", s);
         s = inject_memoization(s, env, pipeline_name, outputs);
         debug(2) << "Lowering after injecting memoization:\n" << s << '\n';
     } else {
@@ -132,21 +148,25 @@ Module lower(const vector<Function> &output_funcs, const string &pipeline_name,
     }
 
     debug(1) << "Injecting tracing...\n";
+    timer.pass("Injecting tracing", s);
     s = inject_tracing(s, pipeline_name, env, outputs, t);
     debug(2) << "Lowering after injecting tracing:\n" << s << '\n';
 
     debug(1) << "Adding checks for parameters\n";
+    timer.pass("Adding checks for parameters", s);
     s = add_parameter_checks(s, t);
     debug(2) << "Lowering after injecting parameter checks:\n" << s << '\n';
 
     // Compute the maximum and minimum possible value of each
     // function. Used in later bounds inference passes.
     debug(1) << "Computing bounds of each function's value\n";
+    timer.pass("Computing bounds of each function's value", s);
     FuncValueBounds func_bounds = compute_function_value_bounds(order, env);
 
     // The checks will be in terms of the symbols defined by bounds
     // inference.
     debug(1) << "Adding checks for images\n";
+    timer.pass("Adding checks for images", s);
     s = add_image_checks(s, outputs, t, order, env, func_bounds);
     debug(2) << "Lowering after injecting image checks:\n" << s << '\n';
 
@@ -154,18 +174,29 @@ Module lower(const vector<Function> &output_funcs, const string &pipeline_name,
     // can't simplify statements from here until we fix them up. (We
     // can still simplify Exprs).
     debug(1) << "Performing computation bounds inference...\n";
+    timer.pass("Performing computation bounds inference", s);
     s = bounds_inference(s, outputs, order, fused_groups, env, func_bounds, t);
     debug(2) << "Lowering after computation bounds inference:\n" << s << '\n';
 
     debug(1) << "Performing sliding window optimization...\n";
+    timer.pass("Performing sliding window optimization", s);
     s = sliding_window(s, env);
     debug(2) << "Lowering after sliding window:\n" << s << '\n';
 
+    if (t.has_feature(Target::Profile)) {
+        debug(1) << "Counting work for the profiler...\n";
+        timer.pass("Counting work for the profiler", s);
+        s = count_profiled_work(s, env);
+        debug(2) << "Lowering after counting work for the profiler:\n" << s << '\n';
+    }
+
     debug(1) << "Performing allocation bounds inference...\n";
+    timer.pass("Performing allocation bounds inference", s);
     s = allocation_bounds_inference(s, env, func_bounds);
     debug(2) << "Lowering after allocation bounds inference:\n" << s << '\n';
 
     debug(1) << "Removing code that depends on undef values...\n";
+    timer.pass("Removing code that depends on undef values", s);
     s = remove_undef(s);
     debug(2) << "Lowering after removing code that depends on undef values:\n" << s << "\n\n";
 
@@ -173,43 +204,53 @@ Module lower(const vector<Function> &output_funcs, const string &pipeline_name,
     // after this point. This lets later passes assume syntactic
     // equivalence means semantic equivalence.
     debug(1) << "Uniquifying variable names...\n";
+    timer.pass("Uniquifying variable names", s);
     s = uniquify_variable_names(s);
     debug(2) << "Lowering after uniquifying variable names:\n" << s << "\n\n";
 
     debug(1) << "Performing storage folding optimization...\n";
+    timer.pass("Performing storage folding optimization", s);
     s = storage_folding(s, env);
     debug(2) << "Lowering after storage folding:\n" << s << '\n';
 
     debug(1) << "Injecting debug_to_file calls...\n";
+    timer.pass("Injecting debug_to_file calls", s);
     s = debug_to_file(s, outputs, env);
     debug(2) << "Lowering after injecting debug_to_file calls:\n" << s << '\n';
 
     debug(1) << "Simplifying...\n"; // without removing dead lets, because storage flattening needs the strides
+    timer.pass("Simplifying", s);
     s = simplify(s, false);
     debug(2) << "Lowering after first simplification:\n" << s << "\n\n";
 
     debug(1) << "Injecting prefetches...\n";
+    timer.pass("Injecting prefetches", s);
     s = inject_prefetch(s, env);
     debug(2) << "Lowering after injecting prefetches:\n" << s << "\n\n";
 
     debug(1) << "Dynamically skipping stages...\n";
+    timer.pass("Dynamically skipping stages", s);
     s = skip_stages(s, order);
     debug(2) << "Lowering after dynamically skipping stages:\n" << s << "\n\n";
 
     debug(1) << "Destructuring tuple-valued realizations...\n";
+    timer.pass("Destructuring tuple-valued realizations", s);
     s = split_tuples(s, env);
     debug(2) << "Lowering after destructuring tuple-valued realizations:\n" << s << "\n\n";
 
     debug(1) << "Performing storage flattening...\n";
+    timer.pass("Performing storage flattening", s);
     s = storage_flattening(s, outputs, env, t);
     debug(2) << "Lowering after storage flattening:\n" << s << "\n\n";
 
     debug(1) << "Unpacking buffer arguments...\n";
+    timer.pass("Unpacking buffer arguments", s);
     s = unpack_buffers(s);
     debug(2) << "Lowering after unpacking buffer arguments...\n" << s << "\n\n";
 
     if (any_memoized) {
         debug(1) << "Rewriting memoized allocations...\n";
+        timer.pass("Rewriting memoized allocations", s);
         s = rewrite_memoized_allocations(s, env);
         debug(2) << "Lowering after rewriting memoized allocations:\n" << s << "\n\n";
     } else {
@@ -221,20 +262,24 @@ Module lower(const vector<Function> &output_funcs, const string &pipeline_name,
         t.has_feature(Target::OpenGL) ||
         (t.arch != Target::Hexagon && (t.features_any_of({Target::HVX_64, Target::HVX_128})))) {
         debug(1) << "Selecting a GPU API for GPU loops...\n";
+        timer.pass("Selecting a GPU API for GPU loops", s);
         s = select_gpu_api(s, t);
         debug(2) << "Lowering after selecting a GPU API:\n" << s << "\n\n";
 
         debug(1) << "Injecting host <-> dev buffer copies...\n";
+        timer.pass("Injecting host <-> dev buffer copies", s);
         s = inject_host_dev_buffer_copies(s, t);
         debug(2) << "Lowering after injecting host <-> dev buffer copies:\n" << s << "\n\n";
 
         debug(1) << "Selecting a GPU API for extern stages...\n";
+        timer.pass("Selecting a GPU API for extern stages", s);
         s = select_gpu_api(s, t);
         debug(2) << "Lowering after selecting a GPU API for extern stages:\n" << s << "\n\n";
     }
 
     if (t.has_feature(Target::OpenGL)) {
         debug(1) << "Injecting OpenGL texture intrinsics...\n";
+        timer.pass("Injecting OpenGL texture intrinsics", s);
         s = inject_opengl_intrinsics(s);
         debug(2) << "Lowering after OpenGL intrinsics:\n" << s << "\n\n";
     }
@@ -242,83 +287,100 @@ Module lower(const vector<Function> &output_funcs, const string &pipeline_name,
     if (t.has_gpu_feature() ||
         t.has_feature(Target::OpenGLCompute)) {
         debug(1) << "Injecting per-block gpu synchronization...\n";
+        timer.pass("Injecting per-block gpu synchronization", s);
         s = fuse_gpu_thread_loops(s);
         debug(2) << "Lowering after injecting per-block gpu synchronization:\n" << s << "\n\n";
     }
 
     debug(1) << "Simplifying...\n";
+    timer.pass("Simplifying", s);
     s = simplify(s);
     s = unify_duplicate_lets(s);
     s = remove_trivial_for_loops(s);
     debug(2) << "Lowering after second simplifcation:\n" << s << "\n\n";
 
     debug(1) << "Reduce prefetch dimension...\n";
+    timer.pass("Reduce prefetch dimension", s);
     s = reduce_prefetch_dimension(s, t);
     debug(2) << "Lowering after reduce prefetch dimension:\n" << s << "\n";
 
     debug(1) << "Unrolling...\n";
+    timer.pass("Unrolling", s);
     s = unroll_loops(s);
     s = simplify(s);
     debug(2) << "Lowering after unrolling:\n" << s << "\n\n";
 
     debug(1) << "Vectorizing...\n";
+    timer.pass("Vectorizing", s);
     s = vectorize_loops(s, t);
     s = simplify(s);
     debug(2) << "Lowering after vectorizing:\n" << s << "\n\n";
 
     debug(1) << "Detecting vector interleavings...\n";
+    timer.pass("Detecting vector interleavings", s);
     s = rewrite_interleavings(s);
     s = simplify(s);
     debug(2) << "Lowering after rewriting vector interleavings:\n" << s << "\n\n";
 
     debug(1) << "Partitioning loops to simplify boundary conditions...\n";
+    timer.pass("Partitioning loops to simplify boundary conditions", s);
     s = partition_loops(s);
     s = simplify(s);
     debug(2) << "Lowering after partitioning loops:\n" << s << "\n\n";
 
     debug(1) << "Trimming loops to the region over which they do something...\n";
+    timer.pass("Trimming loops to the region over which they do something", s);
     s = trim_no_ops(s);
     debug(2) << "Lowering after loop trimming:\n" << s << "\n\n";
 
     debug(1) << "Injecting early frees...\n";
+    timer.pass("Injecting early frees", s);
     s = inject_early_frees(s);
     debug(2) << "Lowering after injecting early frees:\n" << s << "\n\n";
 
     if (t.has_feature(Target::Profile)) {
         debug(1) << "Injecting profiling...\n";
+        timer.pass("Injecting profiling", s);
         s = inject_profiling(s, pipeline_name);
         debug(2) << "Lowering after injecting profiling:\n" << s << "\n\n";
     }
 
     if (t.has_feature(Target::FuzzFloatStores)) {
         debug(1) << "Fuzzing floating point stores...\n";
+        timer.pass("Fuzzing floating point stores", s);
         s = fuzz_float_stores(s);
         debug(2) << "Lowering after fuzzing floating point stores:\n" << s << "\n\n";
     }
 
     debug(1) << "Bounding small allocations...\n";
+    timer.pass("Bounding small allocations", s);
     s = bound_small_allocations(s);
     debug(2) << "Lowering after bounding small allocations:\n" << s << "\n\n";
 
     if (t.has_feature(Target::CUDA)) {
         debug(1) << "Injecting warp shuffles...\n";
+        timer.pass("Injecting warp shuffles", s);
         s = lower_warp_shuffles(s);
         debug(2) << "Lowering after injecting warp shuffles:\n" << s << "\n\n";
     }
 
     debug(1) << "Simplifying...\n";
+    timer.pass("Common subexpression elimination", s);
     s = common_subexpression_elimination(s);
 
     if (t.has_feature(Target::OpenGL)) {
         debug(1) << "Detecting varying attributes...\n";
+        timer.pass("Detecting varying attributes", s);
         s = find_linear_expressions(s);
         debug(2) << "Lowering after detecting varying attributes:\n" << s << "\n\n";
 
         debug(1) << "Moving varying attribute expressions out of the shader...\n";
+        timer.pass("Moving varying attribute expressions out of the shader", s);
         s = setup_gpu_vertex_buffer(s);
         debug(2) << "Lowering after removing varying attributes:\n" << s << "\n\n";
     }
 
+    timer.pass("Final simplification", s);
     s = remove_dead_allocations(s);
     s = remove_trivial_for_loops(s);
     s = simplify(s);
@@ -327,6 +389,7 @@ Module lower(const vector<Function> &output_funcs, const string &pipeline_name,
 
     if (t.arch != Target::Hexagon && (t.features_any_of({Target::HVX_64, Target::HVX_128}))) {
         debug(1) << "Splitting off Hexagon offload...\n";
+        timer.pass("Splitting off Hexagon offload", s);
         s = inject_hexagon_rpc(s, t, result_module);
         debug(2) << "Lowering after splitting off Hexagon offload:\n" << s << '\n';
     } else {
@@ -336,11 +399,14 @@ Module lower(const vector<Function> &output_funcs, const string &pipeline_name,
     if (!custom_passes.empty()) {
         for (size_t i = 0; i < custom_passes.size(); i++) {
             debug(1) << "Running custom lowering pass " << i << "...\n";
+            timer.pass("Running custom lowering pass " + std::to_string(i), s);
             s = custom_passes[i]->mutate(s);
             debug(1) << "Lowering after custom pass " << i << ":\n" << s << "\n\n";
         }
     }
 
+    timer.finish(s);
+
     vector<Argument> public_args = args;
     for (const auto &out : outputs) {
         for (Parameter buf : out.output_buffers()) {
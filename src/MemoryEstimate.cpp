@@ -0,0 +1,384 @@
+#include <algorithm>
+#include <map>
+#include <sstream>
+
+#include "MemoryEstimate.h"
+#include "Bounds.h"
+#include "CodeGen_Internal.h"
+#include "IROperator.h"
+#include "IRVisitor.h"
+#include "Scope.h"
+#include "Simplify.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::string;
+using std::vector;
+
+namespace {
+
+// An upper bound on a number of bytes, or unbounded.
+struct Bytes {
+    int64_t value = 0;
+    bool bounded = true;
+
+    Bytes() {}
+    Bytes(int64_t v) : value(v) {}
+
+    static Bytes unbounded() {
+        Bytes b;
+        b.bounded = false;
+        return b;
+    }
+
+    Bytes operator+(const Bytes &other) const {
+        if (!bounded || !other.bounded) return unbounded();
+        return Bytes(value + other.value);
+    }
+
+    Bytes operator-(const Bytes &other) const {
+        if (!bounded || !other.bounded) return unbounded();
+        return Bytes(value - other.value);
+    }
+
+    Bytes operator*(int64_t factor) const {
+        if (!bounded) return unbounded();
+        return Bytes(value * factor);
+    }
+};
+
+Bytes max(const Bytes &a, const Bytes &b) {
+    if (!a.bounded || !b.bounded) return Bytes::unbounded();
+    return Bytes(std::max(a.value, b.value));
+}
+
+std::ostream &operator<<(std::ostream &stream, const Bytes &b) {
+    if (b.bounded) {
+        stream << b.value << " bytes";
+    } else {
+        stream << "unbounded";
+    }
+    return stream;
+}
+
+// A running count of live bytes, and its high-water mark.
+struct Live {
+    Bytes current, peak;
+
+    void add(const Bytes &b) {
+        current = current + b;
+        peak = max(peak, current);
+    }
+
+    void remove(const Bytes &b) {
+        current = current - b;
+    }
+};
+
+class EstimateMemory : public IRVisitor {
+public:
+    // Estimates of the buffer fields and scalar params, by variable name.
+    map<string, Interval> estimates;
+
+    int parallelism;
+
+    // Heap bytes live across all threads.
+    Live heap;
+    // Stack bytes live in one thread.
+    Live thread_stack;
+    // Heap bytes allocated inside parallel loops, live in one thread.
+    Live thread_scratch;
+    // All bytes live in one thread, for the per-loop working sets.
+    Live thread_total;
+
+    // The working set of one iteration of each loop that allocates.
+    map<string, Bytes> loop_working_sets;
+
+    // Allocations whose size could not be bounded.
+    vector<string> unbounded;
+
+    EstimateMemory(int parallelism) : parallelism(parallelism) {}
+
+private:
+    using IRVisitor::visit;
+
+    Scope<Interval> scope;
+
+    struct Allocation {
+        Bytes bytes;
+        bool on_stack;
+        int threads;
+        bool freed;
+    };
+    map<string, vector<Allocation>> allocations;
+
+    // How many copies of each allocation may be live at once.
+    int threads = 1;
+
+    Bytes allocation_size(const Allocate *op) {
+        int64_t bytes = op->type.bytes();
+        for (const Expr &e : op->extents) {
+            Interval in = bounds_of_expr_in_scope(e, scope, FuncValueBounds(), true);
+            if (!in.has_upper_bound()) {
+                return Bytes::unbounded();
+            }
+            const int64_t *extent = as_const_int(simplify(in.max));
+            if (!extent) {
+                return Bytes::unbounded();
+            }
+            if (*extent <= 0) {
+                return Bytes(0);
+            }
+            if (bytes > (((int64_t)1) << 62) / *extent) {
+                return Bytes::unbounded();
+            }
+            bytes *= *extent;
+        }
+        return Bytes(bytes);
+    }
+
+    void release(Allocation &a) {
+        if (a.freed) return;
+        a.freed = true;
+        if (a.on_stack) {
+            thread_stack.remove(a.bytes);
+        } else {
+            heap.remove(a.bytes * a.threads);
+            if (a.threads > 1) {
+                thread_scratch.remove(a.bytes);
+            }
+        }
+        thread_total.remove(a.bytes);
+    }
+
+    void visit(const Allocate *op) override {
+        for (const Expr &e : op->extents) {
+            e.accept(this);
+        }
+
+        Allocation a;
+        a.bytes = allocation_size(op);
+        a.threads = threads;
+        a.freed = false;
+        if (op->memory_type == MemoryType::Stack ||
+            op->memory_type == MemoryType::Register) {
+            a.on_stack = true;
+        } else if (op->memory_type == MemoryType::Heap) {
+            a.on_stack = false;
+        } else {
+            // This mirrors the decision made by codegen.
+            int32_t constant_size = Allocate::constant_allocation_size(op->extents, op->name);
+            a.on_stack = (constant_size > 0 &&
+                          can_allocation_fit_on_stack((int64_t)constant_size * op->type.bytes()));
+        }
+
+        if (op->new_expr.defined()) {
+            // The memory is provided by someone else.
+            a.bytes = Bytes(0);
+        } else if (!a.bytes.bounded) {
+            unbounded.push_back(op->name);
+        }
+
+        if (a.on_stack) {
+            thread_stack.add(a.bytes);
+        } else {
+            heap.add(a.bytes * a.threads);
+            if (a.threads > 1) {
+                thread_scratch.add(a.bytes);
+            }
+        }
+        thread_total.add(a.bytes);
+
+        allocations[op->name].push_back(a);
+        op->body.accept(this);
+        release(allocations[op->name].back());
+        allocations[op->name].pop_back();
+    }
+
+    void visit(const Free *op) override {
+        auto iter = allocations.find(op->name);
+        if (iter != allocations.end() && !iter->second.empty()) {
+            release(iter->second.back());
+        }
+    }
+
+    void visit(const LetStmt *op) override {
+        op->value.accept(this);
+        Interval in;
+        auto iter = estimates.find(op->name);
+        if (iter != estimates.end()) {
+            in = iter->second;
+        } else {
+            in = bounds_of_expr_in_scope(op->value, scope, FuncValueBounds(), true);
+        }
+        ScopedBinding<Interval> bind(scope, op->name, in);
+        op->body.accept(this);
+    }
+
+    void visit(const IfThenElse *op) override {
+        op->condition.accept(this);
+        // Both branches start from the same state; take the worse one.
+        Live heap_before = heap, stack_before = thread_stack;
+        Live scratch_before = thread_scratch, total_before = thread_total;
+        op->then_case.accept(this);
+        if (op->else_case.defined()) {
+            Live heap_then = heap, stack_then = thread_stack;
+            Live scratch_then = thread_scratch, total_then = thread_total;
+            heap.current = heap_before.current;
+            thread_stack.current = stack_before.current;
+            thread_scratch.current = scratch_before.current;
+            thread_total.current = total_before.current;
+            op->else_case.accept(this);
+            heap.current = max(heap.current, heap_then.current);
+            thread_stack.current = max(thread_stack.current, stack_then.current);
+            thread_scratch.current = max(thread_scratch.current, scratch_then.current);
+            thread_total.current = max(thread_total.current, total_then.current);
+        }
+    }
+
+    void visit(const For *op) override {
+        // Allocations inside device loops live in device memory.
+        if (op->device_api != DeviceAPI::None &&
+            op->device_api != DeviceAPI::Host) {
+            return;
+        }
+
+        op->min.accept(this);
+        op->extent.accept(this);
+        Interval min_bounds = bounds_of_expr_in_scope(op->min, scope, FuncValueBounds(), true);
+        Interval extent_bounds = bounds_of_expr_in_scope(op->extent, scope, FuncValueBounds(), true);
+        Interval in(min_bounds.min, Interval::pos_inf);
+        if (min_bounds.has_upper_bound() && extent_bounds.has_upper_bound()) {
+            in.max = simplify(min_bounds.max + extent_bounds.max - 1);
+        }
+
+        int old_threads = threads;
+        if (op->is_parallel()) {
+            // At most one iteration per thread runs at a time.
+            int64_t concurrent = parallelism;
+            if (extent_bounds.has_upper_bound()) {
+                const int64_t *extent = as_const_int(simplify(extent_bounds.max));
+                if (extent) {
+                    concurrent = std::min(concurrent, std::max(*extent, (int64_t)1));
+                }
+            }
+            threads = (int)std::min((int64_t)parallelism, threads * concurrent);
+        }
+
+        // Measure the peak of the bytes allocated by one iteration.
+        Live outer_total = thread_total;
+        thread_total.peak = thread_total.current;
+        {
+            ScopedBinding<Interval> bind(scope, op->name, in);
+            op->body.accept(this);
+        }
+        Bytes working_set = thread_total.peak - outer_total.current;
+        if (!working_set.bounded || working_set.value > 0) {
+            auto iter = loop_working_sets.find(op->name);
+            if (iter == loop_working_sets.end()) {
+                loop_working_sets.emplace(op->name, working_set);
+            } else {
+                iter->second = max(iter->second, working_set);
+            }
+        }
+        thread_total.peak = max(outer_total.peak, thread_total.peak);
+
+        threads = old_threads;
+    }
+};
+
+Interval estimate_interval(const Expr &e) {
+    if (e.defined()) {
+        return Interval::single_point(e);
+    }
+    return Interval::everything();
+}
+
+}  // namespace
+
+std::string estimate_memory(Stmt s,
+                            const vector<Function> &outputs,
+                            const vector<Parameter> &params,
+                            const MachineParams &machine_params) {
+    const int64_t *parallelism = as_const_int(machine_params.parallelism);
+    const int64_t *cache_size = as_const_int(machine_params.last_level_cache_size);
+    internal_assert(parallelism && cache_size);
+
+    EstimateMemory estimate((int)std::max(*parallelism, (int64_t)1));
+
+    // Scalar params are referred to directly rather than through lets,
+    // so wrap the pipeline in lets that bind them to their estimates.
+    for (const Parameter &p : params) {
+        if (!p.is_buffer() && p.estimate().defined()) {
+            estimate.estimates[p.name()] = Interval::single_point(p.estimate());
+            s = LetStmt::make(p.name(), p.estimate(), s);
+        }
+    }
+
+    for (const Parameter &p : params) {
+        if (p.is_buffer()) {
+            for (int i = 0; i < p.dimensions(); i++) {
+                string dim = std::to_string(i);
+                estimate.estimates[p.name() + ".min." + dim] =
+                    estimate_interval(p.min_constraint_estimate(i));
+                estimate.estimates[p.name() + ".extent." + dim] =
+                    estimate_interval(p.extent_constraint_estimate(i));
+            }
+        }
+    }
+
+    for (const Function &f : outputs) {
+        vector<string> buffers;
+        if (f.outputs() == 1) {
+            buffers.push_back(f.name());
+        } else {
+            for (int i = 0; i < f.outputs(); i++) {
+                buffers.push_back(f.name() + "." + std::to_string(i));
+            }
+        }
+        const vector<string> f_args = f.args();
+        for (size_t i = 0; i < f_args.size(); i++) {
+            Expr min, extent;
+            for (const Bound &b : f.schedule().estimates()) {
+                if (b.var == f_args[i]) {
+                    min = b.min;
+                    extent = b.extent;
+                }
+            }
+            string dim = std::to_string(i);
+            for (const string &b : buffers) {
+                estimate.estimates[b + ".min." + dim] = estimate_interval(min);
+                estimate.estimates[b + ".extent." + dim] = estimate_interval(extent);
+            }
+        }
+    }
+
+    s.accept(&estimate);
+
+    std::ostringstream o;
+    o << "// Memory estimate (upper bounds, using the Func and Param estimates)\n"
+      << "Peak heap memory: " << estimate.heap.peak
+      << " (assuming " << estimate.parallelism << " threads)\n"
+      << "Peak stack memory per thread: " << estimate.thread_stack.peak << "\n"
+      << "Peak heap scratch per thread: " << estimate.thread_scratch.peak << "\n"
+      << "Working set per loop iteration (last level cache: " << *cache_size << " bytes):\n";
+    for (const auto &ws : estimate.loop_working_sets) {
+        o << "  " << ws.first << ": " << ws.second;
+        if (ws.second.bounded) {
+            o << (ws.second.value <= *cache_size ? " (fits in cache)" : " (exceeds cache)");
+        }
+        o << "\n";
+    }
+    if (!estimate.unbounded.empty()) {
+        o << "Allocations with no bound on their size (add estimates to bound them):\n";
+        for (const string &name : estimate.unbounded) {
+            o << "  " << name << "\n";
+        }
+    }
+    return o.str();
+}
+
+}
+}
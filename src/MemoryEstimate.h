@@ -0,0 +1,37 @@
+#ifndef HALIDE_MEMORY_ESTIMATE_H
+#define HALIDE_MEMORY_ESTIMATE_H
+
+/** \file
+ *
+ * Defines a static estimate of the memory used by a lowered pipeline.
+ */
+
+#include <string>
+#include <vector>
+
+#include "AutoSchedule.h"
+#include "Function.h"
+#include "IR.h"
+#include "Parameter.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Compute upper bounds on the memory used by the lowered pipeline 's',
+ * using the estimates on the output Funcs and on the input Parameters in
+ * place of the actual buffer sizes. The returned report gives:
+ *  - the peak heap memory live at once, counting each allocation made
+ *    inside a parallel loop once per thread ('machine_params.parallelism')
+ *  - the peak stack usage and heap scratch usage of each thread
+ *  - the working set of one iteration of each loop that contains
+ *    allocations, against 'machine_params.last_level_cache_size' (in bytes)
+ * Allocations whose size cannot be bounded are listed separately. */
+std::string estimate_memory(Stmt s,
+                            const std::vector<Function> &outputs,
+                            const std::vector<Parameter> &params,
+                            const MachineParams &machine_params);
+
+}
+}
+
+#endif
@@ -3,6 +3,7 @@
 #include <array>
 #include <fstream>
 #include <future>
+#include <list>
 
 #include "CodeGen_C.h"
 #include "CodeGen_Internal.h"
@@ -91,6 +92,7 @@ Outputs add_suffixes(const Outputs &in, const std::string &suffix) {
     if (!in.stmt_name.empty()) out.stmt_name = add_suffix(in.stmt_name, suffix);
     if (!in.stmt_html_name.empty()) out.stmt_html_name = add_suffix(in.stmt_html_name, suffix);
     if (!in.schedule_name.empty()) out.schedule_name = add_suffix(in.schedule_name, suffix);
+    if (!in.memory_estimate_name.empty()) out.memory_estimate_name = add_suffix(in.memory_estimate_name, suffix);
     return out;
 }
 
@@ -109,7 +111,7 @@ uint64_t target_feature_mask(const Target &target) {
 
 struct ModuleContents {
     mutable RefCount ref_count;
-    std::string name, auto_schedule;
+    std::string name, auto_schedule, memory_estimate;
     Target target;
     std::vector<Buffer<>> buffers;
     std::vector<Internal::LoweredFunc> functions;
@@ -161,6 +163,11 @@ void Module::set_auto_schedule(const std::string &auto_schedule) {
     contents->auto_schedule = auto_schedule;
 }
 
+void Module::set_memory_estimate(const std::string &memory_estimate) {
+    internal_assert(contents->memory_estimate.empty());
+    contents->memory_estimate = memory_estimate;
+}
+
 const Target &Module::target() const {
     return contents->target;
 }
@@ -173,6 +180,10 @@ const std::string &Module::auto_schedule() const {
     return contents->auto_schedule;
 }
 
+const std::string &Module::memory_estimate() const {
+    return contents->memory_estimate;
+}
+
 const std::vector<Buffer<>> &Module::buffers() const {
     return contents->buffers;
 }
@@ -368,13 +379,31 @@ void Module::compile(const Outputs &output_files_arg) const {
             // no real-world code ever sets both object_name and static_library_name
             // at the same time, so there is no meaningful performance advantage
             // to be had.
+            //
+            // The members of a static library are linked anyway, so we
+            // split the module and compile the parts on several threads.
             TemporaryObjectFileDir temp_dir;
             {
-                std::string object_name = temp_dir.add_temp_object_file(output_files.static_library_name, "", target());
-                debug(1) << "Module.compile(): temporary object_name " << object_name << "\n";
-                auto out = make_raw_fd_ostream(object_name);
-                compile_llvm_module_to_object(*llvm_module, *out);
-                out->flush();  // create_static_library() is happier if we do this
+                size_t num_functions = 0;
+                for (const llvm::Function &f : *llvm_module) {
+                    num_functions += f.isDeclaration() ? 0 : 1;
+                }
+                size_t num_parts = (debug::debug_level() > 0) ? 1 : ThreadPool<void>::num_processors_online();
+                num_parts = std::max<size_t>(1, std::min(num_parts, num_functions));
+
+                std::vector<std::unique_ptr<llvm::raw_fd_ostream>> outs;
+                std::vector<LLVMOStream *> out_ptrs;
+                for (size_t i = 0; i < num_parts; i++) {
+                    std::string suffix = num_parts > 1 ? "_" + std::to_string(i) : "";
+                    std::string object_name = temp_dir.add_temp_object_file(output_files.static_library_name, suffix, target());
+                    debug(1) << "Module.compile(): temporary object_name " << object_name << "\n";
+                    outs.push_back(make_raw_fd_ostream(object_name));
+                    out_ptrs.push_back(outs.back().get());
+                }
+                compile_llvm_module_to_objects(*llvm_module, out_ptrs);
+                for (auto &out : outs) {
+                    out->flush();  // create_static_library() is happier if we do this
+                }
             }
             debug(1) << "Module.compile(): static_library_name " << output_files.static_library_name << "\n";
             Target base_target(target().os, target().arch, target().bits);
@@ -424,6 +453,15 @@ void Module::compile(const Outputs &output_files_arg) const {
            file << contents->auto_schedule;
         }
     }
+    if (!output_files.memory_estimate_name.empty()) {
+        debug(1) << "Module.compile(): memory_estimate_name " << output_files.memory_estimate_name << "\n";
+        std::ofstream file(output_files.memory_estimate_name);
+        if (contents->memory_estimate.empty()) {
+           file << "// No memory estimate was computed for this Module.\n";
+        } else {
+           file << contents->memory_estimate;
+        }
+    }
 }
 
 Outputs compile_standalone_runtime(const Outputs &output_files, Target t) {
@@ -469,7 +507,9 @@ void compile_multitarget(const std::string &fn_name,
         return;
     }
 
-    std::vector<std::future<void>> futures;
+    // The results of the sub-targets must outlive the pool.
+    std::list<std::vector<LoweredArgument>> sub_target_args;
+    std::vector<std::future<void>> futures, sub_target_futures;
     // If we are running with HL_DEBUG_CODEGEN=1, use threads=1 to enforce
     // sequential execution, so that debug output won't be utterly incomprehensible
     const size_t num_threads = (debug::debug_level() > 0) ? 1 : Internal::ThreadPool<void>::num_processors_online();
@@ -488,7 +528,6 @@ void compile_multitarget(const std::string &fn_name,
 
     TemporaryObjectFileDir temp_dir;
     std::vector<Expr> wrapper_args;
-    std::vector<LoweredArgument> base_target_args;
     for (const Target &target : targets) {
         // arch-bits-os must be identical across all targets.
         if (target.os != base_target.os ||
@@ -529,18 +568,21 @@ void compile_multitarget(const std::string &fn_name,
             sub_fn_target = sub_fn_target.without_feature(Target::Matlab);
         }
 
-        Module sub_module = module_producer(sub_fn_name, sub_fn_target);
-        // Re-assign every time -- should be the same across all targets anyway,
-        // but base_target is always the last one we encounter.
-        base_target_args = sub_module.get_function_by_name(sub_fn_name).args;
-
         Outputs sub_out = add_suffixes(output_files, suffix);
         internal_assert(sub_out.object_name.empty());
         sub_out.object_name = temp_dir.add_temp_object_file(output_files.static_library_name, suffix, target);
-        futures.emplace_back(pool.async([](Module m, Outputs o) {
+
+        // Produce and compile each sub-module on the pool, so that
+        // lowering of the sub-targets happens concurrently too.
+        sub_target_args.emplace_back();
+        std::vector<LoweredArgument> *args = &sub_target_args.back();
+        sub_target_futures.emplace_back(pool.async([&module_producer, args](std::string name, Target t, Outputs o) {
+            debug(1) << "compile_multitarget: produce_sub_target " << name << "\n";
+            Module m = module_producer(name, t);
+            *args = m.get_function_by_name(name).args;
             debug(1) << "compile_multitarget: compile_sub_target " << o.object_name << "\n";
             m.compile(o);
-        }, std::move(sub_module), std::move(sub_out)));
+        }, std::move(sub_fn_name), std::move(sub_fn_target), std::move(sub_out)));
 
         const uint64_t cur_target_mask = target_feature_mask(target);
         Expr can_use = (target == base_target) ?
@@ -577,6 +619,15 @@ void compile_multitarget(const std::string &fn_name,
         }, std::move(runtime_target), std::move(runtime_out)));
     }
 
+    // The wrapper needs the arguments of the sub-modules. They should
+    // be the same across all targets anyway, but base_target is always
+    // the last one. Use get() so that errors from the module producer
+    // are propagated to the caller.
+    for (auto &f : sub_target_futures) {
+        f.get();
+    }
+    const std::vector<LoweredArgument> &base_target_args = sub_target_args.back();
+
     if (needs_wrapper) {
         Expr indirect_result = Call::make(Int(32), Call::call_cached_indirect_function, wrapper_args, Call::Intrinsic);
         std::string private_result_name = unique_name(fn_name + "_result");
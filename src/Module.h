@@ -97,6 +97,10 @@ public:
      * for that schedule. */
     const std::string &auto_schedule() const;
 
+    /** If this Module came from a Generator, this is a static estimate of
+     * its peak memory use and working sets. */
+    const std::string &memory_estimate() const;
+
     /** The declarations contained in this module. */
     // @{
     const std::vector<Buffer<>> &buffers() const;
@@ -141,6 +145,10 @@ public:
     /** Set the auto_schedule text for the Module. It is an error to call this
      * multiple times for a given Module. */
     void set_auto_schedule(const std::string &auto_schedule);
+
+    /** Set the memory estimate text for the Module. It is an error to call
+     * this multiple times for a given Module. */
+    void set_memory_estimate(const std::string &memory_estimate);
 };
 
 /** Link a set of modules together into one module. */
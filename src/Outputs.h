@@ -54,6 +54,10 @@ struct Outputs {
      * output is desired. */
     std::string schedule_name;
 
+    /** The name of the emitted static memory estimate file. Empty if no
+     * memory estimate output is desired. */
+    std::string memory_estimate_name;
+
     /** Make a new Outputs struct that emits everything this one does
      * and also an object file with the given name. */
     Outputs object(const std::string &object_name) const {
@@ -133,6 +137,14 @@ struct Outputs {
         updated.schedule_name = schedule_name;
         return updated;
     }
+
+    /** Make a new Outputs struct that emits everything this one does
+     * and also a static memory estimate file with the given name. */
+    Outputs memory_estimate(const std::string &memory_estimate_name) const {
+        Outputs updated = *this;
+        updated.memory_estimate_name = memory_estimate_name;
+        return updated;
+    }
 };
 
 }
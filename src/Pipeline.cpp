@@ -1,11 +1,18 @@
 #include <algorithm>
+#include <chrono>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <string.h>
 
 #include "Pipeline.h"
 #include "Argument.h"
+#include "CompileTimeProfiler.h"
 #include "FindCalls.h"
 #include "Func.h"
 #include "InferArguments.h"
 #include "IRVisitor.h"
+#include "ImageParam.h"
 #include "LLVM_Headers.h"
 #include "LLVM_Output.h"
 #include "Lower.h"
@@ -13,6 +20,8 @@
 #include "ParamMap.h"
 #include "PrintLoopNest.h"
 #include "RealizationOrder.h"
+#include "Simplify.h"
+#include "ThreadPool.h"
 
 using namespace Halide::Internal;
 
@@ -32,6 +41,129 @@ std::string output_name(const string &filename, const Module &m, const char* ext
     return output_name(filename, m.name(), ext);
 }
 
+// Set a scalar parameter to a constant value, returning false if the
+// value is not a constant.
+bool set_scalar_to_constant(Parameter &p, Expr value) {
+    value = simplify(cast(p.type(), value));
+    halide_scalar_value_t v;
+    memset(&v, 0, sizeof(v));
+    const int64_t *i = as_const_int(value);
+    const uint64_t *u = as_const_uint(value);
+    const double *f = as_const_float(value);
+    Type t = p.type();
+    if (i && t.bits() == 8) {
+        v.u.i8 = (int8_t)*i;
+    } else if (i && t.bits() == 16) {
+        v.u.i16 = (int16_t)*i;
+    } else if (i && t.bits() == 32) {
+        v.u.i32 = (int32_t)*i;
+    } else if (i && t.bits() == 64) {
+        v.u.i64 = *i;
+    } else if (u && t.bits() == 1) {
+        v.u.b = (*u != 0);
+    } else if (u && t.bits() == 8) {
+        v.u.u8 = (uint8_t)*u;
+    } else if (u && t.bits() == 16) {
+        v.u.u16 = (uint16_t)*u;
+    } else if (u && t.bits() == 32) {
+        v.u.u32 = (uint32_t)*u;
+    } else if (u && t.bits() == 64) {
+        v.u.u64 = *u;
+    } else if (f && t.bits() == 32) {
+        v.u.f32 = (float)*f;
+    } else if (f && t.bits() == 64) {
+        v.u.f64 = *f;
+    } else {
+        return false;
+    }
+    p.set_scalar(t, v);
+    return true;
+}
+
+// Make a buffer with the given mins and extents, filled with zeros.
+Buffer<> make_zero_buffer(Type t, const vector<int> &mins, const vector<int> &extents,
+                          const string &name) {
+    Buffer<> b(t, extents, name);
+    b.set_min(mins);
+    memset(b.raw_buffer()->host, 0, b.size_in_bytes());
+    return b;
+}
+
+// Binds Parameters to values for autotuning, and restores their old
+// values when it goes out of scope, even if compiling or running a
+// candidate throws.
+class ScopedParamBindings {
+    vector<Parameter> buffers;
+    vector<std::pair<Parameter, halide_scalar_value_t>> scalars;
+
+public:
+    ScopedParamBindings() = default;
+    ScopedParamBindings(const ScopedParamBindings &) = delete;
+    ScopedParamBindings &operator=(const ScopedParamBindings &) = delete;
+
+    // Bind a buffer Parameter that isn't bound yet.
+    void bind_buffer(Parameter p, const Buffer<> &b) {
+        p.set_buffer(b);
+        buffers.push_back(p);
+    }
+
+    // Set a scalar Parameter to a constant value, returning false if
+    // the value is not a constant.
+    bool bind_scalar(Parameter p, Expr value) {
+        halide_scalar_value_t old;
+        memcpy(&old, p.scalar_address(), p.type().bytes());
+        if (!set_scalar_to_constant(p, value)) {
+            return false;
+        }
+        scalars.push_back({p, old});
+        return true;
+    }
+
+    ~ScopedParamBindings() {
+        for (Parameter &p : buffers) {
+            p.set_buffer(Buffer<>());
+        }
+        for (auto &s : scalars) {
+            s.first.set_scalar(s.first.type(), s.second);
+        }
+    }
+};
+
+double seconds_between(std::chrono::steady_clock::time_point start,
+                       std::chrono::steady_clock::time_point end) {
+    return std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
+}
+
+// Return the fastest time of one call to op, in seconds. Calls are
+// timed in batches that are long enough for the clock's resolution not
+// to matter, until at least three batches and min_time have gone by,
+// or max_time is exceeded.
+double time_fastest_run(const std::function<void()> &op, double min_time, double max_time) {
+    using Clock = std::chrono::steady_clock;
+    // Warm up.
+    op();
+    auto start = Clock::now();
+    double best = std::numeric_limits<double>::max();
+    int iterations = 1;
+    for (int batches = 1; ; batches++) {
+        auto batch_start = Clock::now();
+        for (int i = 0; i < iterations; i++) {
+            op();
+        }
+        auto batch_end = Clock::now();
+        double t = seconds_between(batch_start, batch_end);
+        best = std::min(best, t / iterations);
+        double elapsed = seconds_between(start, batch_end);
+        if (elapsed >= max_time || (elapsed >= min_time && batches >= 3)) {
+            break;
+        }
+        if (t < 1e-3) {
+            iterations *= 2;
+        }
+    }
+    return best;
+}
+
 Outputs static_library_outputs(const string &filename_prefix, const Target &target) {
     Outputs outputs = Outputs().c_header(filename_prefix + ".h");
     if (target.os == Target::Windows && !target.has_feature(Target::MinGW)) {
@@ -158,6 +290,140 @@ string Pipeline::auto_schedule(const Target &target, const MachineParams &arch_p
     return generate_schedules(contents->outputs, target, arch_params);
 }
 
+string Pipeline::auto_schedule(const Target &target, const MachineParams &arch_params,
+                               const AutoScheduleProfile &profile) {
+    user_assert(target.arch == Target::X86 || target.arch == Target::ARM ||
+                target.arch == Target::POWERPC || target.arch == Target::MIPS)
+        << "Automatic scheduling is currently supported only on these architectures.";
+    return generate_schedules(contents->outputs, target, arch_params, profile);
+}
+
+string Pipeline::auto_schedule(const Target &target, const MachineParams &arch_params,
+                               const vector<AutoScheduleSizeClass> &size_classes,
+                               const AutoScheduleProfile &profile) {
+    user_assert(target.arch == Target::X86 || target.arch == Target::ARM ||
+                target.arch == Target::POWERPC || target.arch == Target::MIPS)
+        << "Automatic scheduling is currently supported only on these architectures.";
+    return generate_schedules(contents->outputs, target, arch_params, size_classes, profile);
+}
+
+string Pipeline::auto_schedule(const Target &target, const MachineParams &arch_params,
+                               const AutotuneParams &autotune_params) {
+    user_assert(target.arch == Target::X86 || target.arch == Target::ARM ||
+                target.arch == Target::POWERPC || target.arch == Target::MIPS)
+        << "Automatic scheduling is currently supported only on these architectures.";
+    user_assert(autotune_params.candidates > 0)
+        << "Autotuning requires at least one candidate schedule.";
+
+    vector<AutoScheduleChoice> choices =
+        enumerate_schedule_choices(contents->outputs, target, arch_params,
+                                   autotune_params.candidates, autotune_params.seed);
+
+    // Bind the inputs that are not bound already to buffers of the estimated
+    // sizes, and the scalar params to their estimates, until we return. The
+    // Parameters are shared with the copies of the pipeline that are
+    // benchmarked.
+    ScopedParamBindings bindings;
+    for (const InferredArgument &arg : ::infer_arguments(Stmt(), contents->outputs)) {
+        if (!arg.param.defined() || arg.buffer.defined()) {
+            continue;
+        }
+        Parameter p = arg.param;
+        if (p.is_buffer()) {
+            if (p.buffer().defined()) {
+                continue;
+            }
+            vector<int> mins, extents;
+            for (int i = 0; i < p.dimensions(); i++) {
+                Expr min = p.min_constraint_estimate(i);
+                Expr extent = p.extent_constraint_estimate(i);
+                const int64_t *m = min.defined() ? as_const_int(simplify(min)) : nullptr;
+                const int64_t *e = extent.defined() ? as_const_int(simplify(extent)) : nullptr;
+                user_assert(m && e)
+                    << "Autotuning requires constant estimates on dimension " << i
+                    << " of input " << p.name() << "\n";
+                mins.push_back((int)*m);
+                extents.push_back((int)*e);
+            }
+            bindings.bind_buffer(p, make_zero_buffer(p.type(), mins, extents, p.name()));
+        } else if (p.estimate().defined()) {
+            bindings.bind_scalar(p, p.estimate());
+        }
+    }
+
+    // Make the outputs of the estimated sizes.
+    vector<Buffer<>> output_buffers;
+    for (const Function &f : contents->outputs) {
+        vector<int> mins, extents;
+        for (const string &arg : f.args()) {
+            const int64_t *m = nullptr, *e = nullptr;
+            for (const Bound &b : f.schedule().estimates()) {
+                if (b.var == arg) {
+                    m = as_const_int(simplify(b.min));
+                    e = as_const_int(simplify(b.extent));
+                }
+            }
+            user_assert(m && e)
+                << "Autotuning requires constant estimates on dimension " << arg
+                << " of output " << f.name() << "\n";
+            mins.push_back((int)*m);
+            extents.push_back((int)*e);
+        }
+        for (Type t : f.output_types()) {
+            output_buffers.push_back(make_zero_buffer(t, mins, extents, f.name()));
+        }
+    }
+    Realization dst(output_buffers);
+
+    using Clock = std::chrono::steady_clock;
+    auto start = Clock::now();
+    double budget_per_candidate = autotune_params.budget / choices.size();
+
+    size_t best = 0;
+    double best_time = 0, model_time = 0;
+    size_t measured = 0;
+    for (size_t i = 0; i < choices.size(); i++) {
+        double elapsed = seconds_between(start, Clock::now());
+        if (i > 0 && elapsed >= autotune_params.budget) {
+            break;
+        }
+
+        // Schedule and compile a copy of the pipeline.
+        std::map<string, Function> env;
+        for (Function f : contents->outputs) {
+            std::map<string, Function> more_funcs = find_transitive_calls(f);
+            env.insert(more_funcs.begin(), more_funcs.end());
+        }
+        vector<Function> copies = deep_copy(contents->outputs, env).first;
+        generate_schedules(copies, target, arch_params, choices[i]);
+        vector<Func> funcs;
+        for (Function f : copies) {
+            funcs.push_back(Func(f));
+        }
+        Pipeline candidate(funcs);
+        candidate.compile_jit(target);
+
+        double t = time_fastest_run([&]() { candidate.realize(dst, target); },
+                                    budget_per_candidate / 4, budget_per_candidate);
+        debug(1) << "Autotuning candidate " << i << ": " << t * 1000 << " ms\n";
+
+        if (i == 0) {
+            model_time = t;
+        }
+        if (i == 0 || t < best_time) {
+            best = i;
+            best_time = t;
+        }
+        measured++;
+    }
+
+    std::ostringstream oss;
+    oss << "// Autotuning: " << measured << " candidates benchmarked, the best one runs in "
+        << best_time * 1000 << " ms (" << model_time * 1000 << " ms for the cost model's choice)\n";
+    oss << generate_schedules(contents->outputs, target, arch_params, choices[best]);
+    return oss.str();
+}
+
 Func Pipeline::get_func(size_t index) {
     // Compute an environment
     std::map<string, Function> env;
@@ -174,6 +440,30 @@ Func Pipeline::get_func(size_t index) {
     return Func(env.find(order[index])->second);
 }
 
+ImageParam Pipeline::get_input(const string &name) {
+    for (const InferredArgument &arg : ::infer_arguments(Stmt(), contents->outputs)) {
+        if (!arg.param.defined() || !arg.param.is_buffer() || arg.param.name() != name) {
+            continue;
+        }
+        // Use the Func that wraps the image in the pipeline, if there is
+        // one, so that calls through the handle refer to the same Func.
+        std::map<string, Function> env;
+        for (Function f : contents->outputs) {
+            std::map<string, Function> more_funcs = find_transitive_calls(f);
+            env.insert(more_funcs.begin(), more_funcs.end());
+        }
+        const auto &iter = env.find(name + "_im");
+        if (iter != env.end()) {
+            return ImageParam(arg.param, Func(iter->second));
+        }
+        ImageParam im(arg.param, Func());
+        im.func = im.create_func();
+        return im;
+    }
+    user_error << "There is no input image named \"" << name << "\" in the pipeline.\n";
+    return ImageParam();
+}
+
 void Pipeline::compile_to(const Outputs &output_files,
                           const vector<Argument> &args,
                           const string &fn_name,
@@ -263,7 +553,12 @@ void Pipeline::compile_to_static_library(const string &filename_prefix,
 void Pipeline::compile_to_multitarget_static_library(const std::string &filename_prefix,
                                                      const std::vector<Argument> &args,
                                                      const std::vector<Target> &targets) {
-    auto module_producer = [this, &args](const std::string &name, const Target &target) -> Module {
+    // compile_multitarget() produces the modules of the targets
+    // concurrently, but they all share this Pipeline, so lower them
+    // one at a time.
+    std::mutex mutex;
+    auto module_producer = [this, &args, &mutex](const std::string &name, const Target &target) -> Module {
+        std::lock_guard<std::mutex> lock(mutex);
         return compile_to_module(args, name, target);
     };
     Outputs outputs = static_library_outputs(filename_prefix, targets.back());
@@ -444,6 +739,7 @@ void *Pipeline::compile_jit(const Target &target_arg) {
 
     // Compile to jit module
     JITModule jit_module(module, f, make_externs_jit_module(target_arg, lowered_externs));
+    report_compile_times("JIT compilation of " + name);
 
     // Dump bitcode to a file if the environment variable
     // HL_GENBITCODE is defined to a nonzero value.
@@ -462,6 +758,37 @@ void *Pipeline::compile_jit(const Target &target_arg) {
     return jit_module.main_function();
 }
 
+namespace {
+
+// The threads that compile pipelines in the background.
+ThreadPool<void> &jit_compile_pool() {
+    static ThreadPool<void> pool;
+    return pool;
+}
+
+}  // namespace
+
+std::future<void> Pipeline::compile_jit_async(const Target &target) {
+    user_assert(defined()) << "Pipeline is undefined\n";
+
+    // Keep the pipeline alive until it is compiled.
+    Pipeline pipeline = *this;
+    std::shared_ptr<std::promise<void>> compiled = std::make_shared<std::promise<void>>();
+    jit_compile_pool().async([pipeline, target, compiled]() mutable {
+#ifdef WITH_EXCEPTIONS
+        try {
+            pipeline.compile_jit(target);
+        } catch (...) {
+            compiled->set_exception(std::current_exception());
+            return;
+        }
+#else
+        pipeline.compile_jit(target);
+#endif
+        compiled->set_value();
+    });
+    return compiled->get_future();
+}
 
 void Pipeline::set_error_handler(void (*handler)(void *, const char *)) {
     user_assert(defined()) << "Pipeline is undefined\n";
@@ -916,7 +1243,10 @@ void Pipeline::realize(Realization dst, const Target &t, const ParamMap &param_m
     int exit_status = contents->jit_module.argv_function()(&(args[0]));
     debug(2) << "Back from jitted function. Exit status was " << exit_status << "\n";
 
-    // If we're profiling, report runtimes and reset profiler stats.
+    // If we're profiling, report runtimes and reset profiler stats. If
+    // HL_PROFILE_FILE is set, also save them there first, as AOT
+    // pipelines do at exit, since nothing is left to save once they
+    // are reset.
     if (target.has_feature(Target::Profile)) {
         JITModule::Symbol report_sym =
             contents->jit_module.find_symbol_by_name("halide_profiler_report");
@@ -927,6 +1257,16 @@ void Pipeline::realize(Realization dst, const Target &t, const ParamMap &param_m
             void (*report_fn_ptr)(void *) = (void (*)(void *))(report_sym.address);
             report_fn_ptr(uc);
 
+            string profile_file = get_env_variable("HL_PROFILE_FILE");
+            JITModule::Symbol save_sym =
+                contents->jit_module.find_symbol_by_name("halide_profiler_save");
+            if (!profile_file.empty() && save_sym.address) {
+                int (*save_fn_ptr)(void *, const char *) =
+                    (int (*)(void *, const char *))(save_sym.address);
+                user_assert(save_fn_ptr(uc, profile_file.c_str()) == 0)
+                    << "Could not save the profile to " << profile_file << "\n";
+            }
+
             void (*reset_fn_ptr)() = (void (*)())(reset_sym.address);
             reset_fn_ptr();
         }
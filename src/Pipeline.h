@@ -7,6 +7,7 @@
  * pipeline.
  */
 
+#include <future>
 #include <vector>
 
 #include "AutoSchedule.h"
@@ -22,6 +23,7 @@ namespace Halide {
 
 struct Argument;
 class Func;
+class ImageParam;
 struct Outputs;
 struct PipelineContents;
 
@@ -86,10 +88,47 @@ public:
                                      const MachineParams &arch_params = MachineParams::generic());
     //@}
 
+    /** Generate a schedule for the pipeline, calibrating the cost model
+     * against the time of each Func measured by a previous run of the
+     * pipeline compiled with Target::Profile (see AutoScheduleProfile). */
+    std::string auto_schedule(const Target &target,
+                              const MachineParams &arch_params,
+                              const AutoScheduleProfile &profile);
+
+    /** Generate a schedule for the pipeline, specialized for each of the
+     * 'size_classes'. The estimates of each class replace the ones set on
+     * the outputs and input ImageParams, and the Funcs whose loop nests
+     * can differ between sizes get a specialization per class, selected
+     * at run time by the extents of the input ImageParams. The default
+     * schedule, for the estimates set on the Funcs and ImageParams, is
+     * used when no class matches. */
+    std::string auto_schedule(const Target &target,
+                              const MachineParams &arch_params,
+                              const std::vector<AutoScheduleSizeClass> &size_classes,
+                              const AutoScheduleProfile &profile = AutoScheduleProfile());
+
+    /** Generate a schedule for the pipeline by benchmarking candidate
+     * schedules instead of relying only on the cost model. Up to
+     * 'autotune_params.candidates' alternatives among the groupings and
+     * tile configurations considered by the auto-scheduler are
+     * JIT-compiled for 'target' and run on buffers of the estimated
+     * sizes, within a budget of 'autotune_params.budget' seconds, and the
+     * fastest one is applied. Input buffers that are not bound are filled
+     * with zeros, and scalar params are set to their estimates while
+     * benchmarking. 'target' must be able to run on the host. */
+    std::string auto_schedule(const Target &target,
+                              const MachineParams &arch_params,
+                              const AutotuneParams &autotune_params);
+
     /** Return handle to the index-th Func within the pipeline based on the
      * realization order. */
     Func get_func(size_t index);
 
+    /** Return handle to the input image of the pipeline with the given
+     * name. The schedules printed by the auto-scheduler use it to refer
+     * to the inputs. */
+    ImageParam get_input(const std::string &name);
+
     /** Compile and generate multiple target files with single call.
      * Deduces target files based on filenames specified in
      * output_files struct.
@@ -212,6 +251,16 @@ public:
      */
      void *compile_jit(const Target &target = get_jit_target_from_environment());
 
+    /** JIT compile the pipeline like compile_jit, but on a background
+     * thread, and return a future that becomes ready once the
+     * pipeline is compiled. Several pipelines can be compiled
+     * concurrently this way, e.g. to warm up all the pipelines of a
+     * server at startup, as long as they don't share Funcs. The
+     * pipeline must not be used in any other way until the future is
+     * ready. If Halide is built with exceptions, errors during
+     * compilation are rethrown by the get method of the future. */
+    std::future<void> compile_jit_async(const Target &target = get_jit_target_from_environment());
+
     /** Set the error handler function that be called in the case of
      * runtime errors during halide pipelines. If you are compiling
      * statically, you can also just define your own function with
@@ -4,9 +4,11 @@
 #include <limits>
 
 #include "Profiling.h"
+#include "AutoScheduleUtils.h"
 #include "CodeGen_Internal.h"
 #include "IRMutator.h"
 #include "IROperator.h"
+#include "RegionCosts.h"
 #include "Scope.h"
 #include "Simplify.h"
 #include "Substitute.h"
@@ -16,9 +18,125 @@ namespace Halide {
 namespace Internal {
 
 using std::map;
+using std::set;
 using std::string;
 using std::vector;
 
+namespace {
+
+// Prepend a record of the work done to each production, using the
+// static per-point costs of each stage and the bounds of the region
+// actually computed. The func is referenced by name until
+// InjectProfiling assigns it an id.
+class CountWork : public IRMutator2 {
+    const map<string, Function> &env;
+    set<string> inlines;
+    Scope<int> lets;
+
+    using IRMutator2::visit;
+
+    Expr stage_points(const Function &f, int stage) {
+        string prefix = f.name() + ".s" + std::to_string(stage) + ".";
+        const Definition &def = get_stage_definition(f, stage);
+
+        vector<string> dims;
+        const vector<string> f_args = f.args();
+        for (size_t i = 0; i < f_args.size(); i++) {
+            // Update stages only loop over the dimensions that are
+            // pure in that definition.
+            const Variable *v = def.args()[i].as<Variable>();
+            if (stage == 0 || (v && v->name == f_args[i])) {
+                dims.push_back(f_args[i]);
+            }
+        }
+        for (const ReductionVariable &rv : def.schedule().rvars()) {
+            dims.push_back(rv.var);
+        }
+
+        Expr points = make_const(UInt(64), 1);
+        for (const string &d : dims) {
+            string min_name = prefix + d + ".min", max_name = prefix + d + ".max";
+            if (!lets.contains(min_name) || !lets.contains(max_name)) {
+                return Expr();
+            }
+            Expr extent = (Variable::make(Int(32), max_name) -
+                           Variable::make(Int(32), min_name) + 1);
+            points *= cast<uint64_t>(max(extent, 0));
+        }
+        return points;
+    }
+
+    Stmt visit(const ProducerConsumer *op) override {
+        Stmt body = mutate(op->body);
+        auto iter = env.find(op->name);
+        if (!op->is_producer || iter == env.end()) {
+            return ProducerConsumer::make(op->name, op->is_producer, body);
+        }
+
+        const Function &f = iter->second;
+        Expr arith = make_zero(UInt(64));
+        Expr loaded = make_zero(UInt(64));
+        Expr stored = make_zero(UInt(64));
+        bool counted = false;
+        for (int stage = 0; stage <= (int)f.updates().size(); stage++) {
+            Cost cost = func_stage_cost(f, stage, env, inlines);
+            if (!cost.defined()) {
+                continue;
+            }
+            const int64_t *ops = as_const_int(cost.arith);
+            const int64_t *bytes = as_const_int(cost.memory);
+            Expr points = stage_points(f, stage);
+            if (!ops || !bytes || !points.defined()) {
+                continue;
+            }
+            int64_t store_bytes = 0;
+            for (const Type &t : f.output_types()) {
+                store_bytes += t.bytes();
+            }
+            arith += points * make_const(UInt(64), *ops);
+            loaded += points * make_const(UInt(64), std::max(*bytes - store_bytes, (int64_t)0));
+            stored += points * make_const(UInt(64), store_bytes);
+            counted = true;
+        }
+
+        if (counted) {
+            Expr record = Call::make(Int(32), "halide_profiler_record_work",
+                                     {op->name, simplify(arith), simplify(loaded), simplify(stored)},
+                                     Call::Extern);
+            body = Block::make(Evaluate::make(record), body);
+        }
+        return ProducerConsumer::make(op->name, op->is_producer, body);
+    }
+
+    Stmt visit(const LetStmt *op) override {
+        ScopedBinding<int> bind(lets, op->name, 0);
+        return IRMutator2::visit(op);
+    }
+
+    Stmt visit(const For *op) override {
+        // The pipeline state is only available on the host.
+        if (op->device_api != DeviceAPI::None &&
+            op->device_api != DeviceAPI::Host) {
+            return op;
+        }
+        return IRMutator2::visit(op);
+    }
+
+public:
+    CountWork(const map<string, Function> &env) : env(env) {
+        for (const auto &p : env) {
+            const Function &f = p.second;
+            if (f.schedule().compute_level().is_inlined() &&
+                f.is_pure() && !f.has_extern_definition()) {
+                inlines.insert(p.first);
+            }
+        }
+    }
+};
+
+}  // namespace
+
+
 class InjectProfiling : public IRMutator2 {
 public:
     map<string, int> indices;   // maps from func name -> index in buffer.
@@ -185,6 +303,20 @@ private:
         return stmt;
     }
 
+    Expr visit(const Call *op) override {
+        if (op->name == "halide_profiler_record_work" &&
+            op->call_type == Call::Extern &&
+            op->args[0].as<StringImm>()) {
+            int idx = get_func_id(op->args[0].as<StringImm>()->value);
+            Expr profiler_pipeline_state = Variable::make(Handle(), "profiler_pipeline_state");
+            return Call::make(op->type, op->name,
+                              {profiler_pipeline_state, idx,
+                               mutate(op->args[1]), mutate(op->args[2]), mutate(op->args[3])},
+                              Call::Extern);
+        }
+        return IRMutator2::visit(op);
+    }
+
     Stmt visit(const ProducerConsumer *op) override {
         int idx;
         Stmt body;
@@ -267,6 +399,10 @@ private:
     }
 };
 
+Stmt count_profiled_work(Stmt s, const map<string, Function> &env) {
+    return CountWork(env).mutate(s);
+}
+
 Stmt inject_profiling(Stmt s, string pipeline_name) {
     InjectProfiling profiling(pipeline_name);
     s = profiling.mutate(s);
@@ -22,9 +22,22 @@
  *   f0:          0.025673ms (42%)
  *   mandelbrot:  0.006444ms (10%)   peak: 505344   num: 104000   avg: 5376
  *   argmin:      0.027715ms (46%)   stack: 20
+ *
+ * Each Func also records the arithmetic ops and bytes moved by the
+ * regions it actually computed, using the static per-point costs from
+ * RegionCosts. These are reported as a roofline summary with the
+ * achieved GB/s, Gops/s and arithmetic intensity (ops per byte) of each
+ * Func. If HL_PEAK_GBPS and HL_PEAK_GOPS describe the machine, each
+ * Func is also placed against the roof:
+ *
+ *  roofline (peak 20 GB/s, 100 Gops/s, ridge 5 ops/byte):
+ *   f0:          9.81 GB/s   4.90 Gops/s   0.50 ops/byte   49% of roof, memory bound
  */
 
+#include <map>
+
 #include "IR.h"
+#include "Function.h"
 
 namespace Halide {
 namespace Internal {
@@ -38,6 +51,12 @@ namespace Internal {
  */
 Stmt inject_profiling(Stmt, std::string);
 
+/** Record the arithmetic ops and bytes loaded and stored by each
+ * production, computed from the per-point cost of each stage and the
+ * bounds it was realized over. Should be done after sliding window and
+ * before inject_profiling, which resolves the Func ids. */
+Stmt count_profiled_work(Stmt, const std::map<std::string, Function> &env);
+
 }
 }
 
@@ -341,6 +341,13 @@ RegionCosts::RegionCosts(const map<string, Function> &_env) : env(_env) {
     }
 }
 
+void RegionCosts::calibrate(const map<string, float> &scale) {
+    arith_scale = scale;
+    for (const auto &kv : env) {
+        func_cost[kv.first] = get_func_cost(kv.second);
+    }
+}
+
 Cost RegionCosts::stage_region_cost(string func, int stage, const DimBounds &bounds,
                                     const set<string> &inlines) {
     Function curr_f = get_element(env, func);
@@ -552,41 +559,13 @@ RegionCosts::detailed_load_costs(const map<string, Box> &regions,
 }
 
 Cost RegionCosts::get_func_stage_cost(const Function &f, int stage, const set<string> &inlines) {
-    if (f.has_extern_definition()) {
-        return Cost();
+    Cost cost = func_stage_cost(f, stage, env, inlines);
+    const auto &iter = arith_scale.find(f.name());
+    if (cost.defined() && (iter != arith_scale.end())) {
+        // Scale in fixed point, since the costs are integers.
+        Expr scale = make_const(cost.arith.type(), (int64_t)(iter->second * 1024));
+        cost.arith = simplify((cost.arith * scale) / 1024);
     }
-
-    Definition def = get_stage_definition(f, stage);
-
-    Cost cost(0, 0);
-
-    for (const auto &e : def.values()) {
-        Expr inlined_expr = perform_inline(e, env, inlines);
-        inlined_expr = simplify(inlined_expr);
-
-        Cost expr_cost = compute_expr_cost(inlined_expr);
-        internal_assert(expr_cost.defined());
-        cost.arith += expr_cost.arith;
-        cost.memory += expr_cost.memory;
-
-        // Accounting for the store
-        cost.memory += e.type().bytes();
-        cost.arith += 1;
-    }
-
-    if (!f.is_pure()) {
-        for (const auto &arg : def.args()) {
-            Expr inlined_arg = perform_inline(arg, env, inlines);
-            inlined_arg = simplify(inlined_arg);
-
-            Cost expr_cost = compute_expr_cost(inlined_arg);
-            internal_assert(expr_cost.defined());
-            cost.arith += expr_cost.arith;
-            cost.memory += expr_cost.memory;
-        }
-    }
-
-    cost.simplify();
     return cost;
 }
 
@@ -758,5 +737,45 @@ void Cost::simplify() {
     }
 }
 
+Cost func_stage_cost(const Function &f, int stage, const map<string, Function> &env,
+                     const set<string> &inlines) {
+    if (f.has_extern_definition()) {
+        return Cost();
+    }
+
+    Definition def = get_stage_definition(f, stage);
+
+    Cost cost(0, 0);
+
+    for (const auto &e : def.values()) {
+        Expr inlined_expr = perform_inline(e, env, inlines);
+        inlined_expr = simplify(inlined_expr);
+
+        Cost expr_cost = compute_expr_cost(inlined_expr);
+        internal_assert(expr_cost.defined());
+        cost.arith += expr_cost.arith;
+        cost.memory += expr_cost.memory;
+
+        // Accounting for the store
+        cost.memory += e.type().bytes();
+        cost.arith += 1;
+    }
+
+    if (!f.is_pure()) {
+        for (const auto &arg : def.args()) {
+            Expr inlined_arg = perform_inline(arg, env, inlines);
+            inlined_arg = simplify(inlined_arg);
+
+            Cost expr_cost = compute_expr_cost(inlined_arg);
+            internal_assert(expr_cost.defined());
+            cost.arith += expr_cost.arith;
+            cost.memory += expr_cost.memory;
+        }
+    }
+
+    cost.simplify();
+    return cost;
+}
+
 }
 }
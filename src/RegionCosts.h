@@ -51,6 +51,14 @@ struct RegionCosts {
      * in the pipeline. */
     Scope<Interval> input_estimates;
 
+    /** A map containing the factors by which the arithmetic cost of the
+     * stages of some functions is scaled, e.g. to match a profile. */
+    std::map<std::string, float> arith_scale;
+
+    /** Scale the arithmetic cost of the stages of the functions in 'scale'
+     * by the given factors, and re-compute their costs. */
+    void calibrate(const std::map<std::string, float> &scale);
+
     /** Return the cost of producing a region (specified by 'bounds') of a
      * function stage (specified by 'func' and 'stage'). 'inlines' specifies
      * names of all the inlined functions. */
@@ -138,6 +146,13 @@ struct RegionCosts {
  * cost of calling the function directly. */
 bool is_func_trivial_to_inline(const Function &func);
 
+/** Compute the cost of producing a single value by one stage of 'f', with
+ * the functions in 'inlines' inlined from 'env'. Unlike RegionCosts, this
+ * does not require estimates on the inputs of the pipeline. */
+Cost func_stage_cost(const Function &f, int stage,
+                     const std::map<std::string, Function> &env,
+                     const std::set<std::string> &inlines = std::set<std::string>());
+
 }
 }
 
@@ -2,6 +2,8 @@
 #include <algorithm>
 #include <cmath>
 #include <limits>
+#include <tuple>
+#include <unordered_map>
 #include <stdio.h>
 
 #include "Simplify.h"
@@ -5417,9 +5419,106 @@ private:
     }
 };
 
+struct SimplifyCache::Contents {
+    // The arguments of simplify() that affect the result, other than
+    // the expression itself. Only the constant bounds are used by
+    // the simplifier.
+    struct Key {
+        bool simplify_lets;
+        vector<std::tuple<string, int64_t, int64_t>> bounds;
+
+        bool operator<(const Key &other) const {
+            return std::tie(simplify_lets, bounds) < std::tie(other.simplify_lets, other.bounds);
+        }
+    };
+
+    IRCompareCache compare_cache;
+    map<Key, std::unordered_map<ExprWithCompareCache, Expr, ExprWithCompareCache::Hash>> results;
+    size_t size = 0;
+    int64_t hits = 0, misses = 0;
+
+    Contents() : compare_cache(8) {}
+
+    Expr simplify(const Expr &e, bool simplify_lets, const Scope<Interval> &bounds) {
+        Key key;
+        key.simplify_lets = simplify_lets;
+        for (Scope<Interval>::const_iterator iter = bounds.cbegin(); iter != bounds.cend(); ++iter) {
+            const int64_t *i_min = as_const_int(iter.value().min);
+            const int64_t *i_max = as_const_int(iter.value().max);
+            if (i_min && i_max && iter.value().min.type().is_scalar()) {
+                key.bounds.emplace_back(iter.name(), *i_min, *i_max);
+            }
+        }
+
+        // Forget everything when there are too many results, to bound
+        // the memory used.
+        if (size >= SimplifyCache::max_size) {
+            results.clear();
+            compare_cache.clear();
+            size = 0;
+        }
+
+        ExprWithCompareCache cached_expr(e, &compare_cache);
+        {
+            const auto &r = results[key];
+            auto it = r.find(cached_expr);
+            if (it != r.end()) {
+                hits++;
+                return it->second;
+            }
+        }
+
+        // The simplifier may call simplify() recursively, which may
+        // clear the results, so look them up again afterwards.
+        misses++;
+        Expr result = Simplify(simplify_lets, &bounds, &Scope<ModulusRemainder>::empty_scope()).mutate(e);
+        results[key].emplace(cached_expr, result);
+        size++;
+        return result;
+    }
+};
+
+namespace {
+
+// The cache used by simplify() on this thread, if any.
+thread_local SimplifyCache::Contents *current_simplify_cache = nullptr;
+
+}  // namespace
+
+SimplifyCache::SimplifyCache() : contents(new Contents), previous(current_simplify_cache) {
+    current_simplify_cache = contents.get();
+}
+
+SimplifyCache::~SimplifyCache() {
+    internal_assert(current_simplify_cache == contents.get())
+        << "SimplifyCache objects must be destroyed in the reverse order of their creation\n";
+    current_simplify_cache = previous;
+    debug(2) << "SimplifyCache: " << hits() << " hits, " << misses() << " misses\n";
+}
+
+int64_t SimplifyCache::hits() const {
+    return contents->hits;
+}
+
+int64_t SimplifyCache::misses() const {
+    return contents->misses;
+}
+
+size_t SimplifyCache::size() const {
+    return contents->size;
+}
+
 Expr simplify(Expr e, bool simplify_lets,
               const Scope<Interval> &bounds,
               const Scope<ModulusRemainder> &alignment) {
+    // Constants and variables are cheaper to simplify than to look
+    // up. The alignment info may have a containing scope we can't
+    // see, so we can't tell what it contains.
+    if (current_simplify_cache &&
+        &alignment == &Scope<ModulusRemainder>::empty_scope() &&
+        !is_const(e) && !e.as<Variable>()) {
+        return current_simplify_cache->simplify(e, simplify_lets, bounds);
+    }
     return Simplify(simplify_lets, &bounds, &alignment).mutate(e);
 }
 
@@ -7035,6 +7134,23 @@ void simplify_test() {
         check(require(x == x, result, "error"), result);
     }
 
+    // Check that the cache returns the previous result for equal
+    // expressions, but not for different bounds.
+    {
+        SimplifyCache cache;
+        Expr a = simplify(min(x * 2 + 4, x * 2 + 6) > y);
+        Expr b = simplify(min(x * 2 + 4, x * 2 + 6) > y);
+        internal_assert(a.same_as(b) && cache.hits() == 1 && cache.misses() == 1);
+
+        Scope<Interval> bounds;
+        bounds.push("x", Interval(0, 4));
+        Expr c = simplify(min(x, 8) + y, true, bounds);
+        bounds.pop("x");
+        bounds.push("x", Interval(10, 14));
+        Expr d = simplify(min(x, 8) + y, true, bounds);
+        internal_assert(equal(c, x + y) && equal(d, y + 8) && cache.misses() == 3);
+    }
+
     std::cout << "Simplify test passed" << std::endl;
 }
 }
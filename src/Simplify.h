@@ -6,6 +6,7 @@
  */
 
 #include <cmath>
+#include <memory>
 
 #include "IR.h"
 #include "Bounds.h"
@@ -29,6 +30,44 @@ Expr simplify(Expr, bool simplify_lets = true,
               const Scope<ModulusRemainder> &alignment = Scope<ModulusRemainder>::empty_scope());
 // @}
 
+/** While an object of this type is alive, calls to simplify(Expr) on
+ * the current thread remember their results, and return them again
+ * for expressions equal to one already simplified with the same
+ * simplify_lets flag and constant bounds. Calls with alignment info
+ * are not cached. Func and parameter names are only unique within a
+ * pipeline, so a cache should not outlive the lowering of one
+ * pipeline; lower() makes one for each pipeline if the environment
+ * variable HL_SIMPLIFY_CACHE is set to 1. Caches may be nested, in
+ * which case the innermost one is used. A cache forgets everything
+ * when it holds max_size results. */
+class SimplifyCache {
+public:
+    SimplifyCache();
+    ~SimplifyCache();
+
+    /** The number of calls to simplify() answered by the cache, and
+     * the number that had to simplify the expression. */
+    // @{
+    int64_t hits() const;
+    int64_t misses() const;
+    // @}
+
+    /** The number of results the cache currently holds. */
+    size_t size() const;
+
+    /** The number of results at which the cache is cleared. */
+    static const size_t max_size = 1 << 16;
+
+    struct Contents;
+
+private:
+    std::unique_ptr<Contents> contents;
+    Contents *previous;
+
+    SimplifyCache(const SimplifyCache &) = delete;
+    SimplifyCache &operator=(const SimplifyCache &) = delete;
+};
+
 /** A common use of the simplifier is to prove boolean expressions are
  * true at compile time. Equivalent to is_one(simplify(e)) */
 bool can_prove(Expr e);
@@ -6,6 +6,8 @@
 #include "CSE.h"
 #include "ExprUsesVar.h"
 
+#include <unordered_map>
+
 namespace Halide {
 namespace Internal {
 
@@ -896,7 +898,7 @@ class SolveForInterval : public IRVisitor {
     // are just many different right-hand-sides. If we solve the
     // expressions once for a symbolic RHS, we can cache and reuse
     // that solution over and over, taming the exponential beast.
-    std::map<Expr, Interval, IRDeepCompare> cache_f, cache_t;
+    std::unordered_map<Expr, Interval, IRDeepHash, IRDeepEqual> cache_f, cache_t;
 
     // Solve an expression, or set result to the previously found solution.
     void cached_solve(Expr cond) {
@@ -3,6 +3,8 @@
 #include "IROperator.h"
 #include "runtime/HalideRuntime.h"
 
+#include <set>
+
 namespace Halide {
 namespace Internal {
 
@@ -10,6 +12,7 @@ using std::vector;
 using std::map;
 using std::string;
 using std::pair;
+using std::set;
 
 struct TraceEventBuilder {
     string func;
@@ -43,6 +46,10 @@ public:
     const map<string, Function> &env;
     bool trace_all_loads, trace_all_stores, trace_all_realizations;
 
+    // The Funcs that need a counter of traced events to enforce
+    // Func::trace_limit.
+    set<string> limited_funcs;
+
     InjectTracing(const map<string, Function> &e, const Target &t)
         : env(e) {
         trace_all_loads = t.has_feature(Target::TraceLoads);
@@ -65,6 +72,43 @@ public:
 private:
     using IRMutator2::visit;
 
+    // Wrap a trace call in the checks required by the Function's
+    // trace filter, so that filtered events never build a packet.
+    Expr filter_trace(const Function &f, Expr trace, const vector<Expr> &coords) {
+        const TraceFilter &filter = f.trace_filter();
+        if (!filter.defined()) {
+            return trace;
+        }
+
+        Expr in_filter = const_true();
+        for (size_t i = 0; i < filter.region_min.size() && i < coords.size(); i++) {
+            Expr min = filter.region_min[i];
+            Expr extent = filter.region_extent[i];
+            in_filter = in_filter && coords[i] >= min && coords[i] < min + extent;
+        }
+        if (filter.sample_every > 1) {
+            for (const Expr &c : coords) {
+                in_filter = in_filter && (c / filter.sample_tile) % filter.sample_every == 0;
+            }
+        }
+
+        // The limit is checked last, so that events rejected by the
+        // other filters don't use up the budget.
+        if (filter.event_limit > 0) {
+            limited_funcs.insert(f.name());
+            Expr counter = Variable::make(type_of<int32_t *>(), f.name() + ".trace_count");
+            Expr take = Call::make(Int(32), "halide_trace_take",
+                                   {counter, filter.event_limit}, Call::Extern);
+            trace = Call::make(Int(32), Call::if_then_else,
+                               {take != 0, trace, 0}, Call::PureIntrinsic);
+        }
+        if (!is_one(in_filter)) {
+            trace = Call::make(Int(32), Call::if_then_else,
+                               {in_filter, trace, 0}, Call::PureIntrinsic);
+        }
+        return trace;
+    }
+
     Expr visit(const Call *op) override {
         Expr expr = IRMutator2::visit(op);
         op = expr.as<Call>();
@@ -98,6 +142,9 @@ private:
             builder.parent_id = trace_parent;
             builder.value_index = op->value_index;
             Expr trace = builder.build();
+            if (op->call_type == Call::Halide) {
+                trace = filter_trace(env.at(op->name), trace, op->args);
+            }
 
             expr = Let::make(value_var_name, op,
                              Call::make(op->type, Call::return_second,
@@ -135,7 +182,7 @@ private:
                 builder.type = t;
                 builder.value_index = (int)i;
                 builder.value = {value_var};
-                Expr trace = builder.build();
+                Expr trace = filter_trace(f, builder.build(), op->args);
 
                 traces[i] = Let::make(value_var_name, values[i],
                                       Call::make(t, Call::return_second,
@@ -287,6 +334,14 @@ Stmt inject_tracing(Stmt s, const string &pipeline_name,
     // Strip off the dummy realize blocks
     s = RemoveRealizeOverOutput(outputs).mutate(s);
 
+    // Give each Func with a tracing limit a counter of the events
+    // traced so far in this invocation of the pipeline.
+    for (const string &f : tracing.limited_funcs) {
+        string counter = f + ".trace_count";
+        s = Block::make(Store::make(counter, 0, 0, Parameter(), const_true()), s);
+        s = Allocate::make(counter, Int(32), MemoryType::Stack, {1}, const_true(), s);
+    }
+
     if (!s.same_as(original)) {
         // Add pipeline start and end events
         TraceEventBuilder builder;
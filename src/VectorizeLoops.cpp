@@ -46,6 +46,19 @@ public:
 
 
 
+// Check if an Expr is a call to the trace helper, possibly wrapped in
+// the if_then_else checks injected by Func tracing filters.
+bool is_trace_call(const Expr &e) {
+    const Call *c = e.as<Call>();
+    if (!c) {
+        return false;
+    } else if (c->name == Call::trace) {
+        return true;
+    } else {
+        return c->is_intrinsic(Call::if_then_else) && is_trace_call(c->args[1]);
+    }
+}
+
 /** Find the exact max and min lanes of a vector expression. Not
  * conservative like bounds_of_expr, but uses similar rules for some
  * common node types where it can be exact. Assumes any vector
@@ -503,6 +516,15 @@ class VectorSubs : public IRMutator2 {
             // stored.
             new_args[5] = max_lanes;
             return Call::make(op->type, Call::trace, new_args, op->call_type);
+        } else if (op->is_intrinsic(Call::if_then_else) && is_trace_call(op->args[1])) {
+            // A filtered trace call. The vector is traced as a whole
+            // if any of its lanes pass the filter.
+            Expr cond = new_args[0];
+            if (cond.type().is_vector()) {
+                cond = bounds_of_lanes(cond).max;
+            }
+            return Call::make(op->type, Call::if_then_else,
+                              {cond, new_args[1], new_args[2]}, op->call_type);
         } else {
             // Widen the args to have the same lanes as the max lanes found
             for (size_t i = 0; i < new_args.size(); i++) {
@@ -476,7 +476,11 @@ struct halide_trace_packet_t {
  * Halide checks the for existence of an environment variable called
  * HL_TRACE_FILE and opens that file. If HL_TRACE_FILE is not defined,
  * it outputs trace information to stdout in a human-readable
- * format. */
+ * format. If the environment variable HL_TRACE_COMPRESS is also set
+ * to a non-zero value, the file opened via HL_TRACE_FILE is written
+ * in a compressed format that delta-encodes each packet against the
+ * previous one from the same Func. The readers in util/ understand
+ * both formats. */
 extern void halide_set_trace_file(int fd);
 
 /** Halide calls this to retrieve the file descriptor to write binary
@@ -1438,6 +1442,11 @@ struct halide_profiler_func_stats {
 
     /** The total number of memory allocation of this Func. */
     int num_allocs;
+
+    /** The arithmetic ops, bytes loaded and bytes stored by the regions
+     * of this Func computed so far, estimated from the static per-point
+     * cost of each of its stages. */
+    uint64_t arith_ops, bytes_loaded, bytes_stored;
 };
 
 /** Per-pipeline state tracked by the sampling profiler. These exist
@@ -1544,9 +1553,67 @@ extern struct halide_profiler_pipeline_stats *halide_profiler_get_pipeline_state
 extern void halide_profiler_reset();
 
 /** Print out timing statistics for everything run since the last
- * reset. Also happens at process exit. */
+ * reset. Also happens at process exit. Funcs that recorded the work
+ * they did are also summarized as a roofline: achieved GB/s, Gops/s
+ * and arithmetic intensity. If the environment variables HL_PEAK_GBPS
+ * and HL_PEAK_GOPS are set to the machine's peak memory bandwidth and
+ * arithmetic throughput, each Func is also reported as a percentage of
+ * the roof at its arithmetic intensity. */
 extern void halide_profiler_report(void *user_context);
 
+/** Save the time and heap memory of every Func run since the last reset
+ * to a file, which can be fed back to the auto-scheduler to calibrate
+ * its cost model (see AutoScheduleProfile). Each pipeline is a line
+ * "pipeline <name> <runs> <time in ns>" followed by a line
+ * "func <name> <time in ns> <peak heap bytes> <total heap bytes> <heap allocations>"
+ * per Func. Also happens at process exit if the environment variable
+ * HL_PROFILE_FILE is set to the name of the file, and for JIT-compiled
+ * pipelines, after each realization. Returns zero on success. */
+extern int halide_profiler_save(void *user_context, const char *filename);
+
+/** An allocation or free of heap memory by a Func, recorded by the
+ * profiler when the allocation log is enabled. */
+struct halide_profiler_allocation_event {
+    /** The time of the event (in nanoseconds since the clock was started). */
+    uint64_t time;
+
+    /** The size of the allocation in bytes. */
+    uint64_t size;
+
+    /** Approximately identifies the thread that made the
+     * allocation. This is the address of the allocating code's stack
+     * frame, not an OS thread id: events from the same thread have
+     * nearby values, but nothing guarantees that the stacks of
+     * different threads are far apart. halide_profiler_allocation_report
+     * groups events into threads by assuming they are at least 128K
+     * apart. */
+    uint64_t thread;
+
+    /** The names of the pipeline and the Func. Global constant strings. */
+    const char *pipeline_name, *func_name;
+
+    /** Whether this is a free (rather than an allocation). */
+    bool is_free;
+};
+
+/** Start recording every heap allocation and free made by pipelines
+ * compiled with the profile feature, keeping at most max_events
+ * events. Discards any events already recorded. Passing zero turns
+ * recording off. Returns zero on success.
+ * WARNING: Do NOT call this method while any halide pipeline is
+ * running. */
+extern int halide_profiler_enable_allocation_log(int max_events);
+
+/** Get the allocation events recorded so far, in the order they were
+ * recorded. Returns the number of events. */
+extern int halide_profiler_get_allocation_log(const struct halide_profiler_allocation_event **events);
+
+/** Print every recorded allocation and free, followed by a breakdown
+ * by Func and by thread of the allocations live at the high-water mark
+ * of heap usage. The thread numbers are approximate; see
+ * halide_profiler_allocation_event::thread. */
+extern void halide_profiler_allocation_report(void *user_context);
+
 /// \name "Float16" functions
 /// These functions operate of bits (``uint16_t``) representing a half
 /// precision floating point number (IEEE-754 2008 binary16).
@@ -60,6 +60,9 @@ WEAK halide_profiler_pipeline_stats *find_or_create_pipeline(const char *pipelin
         p->funcs[i].stack_peak = 0;
         p->funcs[i].active_threads_numerator = 0;
         p->funcs[i].active_threads_denominator = 0;
+        p->funcs[i].arith_ops = 0;
+        p->funcs[i].bytes_loaded = 0;
+        p->funcs[i].bytes_stored = 0;
     }
     s->first_free_id += num_funcs;
     s->pipelines = p;
@@ -135,6 +138,136 @@ WEAK void sampling_profiler_thread(void *) {
     halide_mutex_unlock(&s->lock);
 }
 
+// The log of heap allocations and frees. Events past the capacity are
+// counted but dropped.
+WEAK halide_profiler_allocation_event *allocation_log = NULL;
+WEAK int allocation_log_capacity = 0;
+WEAK int allocation_log_size = 0;
+
+// Reading the clock and claiming a slot happen under this lock, so that
+// the events in the log are in order of time. It's separate from the
+// state's lock, which the sampling thread holds while it bills time.
+WEAK halide_mutex allocation_log_lock = { { 0 } };
+
+WEAK void log_allocation(void *user_context, halide_profiler_pipeline_stats *p_stats,
+                         int func_id, uint64_t size, bool is_free) {
+    if (!allocation_log) return;
+    halide_mutex_lock(&allocation_log_lock);
+    uint64_t time = halide_current_time_ns(user_context);
+    int i = allocation_log_size++;
+    halide_mutex_unlock(&allocation_log_lock);
+    if (i >= allocation_log_capacity) return;
+    halide_profiler_allocation_event *e = allocation_log + i;
+    e->time = time;
+    e->size = size;
+    e->thread = (uint64_t)(uintptr_t)__builtin_frame_address(0);
+    e->pipeline_name = p_stats->name;
+    e->func_name = p_stats->funcs[func_id].name;
+    e->is_free = is_free;
+}
+
+// Threads are identified by their stack. Frames of the same thread are
+// close together, while the stacks of different threads are far apart,
+// so group the stack addresses seen into ranges and number the ranges in
+// order of first appearance. This is a heuristic: two threads whose
+// stacks are within max_gap of each other get the same number.
+struct thread_ranges {
+    static const int max_threads = 256;
+    static const uint64_t max_gap = 128 * 1024;
+    uint64_t lo[max_threads], hi[max_threads];
+    int count;
+
+    int index_of(uint64_t addr) {
+        for (int i = 0; i < count; i++) {
+            if (addr + max_gap >= lo[i] && addr <= hi[i] + max_gap) {
+                if (addr < lo[i]) lo[i] = addr;
+                if (addr > hi[i]) hi[i] = addr;
+                return i;
+            }
+        }
+        if (count == max_threads) {
+            return max_threads - 1;
+        }
+        lo[count] = hi[count] = addr;
+        return count++;
+    }
+};
+
+WEAK void report_roofline(void *user_context, halide_profiler_pipeline_stats *p) {
+    bool any_work = false;
+    for (int i = 0; i < p->num_funcs; i++) {
+        any_work |= (p->funcs[i].arith_ops != 0 && p->funcs[i].time != 0);
+    }
+    if (!any_work) return;
+
+    // The machine's peak memory bandwidth and arithmetic throughput,
+    // if the user told us about them.
+    const char *gbps_str = getenv("HL_PEAK_GBPS");
+    const char *gops_str = getenv("HL_PEAK_GOPS");
+    float peak_gbps = gbps_str ? atoi(gbps_str) : 0;
+    float peak_gops = gops_str ? atoi(gops_str) : 0;
+    bool have_roof = peak_gbps > 0 && peak_gops > 0;
+
+    char line_buf[1024];
+    Printer<StringStreamPrinter, sizeof(line_buf)> sstr(user_context, line_buf);
+
+    sstr << " roofline";
+    if (have_roof) {
+        sstr << " (peak " << (int)peak_gbps << " GB/s, " << (int)peak_gops << " Gops/s, ridge ";
+        sstr << peak_gops / peak_gbps;
+        sstr.erase(4);
+        sstr << " ops/byte)";
+    }
+    sstr << ":\n";
+    halide_print(user_context, sstr.str());
+
+    for (int i = 0; i < p->num_funcs; i++) {
+        halide_profiler_func_stats *fs = p->funcs + i;
+        if (fs->arith_ops == 0 || fs->time == 0) continue;
+
+        size_t cursor = 0;
+        sstr.clear();
+        sstr << "  " << fs->name << ": ";
+        cursor += 25;
+        while (sstr.size() < cursor) sstr << " ";
+
+        // Bytes (or ops) per nanosecond are GB/s (or Gops/s).
+        uint64_t bytes = fs->bytes_loaded + fs->bytes_stored;
+        float gbps = (float)bytes / fs->time;
+        float gops = (float)fs->arith_ops / fs->time;
+        float intensity = bytes ? (float)fs->arith_ops / bytes : 0.0f;
+
+        sstr << gbps;
+        sstr.erase(4);
+        sstr << " GB/s";
+        cursor += 14;
+        while (sstr.size() < cursor) sstr << " ";
+
+        sstr << gops;
+        sstr.erase(4);
+        sstr << " Gops/s";
+        cursor += 16;
+        while (sstr.size() < cursor) sstr << " ";
+
+        sstr << intensity;
+        sstr.erase(4);
+        sstr << " ops/byte";
+
+        if (have_roof) {
+            cursor += 18;
+            while (sstr.size() < cursor) sstr << " ";
+            bool memory_bound = intensity * peak_gbps < peak_gops;
+            float roof = memory_bound ? intensity * peak_gbps : peak_gops;
+            int percent = roof > 0 ? (int)(100 * gops / roof) : 0;
+            sstr << percent << "% of roof, "
+                 << (memory_bound ? "memory bound" : "compute bound");
+        }
+        sstr << "\n";
+
+        halide_print(user_context, sstr.str());
+    }
+}
+
 }}}
 
 namespace {
@@ -251,6 +384,8 @@ WEAK void halide_profiler_memory_allocate(void *user_context,
     __sync_add_and_fetch(&f_stats->memory_total, incr);
     uint64_t f_mem_current = __sync_add_and_fetch(&f_stats->memory_current, incr);
     sync_compare_max_and_swap(&f_stats->memory_peak, f_mem_current);
+
+    log_allocation(user_context, p_stats, func_id, incr, false);
 }
 
 WEAK void halide_profiler_memory_free(void *user_context,
@@ -281,6 +416,27 @@ WEAK void halide_profiler_memory_free(void *user_context,
 
     // Update per-func memory stats
     __sync_sub_and_fetch(&f_stats->memory_current, decr);
+
+    log_allocation(user_context, p_stats, func_id, decr, true);
+}
+
+WEAK void halide_profiler_record_work(void *user_context,
+                                      void *pipeline_state,
+                                      int func_id,
+                                      uint64_t arith_ops,
+                                      uint64_t bytes_loaded,
+                                      uint64_t bytes_stored) {
+    halide_profiler_pipeline_stats *p_stats = (halide_profiler_pipeline_stats *) pipeline_state;
+    halide_assert(user_context, p_stats != NULL);
+    halide_assert(user_context, func_id >= 0);
+    halide_assert(user_context, func_id < p_stats->num_funcs);
+
+    // Like the memory counters, these are updated without grabbing
+    // the state's lock.
+    halide_profiler_func_stats *f_stats = &p_stats->funcs[func_id];
+    __sync_add_and_fetch(&f_stats->arith_ops, arith_ops);
+    __sync_add_and_fetch(&f_stats->bytes_loaded, bytes_loaded);
+    __sync_add_and_fetch(&f_stats->bytes_stored, bytes_stored);
 }
 
 WEAK void halide_profiler_report_unlocked(void *user_context, halide_profiler_state *s) {
@@ -382,6 +538,8 @@ WEAK void halide_profiler_report_unlocked(void *user_context, halide_profiler_st
                 halide_print(user_context, sstr.str());
             }
         }
+
+        report_roofline(user_context, p);
     }
 }
 
@@ -391,6 +549,231 @@ WEAK void halide_profiler_report(void *user_context) {
     halide_profiler_report_unlocked(user_context, s);
 }
 
+WEAK int halide_profiler_save_unlocked(void *user_context, halide_profiler_state *s,
+                                       const char *filename) {
+    void *file = fopen(filename, "w");
+    if (!file) {
+        halide_error(user_context, "Failed to open profile file\n");
+        return halide_error_code_generic_error;
+    }
+
+    char line_buf[1024];
+    Printer<StringStreamPrinter, sizeof(line_buf)> sstr(user_context, line_buf);
+
+    bool ok = true;
+    for (halide_profiler_pipeline_stats *p = s->pipelines; p;
+         p = (halide_profiler_pipeline_stats *)(p->next)) {
+        if (!p->runs) continue;
+        sstr.clear();
+        sstr << "pipeline " << p->name << " " << p->runs << " " << p->time << "\n";
+        ok = ok && (fwrite(sstr.str(), sstr.size(), 1, file) == 1);
+
+        for (int i = 0; i < p->num_funcs; i++) {
+            halide_profiler_func_stats *fs = p->funcs + i;
+            sstr.clear();
+            sstr << "func " << fs->name << " " << fs->time
+                 << " " << fs->memory_peak << " " << fs->memory_total
+                 << " " << fs->num_allocs << "\n";
+            ok = ok && (fwrite(sstr.str(), sstr.size(), 1, file) == 1);
+        }
+    }
+
+    fclose(file);
+    if (!ok) {
+        halide_error(user_context, "Failed to write profile file\n");
+        return halide_error_code_generic_error;
+    }
+    return 0;
+}
+
+WEAK int halide_profiler_save(void *user_context, const char *filename) {
+    halide_profiler_state *s = halide_profiler_get_state();
+    ScopedMutexLock lock(&s->lock);
+    return halide_profiler_save_unlocked(user_context, s, filename);
+}
+
+
+WEAK int halide_profiler_enable_allocation_log(int max_events) {
+    // WARNING: Do not call this method while any other halide
+    // pipeline is running; the log is appended to without grabbing
+    // the global profiler state's lock.
+    halide_profiler_state *s = halide_profiler_get_state();
+    ScopedMutexLock lock(&s->lock);
+
+    free(allocation_log);
+    allocation_log = NULL;
+    allocation_log_capacity = 0;
+    allocation_log_size = 0;
+    if (max_events <= 0) {
+        return 0;
+    }
+
+    halide_start_clock(NULL);
+    allocation_log = (halide_profiler_allocation_event *)
+        malloc(max_events * sizeof(halide_profiler_allocation_event));
+    if (!allocation_log) {
+        return halide_error_code_out_of_memory;
+    }
+    allocation_log_capacity = max_events;
+    return 0;
+}
+
+WEAK int halide_profiler_get_allocation_log(const halide_profiler_allocation_event **events) {
+    *events = allocation_log;
+    return min(allocation_log_size, allocation_log_capacity);
+}
+
+WEAK void halide_profiler_allocation_report(void *user_context) {
+    const halide_profiler_allocation_event *events;
+    int num_events = halide_profiler_get_allocation_log(&events);
+
+    char line_buf[1024];
+    Printer<StringStreamPrinter, sizeof(line_buf)> sstr(user_context, line_buf);
+
+    sstr << "allocation log: " << num_events << " events";
+    if (allocation_log_size > num_events) {
+        sstr << " (" << allocation_log_size - num_events << " dropped)";
+    }
+    sstr << "\n";
+    halide_print(user_context, sstr.str());
+    if (num_events == 0) {
+        return;
+    }
+
+    // Replay the log to print it and to find the high-water mark.
+    thread_ranges *threads = (thread_ranges *)malloc(sizeof(thread_ranges));
+    int *thread_of = (int *)malloc(num_events * sizeof(int));
+    if (!threads || !thread_of) {
+        free(threads);
+        free(thread_of);
+        halide_error(user_context, "Out of memory in halide_profiler_allocation_report\n");
+        return;
+    }
+    threads->count = 0;
+
+    uint64_t t0 = events[0].time;
+    uint64_t current = 0, peak = 0;
+    int peak_event = -1;
+    for (int i = 0; i < num_events; i++) {
+        const halide_profiler_allocation_event &e = events[i];
+        thread_of[i] = threads->index_of(e.thread);
+        if (e.is_free) {
+            current -= e.size;
+        } else {
+            current += e.size;
+            if (current > peak) {
+                peak = current;
+                peak_event = i;
+            }
+        }
+
+        size_t cursor = 0;
+        sstr.clear();
+        sstr << "  " << (e.time - t0) / 1000 << "us";
+        cursor += 14;
+        while (sstr.size() < cursor) sstr << " ";
+        sstr << "thread " << thread_of[i];
+        cursor += 11;
+        while (sstr.size() < cursor) sstr << " ";
+        sstr << (e.is_free ? "free  " : "alloc ") << e.size;
+        cursor += 18;
+        while (sstr.size() < cursor) sstr << " ";
+        sstr << e.pipeline_name << ":" << e.func_name << "\n";
+        halide_print(user_context, sstr.str());
+    }
+
+    // Rebuild the set of allocations live at the high-water mark. Each
+    // free releases the most recent live allocation of the same size
+    // made by the same Func on the same thread.
+    int *live = (int *)malloc(num_events * sizeof(int));
+    int num_live = 0;
+    if (live && peak_event >= 0) {
+        for (int i = 0; i <= peak_event; i++) {
+            const halide_profiler_allocation_event &e = events[i];
+            if (!e.is_free) {
+                live[num_live++] = i;
+                continue;
+            }
+            for (int j = num_live - 1; j >= 0; j--) {
+                const halide_profiler_allocation_event &a = events[live[j]];
+                if (a.func_name == e.func_name && a.size == e.size &&
+                    thread_of[live[j]] == thread_of[i]) {
+                    for (int k = j; k < num_live - 1; k++) {
+                        live[k] = live[k + 1];
+                    }
+                    num_live--;
+                    break;
+                }
+            }
+        }
+
+        sstr.clear();
+        sstr << "high-water mark: " << peak << " bytes in " << num_live
+             << " allocations at " << (events[peak_event].time - t0) / 1000 << "us\n";
+        halide_print(user_context, sstr.str());
+
+        // Break it down by Func, in order of allocation...
+        for (int j = 0; j < num_live; j++) {
+            const halide_profiler_allocation_event &a = events[live[j]];
+            bool seen = false;
+            for (int k = 0; k < j; k++) {
+                seen |= events[live[k]].func_name == a.func_name;
+            }
+            if (seen) continue;
+            uint64_t bytes = 0;
+            int count = 0;
+            for (int k = j; k < num_live; k++) {
+                if (events[live[k]].func_name == a.func_name) {
+                    bytes += events[live[k]].size;
+                    count++;
+                }
+            }
+            size_t cursor = 0;
+            sstr.clear();
+            sstr << "  " << a.pipeline_name << ":" << a.func_name << ": ";
+            cursor += 25;
+            while (sstr.size() < cursor) sstr << " ";
+            sstr << bytes << " bytes";
+            cursor += 18;
+            while (sstr.size() < cursor) sstr << " ";
+            sstr << "(" << (int)((100 * bytes) / peak) << "%)";
+            cursor += 7;
+            while (sstr.size() < cursor) sstr << " ";
+            sstr << "num: " << count << "\n";
+            halide_print(user_context, sstr.str());
+        }
+
+        // ...and by thread.
+        for (int t = 0; t < threads->count; t++) {
+            uint64_t bytes = 0;
+            int count = 0;
+            for (int j = 0; j < num_live; j++) {
+                if (thread_of[live[j]] == t) {
+                    bytes += events[live[j]].size;
+                    count++;
+                }
+            }
+            if (!count) continue;
+            size_t cursor = 0;
+            sstr.clear();
+            sstr << "  thread " << t << ": ";
+            cursor += 25;
+            while (sstr.size() < cursor) sstr << " ";
+            sstr << bytes << " bytes";
+            cursor += 18;
+            while (sstr.size() < cursor) sstr << " ";
+            sstr << "(" << (int)((100 * bytes) / peak) << "%)";
+            cursor += 7;
+            while (sstr.size() < cursor) sstr << " ";
+            sstr << "num: " << count << "\n";
+            halide_print(user_context, sstr.str());
+        }
+    }
+
+    free(live);
+    free(thread_of);
+    free(threads);
+}
 
 WEAK void halide_profiler_reset() {
     // WARNING: Do not call this method while any other halide
@@ -426,6 +809,13 @@ WEAK void halide_profiler_shutdown() {
     // down the thread.
     halide_profiler_report_unlocked(NULL, s);
 
+    // Don't overwrite a profile saved by a JIT realization with the
+    // stats left after it reset them.
+    const char *profile_file = getenv("HL_PROFILE_FILE");
+    if (profile_file && s->pipelines) {
+        halide_profiler_save_unlocked(NULL, s, profile_file);
+    }
+
     // Leak the memory. Not all implementations of ScopedMutexLock may
     // be safe to use at static destruction time (windows).
     // halide_profiler_reset();
@@ -130,6 +130,12 @@ WEAK void halide_profiler_memory_free(void *user_context,
                                       void *pipeline_state,
                                       int func_id,
                                       uint64_t decr);
+WEAK void halide_profiler_record_work(void *user_context,
+                                      void *pipeline_state,
+                                      int func_id,
+                                      uint64_t arith_ops,
+                                      uint64_t bytes_loaded,
+                                      uint64_t bytes_stored);
 WEAK int halide_profiler_pipeline_start(void *user_context,
                                         const char *pipeline_name,
                                         int num_funcs,
@@ -164,6 +170,7 @@ WEAK int halide_trace_helper(void *user_context,
                              int type_code, int type_bits, int type_lanes,
                              int code,
                              int parent_id, int value_index, int dimensions);
+WEAK int halide_trace_take(int32_t *counter, int32_t limit);
 
 }  // extern "C"
 
@@ -68,6 +68,208 @@ public:
     SharedExclusiveSpinLock() : lock(0) {}
 };
 
+// Writes the compressed trace format (see HalideTraceUtils.h for the
+// layout). Coordinates and values of each packet are delta-encoded
+// against the previous packet from the same Func, and the varints
+// that result are zero-run-length encoded into blocks. All calls
+// happen with the trace buffer held exclusively, so no locking is
+// needed here.
+const static uint32_t compressed_trace_block_magic = 0x31435448; // "HTC1"
+const static uint32_t compressed_trace_staging_size = 64 * 1024;
+
+class TraceEncoder {
+    struct FuncState {
+        char *name;
+        uint32_t hash;
+        // A copy of the last packet written for this Func, or NULL.
+        halide_trace_packet_t *prev;
+        uint32_t prev_capacity;
+    };
+
+    FuncState *funcs;
+    int num_funcs, funcs_capacity;
+    int32_t last_id;
+
+    // Delta-encoded packets not yet compressed into a block.
+    uint8_t staging[compressed_trace_staging_size];
+    uint32_t staging_size;
+
+    // The block being written. Zero-run-length encoding at most
+    // doubles the size of the staging data.
+    uint32_t block_header[3];
+    uint8_t block[2 * compressed_trace_staging_size];
+
+    __attribute__((always_inline)) void put_uvarint(uint64_t x) {
+        while (x >= 0x80) {
+            staging[staging_size++] = (uint8_t)(x | 0x80);
+            x >>= 7;
+        }
+        staging[staging_size++] = (uint8_t)x;
+    }
+
+    __attribute__((always_inline)) void put_svarint(int64_t x) {
+        put_uvarint(((uint64_t)x << 1) ^ (uint64_t)(x >> 63));
+    }
+
+    static uint32_t hash_name(const char *name) {
+        uint32_t h = 5381;
+        while (*name) {
+            h = h * 33 + (uint8_t)(*name++);
+        }
+        return h;
+    }
+
+    // Find the index of the given Func, adding it if it's new.
+    int find_func(const char *name, bool *is_new) {
+        uint32_t h = hash_name(name);
+        for (int i = 0; i < num_funcs; i++) {
+            if (funcs[i].hash == h && !strcmp(funcs[i].name, name)) {
+                *is_new = false;
+                return i;
+            }
+        }
+        if (num_funcs == funcs_capacity) {
+            int new_capacity = funcs_capacity ? funcs_capacity * 2 : 64;
+            FuncState *new_funcs = (FuncState *)malloc(new_capacity * sizeof(FuncState));
+            if (funcs) {
+                memcpy(new_funcs, funcs, num_funcs * sizeof(FuncState));
+                free(funcs);
+            }
+            funcs = new_funcs;
+            funcs_capacity = new_capacity;
+        }
+        size_t len = strlen(name) + 1;
+        FuncState &f = funcs[num_funcs];
+        f.name = (char *)malloc(len);
+        memcpy(f.name, name, len);
+        f.hash = h;
+        f.prev = NULL;
+        f.prev_capacity = 0;
+        *is_new = true;
+        return num_funcs++;
+    }
+
+public:
+    void init() {
+        funcs = NULL;
+        num_funcs = funcs_capacity = 0;
+        last_id = 0;
+        staging_size = 0;
+    }
+
+    void destroy() {
+        for (int i = 0; i < num_funcs; i++) {
+            free(funcs[i].name);
+            if (funcs[i].prev) {
+                free(funcs[i].prev);
+            }
+        }
+        if (funcs) {
+            free(funcs);
+        }
+        init();
+    }
+
+    // Compress the staged packets into a block and write it out.
+    void flush_block(void *user_context, int fd) {
+        if (!staging_size) {
+            return;
+        }
+        uint32_t block_size = 0;
+        for (uint32_t i = 0; i < staging_size; i++) {
+            uint8_t b = staging[i];
+            block[block_size++] = b;
+            if (b == 0) {
+                uint32_t run = 1;
+                while (run < 256 && i + run < staging_size && staging[i + run] == 0) {
+                    run++;
+                }
+                block[block_size++] = (uint8_t)(run - 1);
+                i += run - 1;
+            }
+        }
+        block_header[0] = compressed_trace_block_magic;
+        block_header[1] = block_size;
+        block_header[2] = staging_size;
+        bool success = (sizeof(block_header) == (size_t)write(fd, block_header, sizeof(block_header)) &&
+                        block_size == (uint32_t)write(fd, block, block_size));
+        halide_assert(user_context, success && "Could not write to trace file");
+        staging_size = 0;
+    }
+
+    void encode(void *user_context, int fd, const halide_trace_packet_t *p) {
+        // Bound the encoded size of the packet: each 32-bit field
+        // takes at most 5 bytes as a varint, and each value byte at
+        // most 10/8 bytes.
+        uint32_t bound = 128 + 2 * p->size + 5 * p->dimensions;
+        halide_assert(user_context, bound <= compressed_trace_staging_size && "Trace packet too large to compress");
+        if (staging_size + bound > compressed_trace_staging_size) {
+            flush_block(user_context, fd);
+        }
+
+        bool is_new;
+        int idx = find_func(p->func(), &is_new);
+        FuncState &f = funcs[idx];
+        const halide_trace_packet_t *prev = f.prev;
+
+        put_uvarint(idx);
+        if (is_new) {
+            uint32_t len = strlen(p->func());
+            put_uvarint(len);
+            memcpy(staging + staging_size, p->func(), len);
+            staging_size += len;
+        }
+        put_uvarint(p->event);
+        put_svarint((int64_t)p->id - last_id);
+        last_id = p->id;
+        put_svarint((int64_t)p->parent_id - (prev ? prev->parent_id : 0));
+        put_uvarint(p->type.code);
+        put_uvarint(p->type.bits);
+        put_uvarint(p->type.lanes);
+        put_uvarint(p->value_index);
+        put_uvarint(p->dimensions);
+
+        const int *coords = p->coordinates();
+        for (int i = 0; i < p->dimensions; i++) {
+            int32_t c = (prev && i < prev->dimensions) ? prev->coordinates()[i] : 0;
+            put_svarint((int64_t)coords[i] - c);
+        }
+
+        // Values are delta-encoded against the previous value of the
+        // same type. Integers use their difference, and floats and
+        // handles use the xor of their bits.
+        int bytes = p->type.bytes();
+        bool same_type = prev && prev->type == p->type;
+        const uint8_t *value = (const uint8_t *)p->value();
+        const uint8_t *prev_value = same_type ? (const uint8_t *)prev->value() : NULL;
+        for (int i = 0; i < p->type.lanes; i++) {
+            uint64_t x = 0, y = 0;
+            memcpy(&x, value + i * bytes, bytes);
+            if (prev_value) {
+                memcpy(&y, prev_value + i * bytes, bytes);
+            }
+            if (p->type.code == halide_type_int || p->type.code == halide_type_uint) {
+                int shift = 64 - 8 * bytes;
+                put_svarint((int64_t)((x - y) << shift) >> shift);
+            } else {
+                put_uvarint(x ^ y);
+            }
+        }
+
+        // Remember this packet for the next delta.
+        if (f.prev_capacity < p->size) {
+            if (f.prev) {
+                free(f.prev);
+            }
+            f.prev = (halide_trace_packet_t *)malloc(p->size);
+            f.prev_capacity = p->size;
+        }
+        memcpy(f.prev, p, p->size);
+    }
+};
+
+WEAK TraceEncoder *halide_trace_encoder = NULL;
+
 const static int buffer_size = 1024 * 1024;
 
 class TraceBuffer {
@@ -97,7 +299,15 @@ public:
     __attribute__((always_inline)) void flush(void *user_context, int fd) {
         lock.acquire_exclusive();
         bool success = true;
-        if (cursor) {
+        if (cursor && halide_trace_encoder) {
+            for (uint32_t i = 0; i < cursor; ) {
+                const halide_trace_packet_t *p = (const halide_trace_packet_t *)(buf + i);
+                halide_trace_encoder->encode(user_context, fd, p);
+                i += p->size;
+            }
+            halide_trace_encoder->flush_block(user_context, fd);
+            cursor = 0;
+        } else if (cursor) {
             success = (cursor == (uint32_t)write(fd, buf, cursor));
             cursor = 0;
         }
@@ -324,6 +534,11 @@ WEAK int halide_get_trace_file(void *user_context) {
             if (!halide_trace_buffer) {
                 halide_trace_buffer = (TraceBuffer *)malloc(sizeof(TraceBuffer));
             }
+            const char *compress = getenv("HL_TRACE_COMPRESS");
+            if (compress && compress[0] != '0' && !halide_trace_encoder) {
+                halide_trace_encoder = (TraceEncoder *)malloc(sizeof(TraceEncoder));
+                halide_trace_encoder->init();
+            }
         } else {
             halide_set_trace_file(0);
         }
@@ -344,6 +559,11 @@ WEAK int halide_shutdown_trace() {
         if (halide_trace_buffer) {
             free(halide_trace_buffer);
         }
+        if (halide_trace_encoder) {
+            halide_trace_encoder->destroy();
+            free(halide_trace_encoder);
+            halide_trace_encoder = NULL;
+        }
         return ret;
     } else {
         return 0;
@@ -382,4 +602,14 @@ WEAK int halide_trace_helper(void *user_context,
     return halide_trace(user_context, &event);
 }
 
+// Claim one event from the budget of a Func scheduled with
+// trace_limit. Returns zero once the budget is exhausted, in which
+// case the pipeline skips building the trace packet entirely.
+WEAK int halide_trace_take(int32_t *counter, int32_t limit) {
+    if (*counter >= limit) {
+        return 0;
+    }
+    return __sync_fetch_and_add(counter, 1) < limit;
+}
+
 }
@@ -0,0 +1,88 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Build and auto-schedule a chain of stencils, where the weight of the last
+// one is 'w'.
+Pipeline build(ImageParam input, int w) {
+    Var x("x"), y("y");
+
+    Func f("f"), g("g"), h("h");
+    f(x, y) = input(x - 1, y) + input(x, y) + input(x + 1, y);
+    g(x, y) = f(x, y - 1) + f(x, y) + f(x, y + 1);
+    h(x, y) = g(x - 1, y) * w + g(x + 1, y);
+
+    // Provide estimates on the pipeline output
+    h.estimate(x, 0, 1024).estimate(y, 0, 1024);
+
+    Pipeline p(h);
+    p.auto_schedule(get_jit_target_from_environment());
+    return p;
+}
+
+int main(int argc, char **argv) {
+    ImageParam input(Int(32), 2);
+
+    // Provide estimates on the ImageParam
+    input.dim(0).set_bounds_estimate(-2, 1028);
+    input.dim(1).set_bounds_estimate(-1, 1026);
+
+    clear_auto_schedule_cache();
+    build(input, 2);
+    AutoScheduleCacheStats first = auto_schedule_cache_stats();
+    printf("First run: %lld hits, %lld misses\n", (long long)first.hits, (long long)first.misses);
+    if (first.misses == 0 || first.entries == 0) {
+        printf("The first run should fill the cache\n");
+        return -1;
+    }
+
+    // The same pipeline again is entirely analyzed from the cache.
+    build(input, 2);
+    AutoScheduleCacheStats second = auto_schedule_cache_stats();
+    printf("Second run: %lld hits, %lld misses\n", (long long)second.hits, (long long)second.misses);
+    if (second.misses != first.misses || second.hits <= first.hits) {
+        printf("The second run should only hit the cache\n");
+        return -1;
+    }
+
+    // After editing the last stage, the analyses of the first ones are
+    // still reused.
+    Pipeline p = build(input, 3);
+    AutoScheduleCacheStats third = auto_schedule_cache_stats();
+    printf("Third run: %lld hits, %lld misses\n", (long long)third.hits, (long long)third.misses);
+    if (third.hits <= second.hits || third.misses - second.misses >= first.misses) {
+        printf("The third run should only recompute the analyses of the edited stage\n");
+        return -1;
+    }
+
+    // Run the schedule of the edited pipeline
+    Buffer<int> in(1028, 1026);
+    in.set_min(-2, -1);
+    in.for_each_element([&](int x, int y) { in(x, y) = (x * 7 + y * 3) % 11; });
+    input.set(in);
+    Buffer<int> result = p.realize(1024, 1024);
+
+    auto g = [&](int x, int y) {
+        int sum = 0;
+        for (int dy = -1; dy <= 1; dy++) {
+            for (int dx = -1; dx <= 1; dx++) {
+                sum += in(x + dx, y + dy);
+            }
+        }
+        return sum;
+    };
+    for (int y = 0; y < 1024; y++) {
+        for (int x = 0; x < 1024; x++) {
+            int correct = g(x - 1, y) * 3 + g(x + 1, y);
+            if (result(x, y) != correct) {
+                printf("result(%d, %d) = %d instead of %d\n", x, y, result(x, y), correct);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
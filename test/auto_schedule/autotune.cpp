@@ -0,0 +1,67 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Param<int> offset;
+    offset.set_estimate(1);
+    ImageParam input(Float(32), 2);
+    Var x("x"), y("y");
+
+    Func f("f");
+    f(x, y) = input(x, y) * 2;
+
+    Func g("g");
+    g(x, y) = f(x + offset, y) + f(x, y + offset);
+
+    Func h("h");
+    h(x, y) = g(x, y) + g(x + 1, y + 1);
+
+    // Provide estimates on the pipeline output
+    h.estimate(x, 0, 1000).estimate(y, 0, 1000);
+
+    // Provide estimates on the ImageParam
+    input.dim(0).set_bounds_estimate(0, 1002);
+    input.dim(1).set_bounds_estimate(0, 1002);
+
+    // Autotune the pipeline over a few candidates
+    Target target = get_jit_target_from_environment();
+    Pipeline p(h);
+
+    std::string schedule = p.auto_schedule(target, MachineParams::generic(),
+                                           AutotuneParams(4, 5, 1));
+    if (schedule.find("// Autotuning: ") != 0) {
+        printf("Unexpected schedule:\n%s\n", schedule.c_str());
+        return -1;
+    }
+
+    // Inspect the schedule
+    h.print_loop_nest();
+
+    // The inputs bound while benchmarking should be unbound again
+    if (input.get().defined()) {
+        printf("The input is still bound after autotuning\n");
+        return -1;
+    }
+
+    // Run the schedule
+    Buffer<float> in(1002, 1002);
+    in.for_each_element([&](int x, int y) { in(x, y) = (float)(x + y); });
+    input.set(in);
+    offset.set(1);
+    Buffer<float> out = p.realize(1000, 1000);
+
+    for (int y = 0; y < out.height(); y++) {
+        for (int x = 0; x < out.width(); x++) {
+            float correct = 8 * (x + y) + 16;
+            if (out(x, y) != correct) {
+                printf("out(%d, %d) = %f instead of %f\n", x, y, out(x, y), correct);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,51 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+// Build a pipeline with many candidate groupings, and auto-schedule it.
+std::string schedule_pipeline() {
+    ImageParam input(Float(32), 2, "input");
+    Var x("x"), y("y");
+
+    const int stages = 16;
+    std::vector<Func> fs;
+    Func prev("f0");
+    prev(x, y) = input(x, y);
+    fs.push_back(prev);
+    for (int i = 1; i < stages; i++) {
+        Func f("f" + std::to_string(i));
+        f(x, y) = (prev(x - 1, y) + prev(x, y + 1)) * 0.5f + fs[i / 2](x, y);
+        fs.push_back(f);
+        prev = f;
+    }
+
+    // Provide estimates on the pipeline output
+    prev.estimate(x, 0, 1024).estimate(y, 0, 1024);
+
+    // Provide estimates on the ImageParam
+    input.dim(0).set_bounds_estimate(-32, 1088);
+    input.dim(1).set_bounds_estimate(-32, 1088);
+
+    // Auto-schedule the pipeline
+    Target target = get_jit_target_from_environment();
+    Pipeline p(prev);
+    return p.auto_schedule(target);
+}
+
+int main(int argc, char **argv) {
+    // The candidate choices are evaluated in parallel; the result must not
+    // depend on the order in which the evaluations finish.
+    std::string first = schedule_pipeline();
+    for (int i = 0; i < 4; i++) {
+        std::string schedule = schedule_pipeline();
+        if (schedule != first) {
+            printf("Auto-scheduling is not deterministic:\n%s\nvs.\n%s\n",
+                   first.c_str(), schedule.c_str());
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
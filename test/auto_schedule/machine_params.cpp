@@ -0,0 +1,121 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace Halide;
+
+// Auto-schedule a chain of stencils for the given machine, and return the
+// factors of the splits in the schedule.
+std::vector<int> split_factors(const MachineParams &params) {
+    ImageParam input(Float(32), 2);
+    Var x("x"), y("y");
+    Func f("f"), g("g"), h("h");
+    f(x, y) = input(x, y) * input(x, y) + 1;
+    g(x, y) = f(x - 1, y) + f(x + 1, y) + f(x, y - 1) + f(x, y + 1);
+    h(x, y) = g(x - 1, y) + g(x + 1, y) + g(x, y - 1) + g(x, y + 1);
+
+    h.estimate(x, 0, 4096).estimate(y, 0, 4096);
+    input.dim(0).set_bounds_estimate(-2, 4100);
+    input.dim(1).set_bounds_estimate(-2, 4100);
+
+    Target target = get_jit_target_from_environment();
+    std::string schedule = Pipeline(h).auto_schedule(target, params);
+
+    std::vector<int> factors;
+    for (size_t pos = schedule.find("split("); pos != std::string::npos;
+         pos = schedule.find("split(", pos + 1)) {
+        // The factor is the fourth argument.
+        size_t comma = pos;
+        for (int i = 0; i < 3; i++) {
+            comma = schedule.find(',', comma + 1);
+        }
+        factors.push_back(atoi(schedule.c_str() + comma + 1));
+    }
+    return factors;
+}
+
+int main(int argc, char **argv) {
+    // The three-parameter form is unchanged.
+    MachineParams generic = MachineParams::generic();
+    if (MachineParams(generic.to_string()).to_string() != generic.to_string() ||
+        generic.to_string().find(',') == generic.to_string().rfind(',')) {
+        printf("Unexpected generic MachineParams: %s\n", generic.to_string().c_str());
+        return -1;
+    }
+
+    // The full machine model survives a round trip through its string form.
+    MachineParams params(16, 16 * 1024 * 1024, 40);
+    params.l1_cache_size = 32 * 1024;
+    params.l2_cache_size = 256 * 1024;
+    params.l1_bandwidth = 64;
+    params.l2_bandwidth = 32;
+    params.last_level_cache_bandwidth = 16;
+    params.memory_bandwidth = 1;
+    params.cores = 8;
+    std::string s = params.to_string();
+    if (MachineParams(s).to_string() != s) {
+        printf("MachineParams %s did not survive a round trip\n", s.c_str());
+        return -1;
+    }
+
+    // The tile sizes depend on the sizes of the caches.
+    MachineParams small_caches = params, large_caches = params;
+    small_caches.l1_cache_size = 4 * 1024;
+    small_caches.l2_cache_size = 32 * 1024;
+    small_caches.last_level_cache_size = 256 * 1024;
+    large_caches.l1_cache_size = 256 * 1024;
+    large_caches.l2_cache_size = 4 * 1024 * 1024;
+    large_caches.last_level_cache_size = 256 * 1024 * 1024;
+    std::vector<int> small_factors = split_factors(small_caches);
+    std::vector<int> large_factors = split_factors(large_caches);
+    if (small_factors.empty() || small_factors == large_factors) {
+        printf("The tile sizes should depend on the sizes of the caches\n");
+        return -1;
+    }
+
+    MachineParams host = MachineParams::host();
+    printf("Host MachineParams: %s\n", host.to_string().c_str());
+
+    // Auto-schedule a pipeline with the full machine model.
+    ImageParam input(Float(32), 2);
+    Var x("x"), y("y");
+    Func f("f");
+    f(x, y) = input(x, y) * 2;
+
+    Func g("g");
+    g(x, y) = f(x - 1, y) + f(x + 1, y) + f(x, y - 1) + f(x, y + 1);
+
+    // Provide estimates on the pipeline output
+    g.estimate(x, 0, 2048).estimate(y, 0, 2048);
+
+    // Provide estimates on the ImageParam
+    input.dim(0).set_bounds_estimate(-1, 2050);
+    input.dim(1).set_bounds_estimate(-1, 2050);
+
+    Target target = get_jit_target_from_environment();
+    Pipeline p(g);
+    p.auto_schedule(target, params);
+
+    // Inspect the schedule
+    g.print_loop_nest();
+
+    // Run the schedule
+    Buffer<float> in(2050, 2050);
+    in.set_min(-1, -1);
+    in.for_each_element([&](int x, int y) { in(x, y) = (float)(x + y); });
+    input.set(in);
+    Buffer<float> out = p.realize(2048, 2048);
+
+    for (int y = 0; y < out.height(); y++) {
+        for (int x = 0; x < out.width(); x++) {
+            float correct = 8.0f * (x + y);
+            if (out(x, y) != correct) {
+                printf("out(%d, %d) = %f instead of %f\n", x, y, out(x, y), correct);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
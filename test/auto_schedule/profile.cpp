@@ -0,0 +1,97 @@
+#include "Halide.h"
+#include <cmath>
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace Halide;
+
+// Build a pipeline with an expensive stage and a cheap one.
+Func build(ImageParam input) {
+    Var x("x"), y("y");
+
+    Func expensive("expensive");
+    expensive(x, y) = sqrt(sin(input(x, y)) * cos(input(x, y)) + 2.0f);
+
+    Func cheap("cheap");
+    cheap(x, y) = expensive(x - 1, y) + expensive(x + 1, y) + expensive(x, y - 1) + expensive(x, y + 1);
+
+    // Provide estimates on the pipeline output
+    cheap.estimate(x, 0, 1024).estimate(y, 0, 1024);
+
+    // Provide estimates on the ImageParam
+    input.dim(0).set_bounds_estimate(-1, 1026);
+    input.dim(1).set_bounds_estimate(-1, 1026);
+
+    return cheap;
+}
+
+int main(int argc, char **argv) {
+    ImageParam input(Float(32), 2);
+    Buffer<float> in(1026, 1026);
+    in.set_min(-1, -1);
+    in.for_each_element([&](int x, int y) { in(x, y) = (float)(x + y) / 1024; });
+    input.set(in);
+
+    Target target = get_jit_target_from_environment();
+
+    // Profile a run of the pipeline with a simple schedule. A JIT
+    // realization saves the profile to HL_PROFILE_FILE before it resets
+    // the profiler.
+    std::string profile_file = "auto_schedule_profile.txt";
+    Internal::ensure_no_file_exists(profile_file);
+    static char profile_file_var[1024];
+    snprintf(profile_file_var, sizeof(profile_file_var), "HL_PROFILE_FILE=%s", profile_file.c_str());
+    putenv(profile_file_var);
+    {
+        Func out = build(input);
+        Pipeline p(out);
+        p.get_func(0).compute_root();
+        p.realize(1024, 1024, target.with_feature(Target::Profile));
+    }
+    Internal::assert_file_exists(profile_file);
+
+    AutoScheduleProfile profile = AutoScheduleProfile::load(profile_file);
+    for (const char *name : {"expensive", "cheap"}) {
+        if (profile.funcs.find(name) == profile.funcs.end()) {
+            printf("The profile is missing %s\n", name);
+            return -1;
+        }
+    }
+    // The profiler samples every millisecond, which is only sure to catch
+    // the expensive Func.
+    if (profile.funcs["expensive"].time <= 0) {
+        printf("The profile has no time for expensive\n");
+        return -1;
+    }
+
+    // Auto-schedule the pipeline with the costs calibrated against the profile.
+    Func out = build(input);
+    Pipeline p(out);
+    std::string schedule = p.auto_schedule(target, MachineParams::generic(), profile);
+    printf("%s\n", schedule.c_str());
+    if (schedule.find("// Profile: 2 Funcs calibrated") == std::string::npos) {
+        printf("The cost model was not calibrated against the profile\n");
+        return -1;
+    }
+
+    // Inspect the schedule
+    out.print_loop_nest();
+
+    // Run the schedule
+    Buffer<float> result = p.realize(1024, 1024);
+    auto e = [&](int i, int j) {
+        return std::sqrt(std::sin(in(i, j)) * std::cos(in(i, j)) + 2.0f);
+    };
+    for (int y = 0; y < result.height(); y++) {
+        for (int x = 0; x < result.width(); x++) {
+            float correct = e(x - 1, y) + e(x + 1, y) + e(x, y - 1) + e(x, y + 1);
+            if (std::abs(result(x, y) - correct) > 1e-4f * std::abs(correct)) {
+                printf("result(%d, %d) = %f instead of %f\n", x, y, result(x, y), correct);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,98 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    const int W = 2048, H = 2048;
+    Target target = get_jit_target_from_environment();
+
+    Buffer<uint8_t> in(W, H);
+    in.for_each_element([&](int x, int y) { in(x, y) = (uint8_t)((x * 7 + y * 3) & 0xff); });
+
+    {
+        // A histogram of the whole image has no pure dimension to
+        // parallelize its update over.
+        ImageParam input(UInt(8), 2);
+        Var x("x");
+        RDom r(0, W, 0, H);
+
+        Func hist("hist");
+        hist(x) = 0;
+        hist(cast<int>(input(r.x, r.y))) += 1;
+
+        // Provide estimates on the pipeline output
+        hist.estimate(x, 0, 256);
+
+        // Provide estimates on the ImageParam
+        input.dim(0).set_bounds_estimate(0, W);
+        input.dim(1).set_bounds_estimate(0, H);
+
+        Pipeline p(hist);
+        std::string schedule = p.auto_schedule(target);
+        printf("%s\n", schedule.c_str());
+        if (schedule.find(".rfactor(") == std::string::npos) {
+            printf("The histogram should be rfactored\n");
+            return -1;
+        }
+
+        // Run the schedule
+        input.set(in);
+        Buffer<int> result = p.realize(256);
+
+        std::vector<int> correct(256, 0);
+        in.for_each_element([&](int x, int y) { correct[in(x, y)]++; });
+        for (int i = 0; i < 256; i++) {
+            if (result(i) != correct[i]) {
+                printf("hist(%d) = %d instead of %d\n", i, result(i), correct[i]);
+                return -1;
+            }
+        }
+    }
+
+    {
+        // A few long row sums do not provide enough parallelism either.
+        ImageParam input(UInt(8), 2);
+        Var y("y");
+        RDom r(0, W * (H / 4));
+
+        Func sum("sum");
+        sum(y) = 0;
+        sum(y) += cast<int>(input(r % W, (r / W) + y * (H / 4)));
+
+        // Provide estimates on the pipeline output
+        sum.estimate(y, 0, 4);
+
+        // Provide estimates on the ImageParam
+        input.dim(0).set_bounds_estimate(0, W);
+        input.dim(1).set_bounds_estimate(0, H);
+
+        Pipeline p(sum);
+        std::string schedule = p.auto_schedule(target);
+        printf("%s\n", schedule.c_str());
+        if (schedule.find(".rfactor(") == std::string::npos) {
+            printf("The row sums should be rfactored\n");
+            return -1;
+        }
+
+        // Run the schedule
+        input.set(in);
+        Buffer<int> result = p.realize(4);
+
+        for (int i = 0; i < 4; i++) {
+            int correct = 0;
+            for (int y = i * (H / 4); y < (i + 1) * (H / 4); y++) {
+                for (int x = 0; x < W; x++) {
+                    correct += in(x, y);
+                }
+            }
+            if (result(i) != correct) {
+                printf("sum(%d) = %d instead of %d\n", i, result(i), correct);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
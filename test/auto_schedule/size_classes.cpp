@@ -0,0 +1,155 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace Halide;
+
+// Run the pipeline on a 'size' x 'size' image and check the result.
+int run(Pipeline p, ImageParam input, int size) {
+    Buffer<float> in(size + 2, size + 2);
+    in.set_min(-1, -1);
+    in.for_each_element([&](int x, int y) { in(x, y) = (float)((x * 5 + y * 3) % 13); });
+    input.set(in);
+    Buffer<float> result = p.realize(size, size);
+
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            float correct = 0;
+            for (int dy = -1; dy <= 1; dy++) {
+                for (int dx = -1; dx <= 1; dx++) {
+                    correct += in(x + dx, y + dy);
+                }
+            }
+            if (result(x, y) != correct) {
+                printf("result(%d, %d) = %f instead of %f for size %d\n",
+                       x, y, result(x, y), correct, size);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+// Find the size class an input of extent 'extent' in both dimensions runs,
+// by evaluating the conditions of the size classes printed in the header of
+// 'schedule' in order. Returns -1 for the default schedule.
+int picked_class(const std::string &schedule, int extent) {
+    for (int i = 0;; i++) {
+        std::string prefix = "// Size class " + std::to_string(i) + ": ";
+        size_t start = schedule.find(prefix);
+        if (start == std::string::npos) {
+            return -1;
+        }
+        start += prefix.size();
+        std::string condition = schedule.substr(start, schedule.find('\n', start) - start);
+
+        bool matches = true;
+        size_t pos = 0;
+        while (pos < condition.size()) {
+            size_t end = condition.find(" && ", pos);
+            if (end == std::string::npos) {
+                end = condition.size();
+            }
+            std::string term = condition.substr(pos, end - pos);
+            size_t op = term.find(".extent() ");
+            if (op == std::string::npos) {
+                printf("Could not parse the condition \"%s\"\n", condition.c_str());
+                exit(-1);
+            }
+            std::string rest = term.substr(op + 10);
+            if (rest.compare(0, 3, "<= ") == 0) {
+                matches = matches && (extent <= atoi(rest.c_str() + 3));
+            } else if (rest.compare(0, 2, "> ") == 0) {
+                matches = matches && (extent > atoi(rest.c_str() + 2));
+            } else {
+                printf("Could not parse the condition \"%s\"\n", condition.c_str());
+                exit(-1);
+            }
+            pos = end + 4;
+        }
+        if (matches) {
+            return i;
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    ImageParam input(Float(32), 2, "input");
+    Var x("x"), y("y");
+
+    Func box("box");
+    box(x, y) = (input(x - 1, y - 1) + input(x, y - 1) + input(x + 1, y - 1) +
+                 input(x - 1, y) + input(x, y) + input(x + 1, y) +
+                 input(x - 1, y + 1) + input(x, y + 1) + input(x + 1, y + 1));
+
+    // Provide estimates on the pipeline output and the ImageParam for
+    // large images
+    box.estimate(x, 0, 2048).estimate(y, 0, 2048);
+    input.dim(0).set_bounds_estimate(-1, 2050);
+    input.dim(1).set_bounds_estimate(-1, 2050);
+
+    // Also schedule the pipeline for thumbnails
+    AutoScheduleSizeClass thumbnail;
+    thumbnail.estimates["box"] = {{0, 64}, {0, 64}};
+    thumbnail.estimates["input"] = {{-1, 66}, {-1, 66}};
+
+    Target target = get_jit_target_from_environment();
+    Pipeline p(box);
+    std::string schedule = p.auto_schedule(target, MachineParams::generic(), {thumbnail});
+    printf("%s\n", schedule.c_str());
+    if (schedule.find("// Size class 0: input.dim(0).extent() <= ") == std::string::npos ||
+        schedule.find(".specialize(") == std::string::npos) {
+        printf("The schedule should be specialized for thumbnails\n");
+        return -1;
+    }
+
+    // Inspect the schedule
+    box.print_loop_nest();
+
+    // Run the schedule on both sizes
+    if (run(p, input, 2048) != 0 || run(p, input, 64) != 0 || run(p, input, 300) != 0) {
+        return -1;
+    }
+
+    {
+        // Two size classes smaller than the default. Each should own the
+        // sizes closest to its estimates, so a medium image must not run
+        // the thumbnail schedule just because it is smaller than halfway
+        // to the default.
+        Func box2("box2");
+        box2(x, y) = (input(x - 1, y - 1) + input(x, y - 1) + input(x + 1, y - 1) +
+                      input(x - 1, y) + input(x, y) + input(x + 1, y) +
+                      input(x - 1, y + 1) + input(x, y + 1) + input(x + 1, y + 1));
+        box2.estimate(x, 0, 2048).estimate(y, 0, 2048);
+
+        AutoScheduleSizeClass thumbnail, medium;
+        thumbnail.estimates["box2"] = {{0, 64}, {0, 64}};
+        thumbnail.estimates["input"] = {{-1, 66}, {-1, 66}};
+        medium.estimates["box2"] = {{0, 512}, {0, 512}};
+        medium.estimates["input"] = {{-1, 514}, {-1, 514}};
+
+        Pipeline p2(box2);
+        std::string schedule = p2.auto_schedule(target, MachineParams::generic(), {thumbnail, medium});
+        printf("%s\n", schedule.c_str());
+        if (schedule.find("ImageParam input = pipeline.get_input(\"input\");") == std::string::npos) {
+            printf("The input should be declared in the schedule\n");
+            return -1;
+        }
+
+        // The size of the output, and the class it should run.
+        const int sizes[][2] = {{64, 0}, {150, 0}, {300, 1}, {512, 1}, {1000, 1}, {2048, -1}};
+        for (const auto &s : sizes) {
+            int picked = picked_class(schedule, s[0] + 2);
+            if (picked != s[1]) {
+                printf("Size %d runs size class %d instead of %d\n", s[0], picked, s[1]);
+                return -1;
+            }
+            if (run(p2, input, s[0]) != 0) {
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,73 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    // A chain of separable blurs, for which line-buffering the intermediates
+    // with sliding window and storage folding is a good schedule.
+    const int W = 1536, H = 1536;
+    ImageParam input(Float(32), 2);
+    Var x("x"), y("y");
+
+    Func blur_x("blur_x"), blur_y("blur_y"), blur_x2("blur_x2"), out("out");
+    blur_x(x, y) = input(x - 1, y) + input(x, y) + input(x + 1, y);
+    blur_y(x, y) = blur_x(x, y - 1) + blur_x(x, y) + blur_x(x, y + 1);
+    blur_x2(x, y) = blur_y(x - 1, y) + blur_y(x, y) + blur_y(x + 1, y);
+    out(x, y) = blur_x2(x, y - 1) + blur_x2(x, y) + blur_x2(x, y + 1);
+
+    // Provide estimates on the pipeline output
+    out.estimate(x, 0, W).estimate(y, 0, H);
+
+    // Provide estimates on the ImageParam
+    input.dim(0).set_bounds_estimate(-2, W + 4);
+    input.dim(1).set_bounds_estimate(-2, H + 4);
+
+    // Auto-schedule the pipeline
+    Target target = get_jit_target_from_environment();
+    Pipeline p(out);
+
+    std::string schedule = p.auto_schedule(target);
+    printf("%s\n", schedule.c_str());
+    // The intermediates should be stored outside of the loop they are
+    // computed at, either at an outer tile loop or at root, and folded.
+    if (schedule.find("store_at(") == std::string::npos &&
+        schedule.find("store_root()") == std::string::npos) {
+        printf("The intermediates should be stored outside of the loop they are computed at\n");
+        return -1;
+    }
+    if (schedule.find("fold_storage(") == std::string::npos) {
+        printf("The intermediates should be line-buffered with fold_storage\n");
+        return -1;
+    }
+
+    // Inspect the schedule
+    out.print_loop_nest();
+
+    // Run the schedule
+    Buffer<float> in(W + 4, H + 4);
+    in.set_min(-2, -2);
+    in.for_each_element([&](int x, int y) { in(x, y) = (float)((x * 3 + y * 5) % 17); });
+    input.set(in);
+    Buffer<float> result = p.realize(W, H);
+
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            float correct = 0;
+            for (int dy = -2; dy <= 2; dy++) {
+                for (int dx = -2; dx <= 2; dx++) {
+                    // The weights of two 3-tap box filters in a row.
+                    float w = (float)((3 - std::abs(dx)) * (3 - std::abs(dy)));
+                    correct += w * in(x + dx, y + dy);
+                }
+            }
+            if (result(x, y) != correct) {
+                printf("result(%d, %d) = %f instead of %f\n", x, y, result(x, y), correct);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,119 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+
+    {
+        // A short reduction innermost should be unrolled, and the cheap
+        // pure dimension vectorized.
+        const int N = 8, H = 4096;
+        ImageParam A(Float(32), 2), v(Float(32), 1);
+        Var y("y");
+        RDom r(0, N);
+
+        Func mv("mv");
+        mv(y) = 0.0f;
+        mv(y) += A(r, y) * v(r);
+
+        // Provide estimates on the pipeline output
+        mv.estimate(y, 0, H);
+
+        // Provide estimates on the ImageParams
+        A.dim(0).set_bounds_estimate(0, N);
+        A.dim(1).set_bounds_estimate(0, H);
+        v.dim(0).set_bounds_estimate(0, N);
+
+        Pipeline p(mv);
+        std::string schedule = p.auto_schedule(target);
+        printf("%s\n", schedule.c_str());
+        if (schedule.find("vectorize(") == std::string::npos) {
+            printf("The matrix-vector product should be vectorized\n");
+            return -1;
+        }
+        if (schedule.find("unroll(") == std::string::npos) {
+            printf("The reduction over r should be unrolled\n");
+            return -1;
+        }
+
+        // Run the schedule
+        Buffer<float> a(N, H), b(N);
+        a.for_each_element([&](int x, int y) { a(x, y) = (float)((x + y) % 5); });
+        b.for_each_element([&](int x) { b(x) = (float)(x % 3); });
+        A.set(a);
+        v.set(b);
+        Buffer<float> result = p.realize(H);
+
+        for (int i = 0; i < H; i++) {
+            float correct = 0.0f;
+            for (int j = 0; j < N; j++) {
+                correct += a(j, i) * b(j);
+            }
+            if (result(i) != correct) {
+                printf("mv(%d) = %f instead of %f\n", i, result(i), correct);
+                return -1;
+            }
+        }
+    }
+
+    {
+        // An input much larger than the last level cache is streamed from
+        // memory, and should be prefetched.
+        const int W = 4096, H = 4096;
+        ImageParam input(Float(32), 2, "input");
+        Var x("x"), y("y");
+
+        Func scale("scale");
+        scale(x, y) = input(x, y) * 3.0f + 1.0f;
+
+        // Provide estimates on the pipeline output
+        scale.estimate(x, 0, W).estimate(y, 0, H);
+
+        // Provide estimates on the ImageParam
+        input.dim(0).set_bounds_estimate(0, W);
+        input.dim(1).set_bounds_estimate(0, H);
+
+        Pipeline p(scale);
+        std::string schedule = p.auto_schedule(target);
+        printf("%s\n", schedule.c_str());
+        if (schedule.find("prefetch(input, ") == std::string::npos) {
+            printf("The input should be prefetched\n");
+            return -1;
+        }
+
+        // The prefetch refers to the input through a handle declared in
+        // the schedule, which must be the same image.
+        if (schedule.find("ImageParam input = pipeline.get_input(\"input\");") == std::string::npos) {
+            printf("The input should be declared in the schedule\n");
+            return -1;
+        }
+        if (!p.get_input("input").parameter().same_as(input.parameter())) {
+            printf("get_input() returned a different image\n");
+            return -1;
+        }
+
+        // Inspect the schedule
+        scale.print_loop_nest();
+
+        // Run the schedule
+        Buffer<float> in(W, H);
+        in.for_each_element([&](int x, int y) { in(x, y) = (float)((x * 3 + y) % 11); });
+        input.set(in);
+        Buffer<float> result = p.realize(W, H);
+
+        for (int y = 0; y < H; y++) {
+            for (int x = 0; x < W; x++) {
+                float correct = in(x, y) * 3.0f + 1.0f;
+                if (result(x, y) != correct) {
+                    printf("scale(%d, %d) = %f instead of %f\n", x, y, result(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
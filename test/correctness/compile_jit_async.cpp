@@ -0,0 +1,43 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    const int num_pipelines = 8;
+    Var x("x"), y("y");
+
+    // Build several different pipelines, and compile them all at once.
+    std::vector<Pipeline> pipelines;
+    std::vector<std::future<void>> compiled;
+    for (int i = 0; i < num_pipelines; i++) {
+        Func f("f" + std::to_string(i)), g("g" + std::to_string(i));
+        f(x, y) = x * (i + 1) + y;
+        g(x, y) = f(x - 1, y) + f(x + 1, y);
+        f.compute_root();
+        if (i % 2) {
+            g.vectorize(x, 8).parallel(y);
+        }
+        pipelines.push_back(Pipeline(g));
+        compiled.push_back(pipelines.back().compile_jit_async());
+    }
+
+    // Run each pipeline as soon as it is compiled.
+    for (int i = 0; i < num_pipelines; i++) {
+        compiled[i].get();
+        Buffer<int> result = pipelines[i].realize(64, 64);
+        for (int y = 0; y < 64; y++) {
+            for (int x = 0; x < 64; x++) {
+                int correct = ((x - 1) * (i + 1) + y) + ((x + 1) * (i + 1) + y);
+                if (result(x, y) != correct) {
+                    printf("Pipeline %d: result(%d, %d) = %d instead of %d\n",
+                           i, x, y, result(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
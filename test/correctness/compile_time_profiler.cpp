@@ -0,0 +1,113 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <fstream>
+#include <sstream>
+
+#include "test/common/halide_test_dirs.h"
+
+using namespace Halide;
+
+// Find the record of the given pass in the JSON profile, and return its
+// sizes. Each record is on its own line.
+bool find_pass(const std::string &profile, const std::string &pass,
+               long long *size_before, long long *size_after) {
+    std::istringstream lines(profile);
+    std::string line;
+    const std::string key = "\"pass\": \"" + pass + "\"";
+    while (std::getline(lines, line)) {
+        if (line.find(key) == std::string::npos) {
+            continue;
+        }
+        size_t before = line.find("\"size_before\": ");
+        size_t after = line.find("\"size_after\": ");
+        if (before == std::string::npos || after == std::string::npos) {
+            return false;
+        }
+        *size_before = strtoll(line.c_str() + before + 15, nullptr, 10);
+        *size_after = strtoll(line.c_str() + after + 14, nullptr, 10);
+        return true;
+    }
+    return false;
+}
+
+int main(int argc, char **argv) {
+    // The profiler reads HL_COMPILE_PROFILE the first time it's needed,
+    // so this must be set before anything is compiled.
+    std::string profile_file = Internal::get_test_tmp_dir() + "compile_time_profile.json";
+    Internal::ensure_no_file_exists(profile_file);
+
+    static char format_var[] = "HL_COMPILE_PROFILE=json";
+    putenv(format_var);
+    static char file_var[1024];
+    snprintf(file_var, sizeof(file_var), "HL_COMPILE_PROFILE_FILE=%s", profile_file.c_str());
+    putenv(file_var);
+
+    Func f("f"), g("g");
+    Var x("x"), y("y");
+    f(x, y) = x * y + 3;
+    g(x, y) = f(x - 1, y) + f(x + 1, y);
+    f.compute_root().parallel(y).vectorize(x, 4);
+    g.parallel(y).vectorize(x, 4);
+
+    // Compile to an object, to time the AOT code generation. It's
+    // reported along with the JIT compilation below.
+    std::string object_file = Internal::get_test_tmp_dir() + "compile_time_profiler.o";
+    Internal::ensure_no_file_exists(object_file);
+    g.compile_to_object(object_file, {}, "compile_time_profiler");
+
+    g.compile_jit();
+    Buffer<int> result = g.realize(16, 16);
+    result.for_each_element([&](int x, int y) {
+        int correct = (x - 1) * y + 3 + (x + 1) * y + 3;
+        if (result(x, y) != correct) {
+            printf("result(%d, %d) = %d instead of %d\n", x, y, result(x, y), correct);
+            exit(-1);
+        }
+    });
+
+    Internal::assert_file_exists(profile_file);
+    std::ifstream file(profile_file);
+    std::stringstream contents;
+    contents << file.rdbuf();
+    std::string profile = contents.str();
+    printf("%s\n", profile.c_str());
+
+    if (profile.find("\"title\": \"JIT compilation of ") == std::string::npos) {
+        printf("The profile of the JIT compilation is missing\n");
+        return -1;
+    }
+
+    // The lowering passes count IR nodes, and the LLVM passes count
+    // instructions, so the size each pass produces should be nonzero.
+    const char *passes[] = {"Performing storage flattening",
+                            "Simplifying",
+                            "Vectorizing",
+                            "Final simplification",
+                            "LLVM IR generation",
+                            "LLVM optimization",
+                            "LLVM code generation",
+                            "LLVM JIT code generation"};
+    for (const char *pass : passes) {
+        long long size_before = 0, size_after = 0;
+        if (!find_pass(profile, pass, &size_before, &size_after)) {
+            printf("The profile has no record of \"%s\"\n", pass);
+            return -1;
+        }
+        if (size_before < 0 || size_after <= 0) {
+            printf("\"%s\" has sizes %lld and %lld\n", pass, size_before, size_after);
+            return -1;
+        }
+    }
+
+    // The IR generation adds the pipeline to the initial module.
+    long long size_before = 0, size_after = 0;
+    find_pass(profile, "LLVM IR generation", &size_before, &size_after);
+    if (size_after <= size_before) {
+        printf("LLVM IR generation went from %lld to %lld instructions\n", size_before, size_after);
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
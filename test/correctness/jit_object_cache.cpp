@@ -0,0 +1,70 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Build and run a small pipeline, where the second stage is scaled by 'k'.
+int run(int k) {
+    Func f("f"), g("g");
+    Var x("x"), y("y");
+    f(x, y) = x + y * 3;
+    g(x, y) = (f(x - 1, y) + f(x + 1, y)) * k;
+    f.compute_root().vectorize(x, 4);
+    g.parallel(y);
+
+    Buffer<int> result = g.realize(64, 64);
+    for (int y = 0; y < 64; y++) {
+        for (int x = 0; x < 64; x++) {
+            int correct = ((x - 1 + y * 3) + (x + 1 + y * 3)) * k;
+            if (result(x, y) != correct) {
+                printf("result(%d, %d) = %d instead of %d\n", x, y, result(x, y), correct);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    JITModule::set_object_cache_directory(dir_make_temp());
+
+    // The first pipeline is compiled and added to the cache.
+    if (run(2) != 0) {
+        return -1;
+    }
+    JITObjectCacheStats first = JITModule::object_cache_stats();
+    if (first.hits != 0 || first.misses != 1) {
+        printf("The first pipeline should miss the cache: %lld hits, %lld misses\n",
+               (long long)first.hits, (long long)first.misses);
+        return -1;
+    }
+
+    // The same pipeline built again is loaded from the cache, even
+    // though the names generated while lowering it differ.
+    if (run(2) != 0) {
+        return -1;
+    }
+    JITObjectCacheStats second = JITModule::object_cache_stats();
+    if (second.hits != 1 || second.misses != 1) {
+        printf("The second pipeline should hit the cache: %lld hits, %lld misses\n",
+               (long long)second.hits, (long long)second.misses);
+        return -1;
+    }
+
+    // A different pipeline isn't.
+    if (run(3) != 0) {
+        return -1;
+    }
+    JITObjectCacheStats third = JITModule::object_cache_stats();
+    if (third.hits != 1 || third.misses != 2) {
+        printf("The third pipeline should miss the cache: %lld hits, %lld misses\n",
+               (long long)third.hits, (long long)third.misses);
+        return -1;
+    }
+
+    JITModule::set_object_cache_directory("");
+
+    printf("Success!\n");
+    return 0;
+}
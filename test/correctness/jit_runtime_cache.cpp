@@ -0,0 +1,63 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Build and run a pipeline that uses the thread pool and the
+// memoization cache of the runtime.
+int run() {
+    Func f("f"), g("g");
+    Var x("x"), y("y");
+    f(x, y) = x * 2 + y;
+    g(x, y) = f(x, y) + f(x + 1, y);
+    f.compute_root().memoize();
+    g.parallel(y);
+
+    Buffer<int> result = g.realize(32, 32);
+    for (int y = 0; y < 32; y++) {
+        for (int x = 0; x < 32; x++) {
+            int correct = (x * 2 + y) + ((x + 1) * 2 + y);
+            if (result(x, y) != correct) {
+                printf("result(%d, %d) = %d instead of %d\n", x, y, result(x, y), correct);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    // Make the runtime again with the object cache enabled.
+    JITSharedRuntime::release_all();
+    JITModule::set_object_cache_directory(dir_make_temp());
+
+    if (run() != 0) {
+        return -1;
+    }
+    JITObjectCacheStats first = JITModule::object_cache_stats();
+    if (first.runtime_hits != 0 || first.runtime_misses == 0) {
+        printf("The runtime should have been compiled: %lld hits, %lld misses\n",
+               (long long)first.runtime_hits, (long long)first.runtime_misses);
+        return -1;
+    }
+
+    // The next runtime is loaded from the cache.
+    JITSharedRuntime::release_all();
+    if (run() != 0) {
+        return -1;
+    }
+    JITObjectCacheStats second = JITModule::object_cache_stats();
+    if (second.runtime_hits != first.runtime_misses || second.runtime_misses != first.runtime_misses) {
+        printf("The runtime should have been loaded from the cache: %lld hits, %lld misses\n",
+               (long long)second.runtime_hits, (long long)second.runtime_misses);
+        return -1;
+    }
+
+    // Releasing it runs its static destructors.
+    JITSharedRuntime::release_all();
+    JITModule::set_object_cache_directory("");
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,82 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+std::string estimate(Func f, ImageParam in) {
+    Target t = get_host_target();
+    Module m = Pipeline(f).compile_to_module({in}, "f", t);
+    return estimate_memory(m.functions()[0].body, {f.function()},
+                           {in.parameter()}, MachineParams(16, 16 * 1024 * 1024, 40));
+}
+
+bool contains(const std::string &report, const std::string &line) {
+    if (report.find(line) == std::string::npos) {
+        printf("Expected to find \"%s\" in memory estimate:\n%s\n",
+               line.c_str(), report.c_str());
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    Var x("x"), y("y");
+
+    {
+        // A root intermediate one column larger than the output.
+        ImageParam in(Float(32), 2, "in");
+        in.dim(0).set_bounds_estimate(0, 1001);
+        in.dim(1).set_bounds_estimate(0, 1000);
+
+        Func g("g"), f("f");
+        g(x, y) = in(x, y) * 2;
+        f(x, y) = g(x, y) + g(x + 1, y);
+        g.compute_root();
+        f.estimate(x, 0, 1000).estimate(y, 0, 1000);
+
+        std::string report = estimate(f, in);
+        if (!contains(report, "Peak heap memory: 4004000 bytes")) {
+            return -1;
+        }
+    }
+
+    {
+        // The same intermediate computed per row of a parallel loop:
+        // each of the 16 threads has one row live.
+        ImageParam in(Float(32), 2, "in");
+        in.dim(0).set_bounds_estimate(0, 1001);
+        in.dim(1).set_bounds_estimate(0, 1000);
+
+        Func g("g"), f("f");
+        g(x, y) = in(x, y) * 2;
+        f(x, y) = g(x, y) + g(x + 1, y);
+        g.compute_at(f, y);
+        f.parallel(y);
+        f.estimate(x, 0, 1000).estimate(y, 0, 1000);
+
+        std::string report = estimate(f, in);
+        if (!contains(report, "Peak heap memory: 64064 bytes") ||
+            !contains(report, "Peak heap scratch per thread: 4004 bytes") ||
+            !contains(report, "f.s0.y: 4004 bytes (fits in cache)")) {
+            return -1;
+        }
+    }
+
+    {
+        // Without estimates the size is unknown.
+        ImageParam in(Float(32), 2, "in");
+        Func g("g"), f("f");
+        g(x, y) = in(x, y) * 2;
+        f(x, y) = g(x, y) + g(x + 1, y);
+        g.compute_root();
+
+        std::string report = estimate(f, in);
+        if (!contains(report, "Peak heap memory: unbounded")) {
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
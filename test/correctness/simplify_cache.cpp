@@ -0,0 +1,113 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+int main(int argc, char **argv) {
+    Var x("x"), y("y");
+    Expr lets = Let::make("t", x * 2, Let::make("u", Variable::make(Int(32), "t") + 3,
+                                                Variable::make(Int(32), "u") * y));
+    std::vector<Expr> exprs = {
+        min(x * 2 + 4, x * 2 + 6) > y,
+        min(x, 8) + y,
+        max(x, 3) - max(x, 1),
+        select(x < 4, x + y, x + y) * 2,
+        (x / 4) * 4 + x % 4,
+        lets,
+    };
+
+    // The bounds the expressions are simplified with: none, and two
+    // different constant bounds on x.
+    Scope<Interval> no_bounds, low_x, high_x;
+    low_x.push("x", Interval(0, 4));
+    high_x.push("x", Interval(10, 14));
+    const std::vector<const Scope<Interval> *> bounds = {&no_bounds, &low_x, &high_x};
+
+    // Simplify everything without a cache first.
+    std::vector<Expr> uncached;
+    for (const Expr &e : exprs) {
+        for (bool simplify_lets : {false, true}) {
+            for (const Scope<Interval> *b : bounds) {
+                uncached.push_back(simplify(e, simplify_lets, *b));
+            }
+        }
+    }
+
+    {
+        // With a cache, the first pass misses and the second one hits,
+        // and both give the same results as without a cache. The same
+        // Expr with different simplify_lets or bounds is a different
+        // entry. The simplifier may also simplify subexpressions
+        // through the cache, so only the second pass is counted
+        // exactly.
+        SimplifyCache cache;
+        int64_t first_pass_misses = 0;
+        for (int pass = 0; pass < 2; pass++) {
+            size_t i = 0;
+            for (const Expr &e : exprs) {
+                for (bool simplify_lets : {false, true}) {
+                    for (const Scope<Interval> *b : bounds) {
+                        Expr result = simplify(e, simplify_lets, *b);
+                        if (!equal(result, uncached[i])) {
+                            std::cout << "Simplifying " << e << " with simplify_lets = "
+                                      << simplify_lets << " and bounds " << i % bounds.size()
+                                      << " gave " << result << " with a cache and "
+                                      << uncached[i] << " without\n";
+                            return -1;
+                        }
+                        i++;
+                    }
+                }
+            }
+            const int64_t n = (int64_t)uncached.size();
+            if (pass == 0) {
+                first_pass_misses = cache.misses();
+                if (first_pass_misses < n) {
+                    printf("The first pass had %lld misses instead of at least %lld\n",
+                           (long long)first_pass_misses, (long long)n);
+                    return -1;
+                }
+            } else if (cache.misses() != first_pass_misses || cache.hits() < n) {
+                printf("The second pass had %lld misses and %lld hits instead of 0 and %lld\n",
+                       (long long)(cache.misses() - first_pass_misses),
+                       (long long)cache.hits(), (long long)n);
+                return -1;
+            }
+        }
+
+        // The bounds on x make these different.
+        if (equal(uncached[1 * 6 + 1], uncached[1 * 6 + 2])) {
+            printf("The bounds should change the result\n");
+            return -1;
+        }
+    }
+
+    Expr uncached_result = simplify(x * 2 + 2 * y);
+    {
+        // The cache is cleared when it's full.
+        SimplifyCache cache;
+        const int n = (int)SimplifyCache::max_size;
+        for (int i = 0; cache.size() < SimplifyCache::max_size; i++) {
+            if (i > n) {
+                printf("The cache holds %d results after simplifying %d Exprs\n",
+                       (int)cache.size(), i);
+                return -1;
+            }
+            simplify(x * 2 + (i + 2) * y);
+        }
+
+        // This Expr was simplified first, so it was cached, but the
+        // cache is full, so it's simplified again.
+        int64_t misses = cache.misses();
+        Expr e = simplify(x * 2 + 2 * y);
+        if (cache.misses() == misses || cache.size() >= SimplifyCache::max_size ||
+            !equal(e, uncached_result)) {
+            printf("The cache was not cleared: it holds %d results\n", (int)cache.size());
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
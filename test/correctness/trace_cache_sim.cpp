@@ -0,0 +1,80 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <string.h>
+
+#include "util/HalideTraceUtils.h"
+#include "util/HalideTraceCacheSim.h"
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Make a packet for an access to f(x), where f is a Func of uint8_t.
+Packet make_access(halide_trace_event_code_t event, int x) {
+    Packet p;
+    p.id = 0;
+    p.parent_id = 0;
+    p.event = event;
+    p.type = halide_type_t(halide_type_uint, 8);
+    p.value_index = 0;
+    p.dimensions = 1;
+    p.coordinates()[0] = x;
+    *(uint8_t *)p.value() = 0;
+    strcpy(p.func(), "f");
+    p.size = (uint32_t)(p.func() + 2 - (char *)&p);
+    return p;
+}
+
+int main(int argc, char **argv) {
+    // Two direct-mapped levels of 64 byte lines: an L1 with two lines
+    // and an L2 with four.
+    const uint64_t line_size = 64;
+    std::vector<CacheLevelConfig> configs = {{2 * line_size, line_size, 1},
+                                             {4 * line_size, line_size, 1}};
+
+    // Load and then store eight consecutive lines. The stores hit in
+    // the L1, so the data only reaches DRAM if dirty lines evicted from
+    // the L1 are written back into the L2, and from there to DRAM.
+    std::vector<Packet> trace;
+    const int lines = 8;
+    for (int i = 0; i < lines; i++) {
+        trace.push_back(make_access(halide_trace_load, i * line_size));
+        trace.push_back(make_access(halide_trace_store, i * line_size));
+    }
+
+    Simulator sim(configs);
+    for (const Packet &p : trace) {
+        sim.observe(p);
+    }
+    sim.finish_observing();
+    for (const Packet &p : trace) {
+        sim.simulate(p);
+    }
+
+    // Loading line i evicts line i - 2 from the L1, which is written
+    // back to the L2, where it's still resident. Line i - 4 is evicted
+    // from the L2 by the same load. It was dirtied there by the write
+    // back of the load of line i - 2, so it's written to DRAM. This
+    // happens for lines 0 to 3, and lines 4 to 7 are still cached at
+    // the end.
+    const FuncStats &f = sim.funcs[0];
+    const uint64_t expected_writes = 4 * line_size;
+    const uint64_t expected_reads = lines * line_size;
+    if (f.dram_write_bytes != expected_writes) {
+        printf("Expected %llu bytes written to DRAM instead of %llu\n",
+               (unsigned long long)expected_writes, (unsigned long long)f.dram_write_bytes);
+        return -1;
+    }
+    if (f.dram_read_bytes != expected_reads) {
+        printf("Expected %llu bytes read from DRAM instead of %llu\n",
+               (unsigned long long)expected_reads, (unsigned long long)f.dram_read_bytes);
+        return -1;
+    }
+    if (f.misses[0] != lines || f.misses[1] != lines) {
+        printf("Expected %d misses at each level instead of %llu and %llu\n", lines,
+               (unsigned long long)f.misses[0], (unsigned long long)f.misses[1]);
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,135 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "test/common/halide_test_dirs.h"
+#include "util/HalideTraceUtils.h"
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Run the pipeline with tracing sent to the given file. Releasing the
+// shared runtime afterwards flushes and closes the trace file, and
+// makes the next runtime read the environment variables again.
+void run_traced(Func out, const std::string &trace_file, bool compress) {
+    ensure_no_file_exists(trace_file);
+
+    static char file_var[1024];
+    snprintf(file_var, sizeof(file_var), "HL_TRACE_FILE=%s", trace_file.c_str());
+    putenv(file_var);
+
+    static char compress_var[32];
+    snprintf(compress_var, sizeof(compress_var), "HL_TRACE_COMPRESS=%d", compress ? 1 : 0);
+    putenv(compress_var);
+
+    JITSharedRuntime::release_all();
+    out.realize(100, 20);
+    JITSharedRuntime::release_all();
+
+    assert_file_exists(trace_file);
+}
+
+bool same_packet(const Packet &a, const Packet &b) {
+    if (a.id != b.id ||
+        a.parent_id != b.parent_id ||
+        a.event != b.event ||
+        a.type != b.type ||
+        a.value_index != b.value_index ||
+        a.dimensions != b.dimensions ||
+        strcmp(a.func(), b.func()) != 0) {
+        return false;
+    }
+    for (int i = 0; i < a.dimensions; i++) {
+        if (a.get_coord(i) != b.get_coord(i)) {
+            return false;
+        }
+    }
+    return memcmp(a.value(), b.value(), a.type.lanes * a.type.bytes()) == 0;
+}
+
+void print_packet(const Packet &p) {
+    printf("  %s: event %d, id %d, parent %d, value_index %d, coords:",
+           p.func(), p.event, p.id, p.parent_id, p.value_index);
+    for (int i = 0; i < p.dimensions; i++) {
+        printf(" %d", p.get_coord(i));
+    }
+    printf("\n");
+}
+
+int main(int argc, char **argv) {
+    // A serial pipeline, so that the order of the packets is the same
+    // in both runs. It has integer and float values, vectors and
+    // scalars, and loads and stores.
+    Func f("f"), g("g"), h("h");
+    Var x("x"), y("y");
+    f(x, y) = x * 3 - y;
+    g(x, y) = sqrt(cast<float>(f(x, y) + f(x + 1, y)));
+    h(x, y) = cast<int16_t>(g(x, y) * 17) + f(x, y);
+
+    f.compute_root().trace_stores().trace_loads();
+    g.compute_at(h, y).vectorize(x, 4).trace_stores().trace_loads();
+    h.trace_stores().trace_realizations();
+
+    std::string raw_file = get_test_tmp_dir() + "trace_compression_raw.bin";
+    std::string compressed_file = get_test_tmp_dir() + "trace_compression_compressed.bin";
+
+    run_traced(h, raw_file, false);
+    run_traced(h, compressed_file, true);
+
+    FILE *raw = fopen(raw_file.c_str(), "rb");
+    FILE *compressed = fopen(compressed_file.c_str(), "rb");
+    if (!raw || !compressed) {
+        printf("Could not open the trace files\n");
+        return -1;
+    }
+
+    PacketReader raw_reader(raw), compressed_reader(compressed);
+    Packet a, b;
+    int packets = 0;
+    while (true) {
+        bool got_a = raw_reader.read(&a);
+        bool got_b = compressed_reader.read(&b);
+        if (got_a != got_b) {
+            printf("The traces have different lengths: the %s trace ended after %d packets\n",
+                   got_a ? "compressed" : "raw", packets);
+            return -1;
+        }
+        if (!got_a) {
+            break;
+        }
+        if (!same_packet(a, b)) {
+            printf("Packet %d differs. Raw:\n", packets);
+            print_packet(a);
+            printf("Compressed:\n");
+            print_packet(b);
+            return -1;
+        }
+        packets++;
+    }
+
+    if (raw_reader.is_compressed() || !compressed_reader.is_compressed()) {
+        printf("The trace formats were not detected correctly\n");
+        return -1;
+    }
+
+    if (packets == 0) {
+        printf("The traces are empty\n");
+        return -1;
+    }
+
+    fseek(raw, 0, SEEK_END);
+    fseek(compressed, 0, SEEK_END);
+    long raw_size = ftell(raw), compressed_size = ftell(compressed);
+    printf("%d packets: %ld bytes raw, %ld bytes compressed\n", packets, raw_size, compressed_size);
+    if (compressed_size >= raw_size) {
+        printf("The compressed trace is not smaller than the raw trace\n");
+        return -1;
+    }
+
+    fclose(raw);
+    fclose(compressed);
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,106 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int stores = 0;
+int bad_stores = 0;
+int min_x = 0, max_x = 0, min_y = 0, max_y = 0;
+
+int my_trace(void *user_context, const halide_trace_event_t *e) {
+    if (e->event == halide_trace_store) {
+        stores++;
+        // Check that at least one lane of the vector lies in the box.
+        bool in_box = false;
+        for (int i = 0; i < e->type.lanes; i++) {
+            int x = e->coordinates[i];
+            int y = e->coordinates[e->type.lanes + i];
+            in_box |= (x >= min_x && x <= max_x && y >= min_y && y <= max_y);
+        }
+        if (!in_box) {
+            bad_stores++;
+        }
+    }
+    return 0;
+}
+
+void reset(int x0, int x1, int y0, int y1) {
+    stores = bad_stores = 0;
+    min_x = x0;
+    max_x = x1;
+    min_y = y0;
+    max_y = y1;
+}
+
+int main(int argc, char **argv) {
+    Var x("x"), y("y");
+
+    {
+        // Only trace a 4x4 box of a scalar Func.
+        Func f("f");
+        f(x, y) = x + y;
+        f.trace_stores().trace_region({{2, 4}, {3, 4}});
+        f.set_custom_trace(&my_trace);
+        reset(2, 5, 3, 6);
+        f.realize(16, 16);
+        if (stores != 16 || bad_stores != 0) {
+            printf("trace_region: expected 16 stores in the box, got %d (%d outside)\n",
+                   stores, bad_stores);
+            return -1;
+        }
+    }
+
+    {
+        // A vectorized Func traces whole vectors that touch the box.
+        Func f("f");
+        f(x, y) = x + y;
+        f.vectorize(x, 8);
+        f.trace_stores().trace_region({{6, 4}, {0, 1}});
+        f.set_custom_trace(&my_trace);
+        reset(6, 9, 0, 0);
+        f.realize(16, 16);
+        if (stores != 2 || bad_stores != 0) {
+            printf("trace_region (vectorized): expected 2 stores, got %d (%d outside)\n",
+                   stores, bad_stores);
+            return -1;
+        }
+    }
+
+    {
+        // Trace every fourth 2x2 tile in each dimension.
+        Func f("f");
+        f(x, y) = x + y;
+        f.trace_stores().trace_sample(4, 2);
+        f.set_custom_trace(&my_trace);
+        reset(0, 15, 0, 15);
+        f.realize(16, 16);
+        if (stores != 16) {
+            printf("trace_sample: expected 16 stores, got %d\n", stores);
+            return -1;
+        }
+    }
+
+    {
+        // Only trace the first 10 stores.
+        Func f("f");
+        f(x, y) = x + y;
+        f.trace_stores().trace_limit(10);
+        f.set_custom_trace(&my_trace);
+        reset(0, 15, 0, 15);
+        f.realize(16, 16);
+        if (stores != 10) {
+            printf("trace_limit: expected 10 stores, got %d\n", stores);
+            return -1;
+        }
+        // The budget is per invocation of the pipeline.
+        reset(0, 15, 0, 15);
+        f.realize(16, 16);
+        if (stores != 10) {
+            printf("trace_limit: expected 10 stores on second run, got %d\n", stores);
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,64 @@
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+
+#include "HalideRuntime.h"
+#include "HalideBuffer.h"
+#include "memory_timeline.h"
+
+using namespace Halide::Runtime;
+
+int main(int argc, char **argv) {
+    const int size = 1000;
+
+    if (halide_profiler_enable_allocation_log(100) != 0) {
+        printf("Failed to enable the allocation log\n");
+        return -1;
+    }
+
+    Buffer<int32_t> output(size, size);
+    if (memory_timeline(output) != 0) {
+        printf("memory_timeline failed\n");
+        return -1;
+    }
+
+    const halide_profiler_allocation_event *events;
+    int num_events = halide_profiler_get_allocation_log(&events);
+    if (num_events != 4) {
+        printf("Expected 4 allocation events instead of %d\n", num_events);
+        return -1;
+    }
+
+    const uint64_t bytes = size * size * sizeof(int32_t);
+    uint64_t current = 0, peak = 0;
+    for (int i = 0; i < num_events; i++) {
+        const halide_profiler_allocation_event &e = events[i];
+        if (strcmp(e.func_name, "g1_timeline") != 0 &&
+            strcmp(e.func_name, "g2_timeline") != 0) {
+            printf("Unexpected allocation by %s\n", e.func_name);
+            return -1;
+        }
+        if (e.size < bytes) {
+            printf("Allocation of %s was %llu bytes instead of at least %llu\n",
+                   e.func_name, (unsigned long long)e.size, (unsigned long long)bytes);
+            return -1;
+        }
+        if (i > 0 && e.time < events[i - 1].time) {
+            printf("Allocation events are out of order\n");
+            return -1;
+        }
+        current = e.is_free ? current - e.size : current + e.size;
+        peak = std::max(peak, current);
+    }
+    if (current != 0 || peak < 2 * bytes) {
+        printf("Replaying the log gave a peak of %llu bytes and %llu bytes leaked\n",
+               (unsigned long long)peak, (unsigned long long)current);
+        return -1;
+    }
+
+    halide_profiler_allocation_report(nullptr);
+    halide_profiler_enable_allocation_log(0);
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,28 @@
+#include "Halide.h"
+
+namespace {
+
+class MemoryTimeline : public Halide::Generator<MemoryTimeline> {
+public:
+    Output<Buffer<int32_t>> f_timeline{"f_timeline", 2};
+
+    void generate() {
+        // Two heap allocations that are live at the same time.
+        g1(x, y) = x;
+        g2(x, y) = y;
+        f_timeline(x, y) = g1(x, y) + g2(x, y);
+    }
+
+    void schedule() {
+        g1.compute_root();
+        g2.compute_root();
+    }
+
+private:
+    Var x{"x"}, y{"y"};
+    Func g1{"g1_timeline"}, g2{"g2_timeline"};
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(MemoryTimeline, memory_timeline)
@@ -0,0 +1,82 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "HalideRuntime.h"
+#include "HalideBuffer.h"
+#include "roofline_profiler.h"
+
+using namespace Halide::Runtime;
+
+namespace {
+
+halide_profiler_func_stats *find_func(halide_profiler_state *s, const char *name) {
+    for (halide_profiler_pipeline_stats *p = s->pipelines; p;
+         p = (halide_profiler_pipeline_stats *)(p->next)) {
+        for (int i = 0; i < p->num_funcs; i++) {
+            if (strcmp(p->funcs[i].name, name) == 0) {
+                return p->funcs + i;
+            }
+        }
+    }
+    return nullptr;
+}
+
+int check(halide_profiler_state *s, const char *name,
+          uint64_t ops, uint64_t loaded, uint64_t stored) {
+    halide_profiler_func_stats *fs = find_func(s, name);
+    if (!fs) {
+        printf("No profiler stats for %s\n", name);
+        return -1;
+    }
+    if (fs->arith_ops != ops || fs->bytes_loaded != loaded || fs->bytes_stored != stored) {
+        printf("%s: recorded %llu ops, %llu bytes loaded, %llu bytes stored "
+               "instead of %llu, %llu, %llu\n", name,
+               (unsigned long long)fs->arith_ops,
+               (unsigned long long)fs->bytes_loaded,
+               (unsigned long long)fs->bytes_stored,
+               (unsigned long long)ops,
+               (unsigned long long)loaded,
+               (unsigned long long)stored);
+        return -1;
+    }
+    return 0;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    const int size = 100;
+    const uint64_t points = size * size;
+
+    Buffer<int32_t> f(size, size), h(size);
+    if (roofline_profiler(f, h) != 0) {
+        printf("roofline_profiler failed\n");
+        return -1;
+    }
+
+    // Nothing resets the profiler in an AOT binary, so the stats of the
+    // only run of the pipeline are still there.
+    halide_profiler_state *state = halide_profiler_get_state();
+    if (!state) {
+        printf("No profiler state\n");
+        return -1;
+    }
+
+    // g: a multiply and a store per point.
+    if (check(state, "g_roof", 2 * points, 0, 4 * points) != 0) {
+        return -1;
+    }
+    // f: a load, an add and a store per point.
+    if (check(state, "f_roof", 3 * points, 4 * points, 4 * points) != 0) {
+        return -1;
+    }
+    // The pure stage of h does a store for each of the 100 points. The
+    // update stage does a load, a multiply, an add and a store for each
+    // of the 100 * 10 points.
+    if (check(state, "h_roof", 100 + 4 * 1000, 4 * 1000, 4 * 100 + 4 * 1000) != 0) {
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,30 @@
+#include "Halide.h"
+
+namespace {
+
+class RooflineProfiler : public Halide::Generator<RooflineProfiler> {
+public:
+    Output<Buffer<int32_t>> f_roof{"f_roof", 2};
+    Output<Buffer<int32_t>> h_roof{"h_roof", 1};
+
+    void generate() {
+        g(x, y) = x * y;
+        f_roof(x, y) = g(x, y) + 1;
+
+        RDom r(0, 10);
+        h_roof(x) = 0;
+        h_roof(x) += x * r;
+    }
+
+    void schedule() {
+        g.compute_root();
+    }
+
+private:
+    Var x{"x"}, y{"y"};
+    Func g{"g_roof"};
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(RooflineProfiler, roofline_profiler)
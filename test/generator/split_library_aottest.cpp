@@ -0,0 +1,87 @@
+#include "HalideRuntime.h"
+#include "HalideBuffer.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#include "split_library.h"
+
+using namespace Halide::Runtime;
+
+const int kWidth = 123, kHeight = 97;
+
+int run_pipeline() {
+    Buffer<int32_t> input(kWidth, kHeight);
+    input.for_each_element([&](int x, int y) { input(x, y) = (x * 7 + y * 13) % 101; });
+
+    Buffer<int32_t> output(kWidth, kHeight);
+    int result = split_library(input, output);
+    if (result != 0) {
+        printf("split_library failed: %d\n", result);
+        return -1;
+    }
+
+    auto f = [&](int x, int y) {
+        x = std::min(std::max(x, 0), kWidth - 1);
+        y = std::min(std::max(y, 0), kHeight - 1);
+        return input(x, y) * 3 + 1;
+    };
+    auto g = [&](int x, int y) {
+        return f(x - 1, y) + f(x, y) + f(x + 1, y);
+    };
+    for (int y = 0; y < kHeight; y++) {
+        for (int x = 0; x < kWidth; x++) {
+            int correct = g(x, y - 1) + g(x, y) + g(x, y + 1) - f(x, y);
+            if (output(x, y) != correct) {
+                printf("output(%d, %d) = %d instead of %d\n", x, y, output(x, y), correct);
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1 && strcmp(argv[1], "run") == 0) {
+        return run_pipeline();
+    }
+
+    // The constructors and destructors of the runtime must still run
+    // when it is split into several objects. The pipeline is profiled,
+    // and the destructor of the profiler saves the profile at exit, so
+    // run the pipeline in a child process and check that the profile
+    // was saved.
+    const char *profile_file = "split_library_profile.txt";
+    remove(profile_file);
+    static char profile_var[] = "HL_PROFILE_FILE=split_library_profile.txt";
+    putenv(profile_var);
+
+    std::string command = std::string("\"") + argv[0] + "\" run";
+    if (system(command.c_str()) != 0) {
+        printf("Running the pipeline failed\n");
+        return -1;
+    }
+
+    FILE *f = fopen(profile_file, "r");
+    if (!f) {
+        printf("The destructor of the profiler did not save the profile\n");
+        return -1;
+    }
+    char line[1024];
+    bool found = false;
+    while (fgets(line, sizeof(line), f)) {
+        found = found || (strncmp(line, "pipeline split_library ", 23) == 0);
+    }
+    fclose(f);
+    if (!found) {
+        printf("The saved profile has no stats for split_library\n");
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
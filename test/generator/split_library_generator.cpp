@@ -0,0 +1,40 @@
+#include "Halide.h"
+
+namespace {
+
+// A pipeline with several parallel loops, each of which is lowered to its
+// own closure function. When a static library is produced, the module is
+// split along these functions and the parts are compiled to separate
+// objects, so linking and running it checks that the internal functions
+// are still reachable across the objects. It's built with the profiler,
+// whose destructor in the runtime must still run.
+class SplitLibrary : public Halide::Generator<SplitLibrary> {
+public:
+    Input<Buffer<int32_t>> input{ "input", 2 };
+    Output<Buffer<int32_t>> output{ "output", 2 };
+
+    void generate() {
+        Func clamped = Halide::BoundaryConditions::repeat_edge(input);
+
+        f(x, y) = clamped(x, y) * 3 + 1;
+        g(x, y) = f(x - 1, y) + f(x, y) + f(x + 1, y);
+        h(x, y) = g(x, y - 1) + g(x, y) + g(x, y + 1);
+        output(x, y) = h(x, y) - f(x, y);
+    }
+
+    void schedule() {
+        const int v = natural_vector_size<int32_t>();
+        f.compute_root().parallel(y).vectorize(x, v);
+        g.compute_root().parallel(y, 8).vectorize(x, v);
+        h.compute_root().parallel(y, 4);
+        output.parallel(y).vectorize(x, v);
+    }
+
+private:
+    Var x{"x"}, y{"y"};
+    Func f{"f"}, g{"g"}, h{"h"};
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(SplitLibrary, split_library)
@@ -0,0 +1,203 @@
+#include "Halide.h"
+#include "halide_benchmark.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+using namespace Halide;
+using namespace Halide::Tools;
+
+// Compare the cost predicted by the auto-scheduler for a few pipelines with
+// the runtime of the auto-scheduled pipelines, and with the runtime of
+// hand-written schedules for the same pipelines. This reports the slowdown
+// of each auto-scheduled pipeline, and the rank correlation between the
+// predicted costs and the runtimes, so that regressions of the heuristics
+// of the auto-scheduler show up.
+//
+// The pipelines are small stand-ins for the kinds of pipelines in
+// test/auto_schedule, with hand-written schedules to compare against. The
+// apps/ generators are not covered, as they can't be JIT-compiled here.
+
+// The pipelines read a border of this size around the output.
+const int margin = 8;
+
+Var x("x"), y("y"), xi("xi"), yi("yi");
+
+// Each pipeline is built either with a hand-written schedule, or without a
+// schedule for the auto-scheduler.
+Func blur(ImageParam in, bool manual) {
+    Func blur_x("blur_x"), blur_y("blur_y");
+    blur_x(x, y) = (in(x - 1, y) + in(x, y) + in(x + 1, y)) / 3;
+    blur_y(x, y) = (blur_x(x, y - 1) + blur_x(x, y) + blur_x(x, y + 1)) / 3;
+
+    if (manual) {
+        blur_y.tile(x, y, xi, yi, 256, 32).vectorize(xi, 8).parallel(y);
+        blur_x.compute_at(blur_y, x).vectorize(x, 8);
+    }
+    return blur_y;
+}
+
+Func stencil_chain(ImageParam in, bool manual) {
+    const int num_stencils = 8;
+    std::vector<Func> stencils(num_stencils);
+    stencils[0](x, y) = (in(x - 1, y) + in(x, y) + in(x + 1, y)) / 3;
+    for (int i = 1; i < num_stencils; i++) {
+        Func prev = stencils[i - 1];
+        if (i % 2) {
+            stencils[i](x, y) = (prev(x, y - 1) + prev(x, y) + prev(x, y + 1)) / 3;
+        } else {
+            stencils[i](x, y) = (prev(x - 1, y) + prev(x, y) + prev(x + 1, y)) / 3;
+        }
+    }
+
+    Func out = stencils[num_stencils - 1];
+    if (manual) {
+        out.split(y, y, yi, 64).parallel(y).vectorize(x, 8);
+        for (int i = 0; i < num_stencils - 1; i++) {
+            stencils[i].store_at(out, y).compute_at(out, yi).vectorize(x, 8);
+        }
+    }
+    return out;
+}
+
+Func mat_mul(ImageParam in, bool manual) {
+    // Multiply the input with its transpose.
+    const int size = 512;
+    RDom k(0, size);
+    Func prod("prod");
+    prod(x, y) = 0.0f;
+    prod(x, y) += in(k, y) * in(k, x);
+
+    if (manual) {
+        prod.tile(x, y, xi, yi, 32, 8).vectorize(xi, 8).unroll(yi).parallel(y);
+        prod.update().tile(x, y, xi, yi, 32, 8).reorder(xi, yi, k, x, y)
+            .vectorize(xi, 8).unroll(yi).parallel(y);
+    }
+    return prod;
+}
+
+Func brighten(ImageParam in, bool manual) {
+    Func out("out");
+    out(x, y) = in(x, y) * 1.5f + 0.25f;
+
+    if (manual) {
+        out.vectorize(x, 8).parallel(y, 16);
+    }
+    return out;
+}
+
+struct Result {
+    std::string name;
+    double predicted;
+    double auto_time;
+    double manual_time;
+};
+
+// Benchmark the pipeline built by 'build' with both schedules on a
+// 'width' x 'height' output.
+Result run(const std::string &name, std::function<Func(ImageParam, bool)> build,
+           int width, int height) {
+    Target target = get_jit_target_from_environment();
+
+    ImageParam input(Float(32), 2);
+    Buffer<float> in(width + 2 * margin, height + 2 * margin);
+    in.set_min(-margin, -margin);
+    in.for_each_element([&](int x, int y) { in(x, y) = (float)((x * 7 + y * 3) % 13) / 13; });
+    input.set(in);
+    input.dim(0).set_bounds_estimate(-margin, width + 2 * margin);
+    input.dim(1).set_bounds_estimate(-margin, height + 2 * margin);
+
+    Buffer<float> out(width, height);
+
+    Func manual = build(input, true);
+    manual.compile_jit(target);
+    double manual_time = benchmark(3, 3, [&]() { manual.realize(out); });
+
+    Func automatic = build(input, false);
+    automatic.estimate(x, 0, width).estimate(y, 0, height);
+    Pipeline p(automatic);
+    std::string schedule = p.auto_schedule(target);
+    p.compile_jit(target);
+    double auto_time = benchmark(3, 3, [&]() { p.realize(out); });
+
+    // The cost is "unknown" if it isn't a constant, in which case it's left
+    // at zero.
+    double predicted = 0;
+    const std::string marker = "// Estimated cost: ";
+    size_t pos = schedule.find(marker);
+    if (pos != std::string::npos) {
+        const char *start = schedule.c_str() + pos + marker.size();
+        char *end = nullptr;
+        double cost = strtod(start, &end);
+        if (end != start) {
+            predicted = cost;
+        }
+    }
+
+    return {name, predicted, auto_time, manual_time};
+}
+
+// Return the rank of each value in 'v', starting at 1.
+std::vector<double> ranks(const std::vector<double> &v) {
+    std::vector<double> r(v.size());
+    for (size_t i = 0; i < v.size(); i++) {
+        r[i] = 1 + std::count_if(v.begin(), v.end(), [&](double o) { return o < v[i]; });
+    }
+    return r;
+}
+
+// Return the Spearman rank correlation between 'a' and 'b'.
+double rank_correlation(const std::vector<double> &a, const std::vector<double> &b) {
+    std::vector<double> ra = ranks(a), rb = ranks(b);
+    double n = a.size(), d2 = 0;
+    for (size_t i = 0; i < a.size(); i++) {
+        d2 += (ra[i] - rb[i]) * (ra[i] - rb[i]);
+    }
+    return 1 - 6 * d2 / (n * (n * n - 1));
+}
+
+int main(int argc, char **argv) {
+    std::vector<Result> results;
+    results.push_back(run("brighten", brighten, 4096, 4096));
+    results.push_back(run("blur", blur, 2048, 2048));
+    results.push_back(run("stencil_chain", stencil_chain, 2048, 2048));
+    results.push_back(run("mat_mul", mat_mul, 512, 512));
+
+    printf("%-16s %16s %12s %12s %10s\n", "pipeline", "predicted cost",
+           "auto (ms)", "manual (ms)", "slowdown");
+    std::vector<double> predicted, auto_times, manual_times;
+    double log_slowdown = 0;
+    for (const Result &r : results) {
+        double slowdown = r.auto_time / r.manual_time;
+        printf("%-16s %16.0f %12.3f %12.3f %9.2fx\n", r.name.c_str(), r.predicted,
+               r.auto_time * 1e3, r.manual_time * 1e3, slowdown);
+        if (r.predicted <= 0) {
+            printf("The auto-scheduler did not estimate the cost of %s\n", r.name.c_str());
+            return -1;
+        }
+        predicted.push_back(r.predicted);
+        auto_times.push_back(r.auto_time);
+        manual_times.push_back(r.manual_time);
+        log_slowdown += std::log(slowdown);
+    }
+
+    double auto_correlation = rank_correlation(predicted, auto_times);
+    double manual_correlation = rank_correlation(predicted, manual_times);
+    printf("Rank correlation of predicted cost with auto-scheduled time: %.2f\n", auto_correlation);
+    printf("Rank correlation of predicted cost with manual time: %.2f\n", manual_correlation);
+    printf("Geometric mean slowdown: %.2fx\n", std::exp(log_slowdown / results.size()));
+
+    // The pipelines differ in cost by orders of magnitude, so the cost model
+    // should at least rank them in the right direction.
+    if (auto_correlation < 0) {
+        printf("The predicted costs are anti-correlated with the runtimes\n");
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -813,6 +813,12 @@ Flags:
         allocation during run; note that this may slow down execution, so
         benchmarks may be inaccurate if you combine --benchmark with this.
 
+    --memory_timeline:
+        Print every heap allocation and free made by the filter (with its
+        time, Func, size and thread), followed by a breakdown of the
+        allocations live at the high-water mark. Requires the filter to be
+        compiled with the "profile" target feature.
+
 Known Issues:
 
     * Filters running on GPU (vs CPU) have not been tested.
@@ -901,6 +907,7 @@ int main(int argc, char **argv) {
     std::vector<std::string> unknown_args;
     bool benchmark = false;
     bool track_memory = false;
+    bool memory_timeline = false;
     bool describe = false;
     double benchmark_min_time = BenchmarkConfig().min_time;
     int benchmark_min_iters = BenchmarkConfig().min_iters;
@@ -945,6 +952,13 @@ int main(int argc, char **argv) {
                 if (!parse_scalar(flag_value, &track_memory)) {
                     fail() << "Invalid value for flag: " << flag_name;
                 }
+            } else if (flag_name == "memory_timeline") {
+                if (flag_value.empty()) {
+                    flag_value = "true";
+                }
+                if (!parse_scalar(flag_value, &memory_timeline)) {
+                    fail() << "Invalid value for flag: " << flag_name;
+                }
             } else if (flag_name == "benchmarks") {
                 if (flag_value != "all") {
                     fail() << "The only valid value for --benchmarks is 'all'";
@@ -1002,12 +1016,16 @@ int main(int argc, char **argv) {
     }
 
     // It's OK to omit output arguments when we are benchmarking or tracking memory.
-    bool ok_to_omit_outputs = (benchmark || track_memory);
+    bool ok_to_omit_outputs = (benchmark || track_memory || memory_timeline);
 
     if (benchmark && track_memory) {
         warn() << "Using --track_memory with --benchmarks will produce inaccurate benchmark results.";
     }
 
+    if (benchmark && memory_timeline) {
+        warn() << "Using --memory_timeline with --benchmarks will log the allocations of every benchmark iteration.";
+    }
+
     // Check to be sure that all required arguments are specified.
     if (found.size() != args.size() || !unknown_args.empty()) {
         std::ostringstream o;
@@ -1095,6 +1113,14 @@ int main(int argc, char **argv) {
         tracker.install();
     }
 
+    // Likewise, only log the allocations made by the real run(s).
+    if (memory_timeline) {
+        const int max_events = 1 << 20;
+        if (halide_profiler_enable_allocation_log(max_events) != 0) {
+            fail() << "Unable to allocate the allocation log";
+        }
+    }
+
     {
         std::vector<void*> filter_argv(args.size(), nullptr);
         for (auto &arg_pair : args) {
@@ -1161,6 +1187,16 @@ int main(int argc, char **argv) {
             << " bytes for output of " << megapixels << " mpix.\n";
     }
 
+    if (memory_timeline) {
+        const halide_profiler_allocation_event *events;
+        if (halide_profiler_get_allocation_log(&events) == 0) {
+            warn() << "No allocations were logged; the filter must be compiled with the 'profile' "
+                   << "target feature to log its allocations.";
+        }
+        halide_profiler_allocation_report(nullptr);
+        halide_profiler_enable_allocation_log(0);
+    }
+
     // Save the output(s), if necessary.
     for (auto &arg_pair : args) {
         auto &arg_name = arg_pair.first;
@@ -0,0 +1,104 @@
+#include "HalideTraceCacheSim.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+/** \file
+ *
+ * A tool which reads a binary Halide trace containing loads and
+ * stores, maps the coordinates of each access to an address, and
+ * feeds the addresses through a simulated multi-level set-associative
+ * cache. It reports, per Func, the miss rate at each cache level, the
+ * bytes moved to and from DRAM, and a histogram of reuse distances.
+ * The simulator itself is in HalideTraceCacheSim.h.
+ */
+
+using namespace Halide;
+using namespace Internal;
+
+using std::string;
+using std::vector;
+
+namespace {
+
+void usage(char * const *argv) {
+    const string usage =
+        "Usage: " + string(argv[0]) + " -i trace_file [-c size line_size associativity]...\n"
+        "\n"
+        "This tool reads a binary trace produced by Halide, and simulates the\n"
+        "loads and stores in it against a multi-level set-associative cache.\n"
+        "It reports the miss rate at each level, the bytes moved to and from\n"
+        "DRAM and a histogram of reuse distances for each Func.\n"
+        "\n"
+        "Each -c adds a cache level, starting from L1. Sizes are in bytes. The\n"
+        "default is a 32k 8-way L1, a 256k 8-way L2 and an 8M 16-way L3, all\n"
+        "with 64 byte lines.\n"
+        "\n"
+        "To generate a suitable binary trace, use Func::trace_loads() and\n"
+        "Func::trace_stores(), or the target features trace_loads, trace_stores\n"
+        "and trace_realizations, and run with HL_TRACE_FILE=<filename>.\n";
+    fprintf(stderr, "%s\n", usage.c_str());
+    exit(1);
+}
+
+}  // namespace
+
+int main(int argc, char * const *argv) {
+    char *trace_filename = nullptr;
+    vector<CacheLevelConfig> configs;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "-i" && i + 1 < argc) {
+            trace_filename = argv[++i];
+        } else if (arg == "-c" && i + 3 < argc) {
+            CacheLevelConfig c;
+            c.size = strtoull(argv[++i], nullptr, 10);
+            c.line_size = strtoull(argv[++i], nullptr, 10);
+            c.associativity = strtoull(argv[++i], nullptr, 10);
+            if (!c.size || !c.line_size || !c.associativity) {
+                usage(argv);
+            }
+            configs.push_back(c);
+        } else {
+            usage(argv);
+        }
+    }
+
+    if (trace_filename == nullptr) {
+        usage(argv);
+    }
+
+    if (configs.empty()) {
+        configs = {{32 * 1024, 64, 8},
+                   {256 * 1024, 64, 8},
+                   {8 * 1024 * 1024, 64, 16}};
+    }
+
+    FILE *file_desc = fopen(trace_filename, "r");
+    if (file_desc == nullptr) {
+        fprintf(stderr, "Error opening file: %s. Exiting.\n", trace_filename);
+        exit(1);
+    }
+
+    Simulator sim(configs);
+    PacketReader reader(file_desc);
+    Packet p;
+    while (reader.read(&p)) {
+        sim.observe(p);
+    }
+    sim.finish_observing();
+
+    if (!reader.rewind()) {
+        fprintf(stderr, "Error: couldn't seek back to beginning of trace file. Aborting.\n");
+        exit(-1);
+    }
+    while (reader.read(&p)) {
+        sim.simulate(p);
+    }
+    fclose(file_desc);
+
+    sim.report();
+    return 0;
+}
@@ -0,0 +1,406 @@
+#ifndef HALIDE_TRACE_CACHE_SIM_H
+#define HALIDE_TRACE_CACHE_SIM_H
+
+#include "HalideTraceUtils.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/** \file
+ *
+ * A simulated multi-level set-associative cache, fed with the loads
+ * and stores of a binary Halide trace. This is the core of
+ * HalideTraceCacheSim.
+ *
+ * Buffers are laid out densely, innermost dimension first, using the
+ * bounds from begin_realization events when they were traced, and
+ * otherwise the bounding box of all accesses to the Func.
+ */
+
+namespace Halide {
+namespace Internal {
+
+// The number of log2-sized buckets in the reuse distance histograms.
+const int histogram_buckets = 32;
+
+struct CacheLevelConfig {
+    uint64_t size, line_size, associativity;
+};
+
+// One level of an LRU set-associative write-back cache.
+class CacheLevel {
+    struct Line {
+        uint64_t tag;
+        uint64_t last_used;
+        int owner;
+        bool valid, dirty;
+    };
+
+    CacheLevelConfig config;
+    uint64_t num_sets;
+    std::vector<Line> lines;
+    uint64_t clock = 0;
+
+public:
+    CacheLevel(const CacheLevelConfig &c) : config(c) {
+        num_sets = std::max<uint64_t>(1, c.size / (c.line_size * c.associativity));
+        lines.resize(num_sets * c.associativity, Line{0, 0, -1, false, false});
+    }
+
+    const CacheLevelConfig &get_config() const {
+        return config;
+    }
+
+    // Access the line containing the given address on behalf of the
+    // given Func. Returns true on a hit. On a miss the line is filled,
+    // and if that evicts a dirty line, its address and owner are
+    // returned in evicted_addr and evicted_owner. Otherwise
+    // evicted_owner is set to -1.
+    bool access(uint64_t addr, bool write, int owner,
+                uint64_t *evicted_addr, int *evicted_owner) {
+        uint64_t line_addr = addr / config.line_size;
+        uint64_t set = line_addr % num_sets;
+        Line *ways = &lines[set * config.associativity];
+        clock++;
+        *evicted_owner = -1;
+
+        Line *victim = ways;
+        for (uint64_t i = 0; i < config.associativity; i++) {
+            Line &l = ways[i];
+            if (l.valid && l.tag == line_addr) {
+                l.last_used = clock;
+                l.dirty |= write;
+                return true;
+            }
+            if (!l.valid || (victim->valid && l.last_used < victim->last_used)) {
+                victim = &l;
+            }
+        }
+
+        if (victim->valid && victim->dirty) {
+            *evicted_addr = victim->tag * config.line_size;
+            *evicted_owner = victim->owner;
+        }
+        *victim = Line{line_addr, clock, owner, true, write};
+        return false;
+    }
+};
+
+// Computes exact reuse distances (the number of distinct lines touched
+// since the last access to the same line) using a Fenwick tree over
+// access times, in which only the most recent access to each line is
+// marked.
+class ReuseDistance {
+    std::unordered_map<uint64_t, uint64_t> last_access;
+    std::vector<int32_t> tree;
+    uint64_t now = 0;
+
+    void add(uint64_t t, int32_t delta) {
+        for (uint64_t i = t + 1; i <= tree.size(); i += i & (~i + 1)) {
+            tree[i - 1] += delta;
+        }
+    }
+
+    int64_t prefix(uint64_t t) const {
+        int64_t sum = 0;
+        for (uint64_t i = t + 1; i > 0; i -= i & (~i + 1)) {
+            sum += tree[i - 1];
+        }
+        return sum;
+    }
+
+    // Renumber the live accesses once the tree fills up.
+    void compact() {
+        std::vector<std::pair<uint64_t, uint64_t>> live;
+        live.reserve(last_access.size());
+        for (const auto &p : last_access) {
+            live.push_back({p.second, p.first});
+        }
+        std::sort(live.begin(), live.end());
+        size_t capacity = tree.size();
+        while (live.size() * 2 > capacity) {
+            capacity *= 2;
+        }
+        tree.assign(capacity, 0);
+        for (size_t i = 0; i < live.size(); i++) {
+            last_access[live[i].second] = i;
+            add(i, 1);
+        }
+        now = live.size();
+    }
+
+public:
+    ReuseDistance() : tree(1 << 20, 0) {}
+
+    // Record an access to a line and return its reuse distance, or -1
+    // on the first access.
+    int64_t access(uint64_t line) {
+        if (now == tree.size()) {
+            compact();
+        }
+        int64_t distance = -1;
+        auto it = last_access.find(line);
+        if (it != last_access.end()) {
+            distance = prefix(now - 1) - prefix(it->second);
+            add(it->second, -1);
+            it->second = now;
+        } else {
+            last_access[line] = now;
+        }
+        add(now, 1);
+        now++;
+        return distance;
+    }
+};
+
+struct Layout {
+    uint64_t base = 0;
+    int dimensions = 0;
+    int64_t min[16], extent[16];
+};
+
+struct FuncStats {
+    std::string name;
+    uint64_t loads = 0, stores = 0, bytes = 0;
+    std::vector<uint64_t> misses;
+    uint64_t dram_read_bytes = 0, dram_write_bytes = 0;
+    uint64_t cold = 0;
+    uint64_t reuse[histogram_buckets] = {0};
+
+    // Fallback layout from the bounding box of all accesses.
+    int dimensions = 0;
+    int64_t min_coords[16], max_coords[16];
+    Layout fallback;
+};
+
+class Simulator {
+    std::vector<CacheLevel> levels;
+    ReuseDistance reuse;
+    std::map<std::string, int> func_index;
+    std::map<int32_t, Layout> realizations;
+    uint64_t next_base = 0;
+
+    uint64_t allocate(const Layout &l, int bytes) {
+        uint64_t size = bytes;
+        for (int i = 0; i < l.dimensions; i++) {
+            size *= (uint64_t)std::max<int64_t>(1, l.extent[i]);
+        }
+        // Align allocations to 4k so they don't share lines.
+        uint64_t base = next_base;
+        next_base += (size + 4095) & ~(uint64_t)4095;
+        return base;
+    }
+
+public:
+    std::vector<FuncStats> funcs;
+
+    Simulator(const std::vector<CacheLevelConfig> &configs) {
+        for (const auto &c : configs) {
+            levels.emplace_back(c);
+        }
+    }
+
+    int get_func(const char *name) {
+        auto it = func_index.find(name);
+        if (it != func_index.end()) {
+            return it->second;
+        }
+        int idx = (int)funcs.size();
+        func_index[name] = idx;
+        funcs.emplace_back();
+        funcs.back().name = name;
+        funcs.back().misses.resize(levels.size(), 0);
+        return idx;
+    }
+
+    // First pass: find the bounding box of all accesses to each Func.
+    void observe(const Packet &p) {
+        if (p.event != halide_trace_load && p.event != halide_trace_store) {
+            return;
+        }
+        FuncStats &f = funcs[get_func(p.func())];
+        int lanes = p.type.lanes;
+        int dims = std::min(16, p.dimensions / lanes);
+        if (f.dimensions == 0) {
+            f.dimensions = dims;
+            for (int d = 0; d < dims; d++) {
+                f.min_coords[d] = INT32_MAX;
+                f.max_coords[d] = INT32_MIN;
+            }
+        }
+        for (int d = 0; d < std::min(dims, f.dimensions); d++) {
+            for (int l = 0; l < lanes; l++) {
+                int64_t c = p.get_coord(d * lanes + l);
+                f.min_coords[d] = std::min(f.min_coords[d], c);
+                f.max_coords[d] = std::max(f.max_coords[d], c);
+            }
+        }
+    }
+
+    void finish_observing() {
+        for (FuncStats &f : funcs) {
+            f.fallback.dimensions = f.dimensions;
+            for (int d = 0; d < f.dimensions; d++) {
+                f.fallback.min[d] = f.min_coords[d];
+                f.fallback.extent[d] = f.max_coords[d] - f.min_coords[d] + 1;
+            }
+            // The element size isn't known until an access is seen, so
+            // reserve room for the widest type.
+            f.fallback.base = allocate(f.fallback, 8);
+        }
+    }
+
+    // Second pass: simulate the cache.
+    void simulate(const Packet &p) {
+        if (p.event == halide_trace_begin_realization) {
+            Layout l;
+            l.dimensions = std::min(16, p.dimensions / 2);
+            for (int d = 0; d < l.dimensions; d++) {
+                l.min[d] = p.get_coord(2 * d);
+                l.extent[d] = p.get_coord(2 * d + 1);
+            }
+            l.base = allocate(l, 8);
+            realizations[p.id] = l;
+            return;
+        } else if (p.event == halide_trace_end_realization) {
+            realizations.erase(p.parent_id);
+            return;
+        } else if (p.event != halide_trace_load && p.event != halide_trace_store) {
+            return;
+        }
+
+        bool is_store = p.event == halide_trace_store;
+        int idx = get_func(p.func());
+        FuncStats &f = funcs[idx];
+        auto it = realizations.find(p.parent_id);
+        const Layout &layout = (it != realizations.end()) ? it->second : f.fallback;
+
+        int lanes = p.type.lanes;
+        int dims = std::min(layout.dimensions, p.dimensions / lanes);
+        int bytes = p.type.bytes();
+        if (is_store) {
+            f.stores += lanes;
+        } else {
+            f.loads += lanes;
+        }
+        f.bytes += (uint64_t)lanes * bytes;
+
+        uint64_t line_size = levels.empty() ? 64 : levels[0].get_config().line_size;
+        uint64_t prev_line = ~(uint64_t)0;
+        for (int l = 0; l < lanes; l++) {
+            int64_t offset = 0, stride = 1;
+            for (int d = 0; d < dims; d++) {
+                int64_t c = p.get_coord(d * lanes + l) - layout.min[d];
+                c = std::max<int64_t>(0, std::min<int64_t>(c, layout.extent[d] - 1));
+                offset += c * stride;
+                stride *= std::max<int64_t>(1, layout.extent[d]);
+            }
+            uint64_t addr = layout.base + (uint64_t)offset * bytes;
+            uint64_t line = addr / line_size;
+            // Lanes that land on the same line as the previous one
+            // count as one access.
+            if (line == prev_line) {
+                continue;
+            }
+            prev_line = line;
+            access(idx, addr, line, is_store);
+        }
+    }
+
+    void access(int idx, uint64_t addr, uint64_t line, bool is_store) {
+        FuncStats &f = funcs[idx];
+        int64_t distance = reuse.access(line);
+        if (distance < 0) {
+            f.cold++;
+        } else {
+            int bucket = 0;
+            while (bucket < histogram_buckets - 1 && ((uint64_t)1 << bucket) <= (uint64_t)distance) {
+                bucket++;
+            }
+            f.reuse[bucket]++;
+        }
+
+        for (size_t i = 0; i < levels.size(); i++) {
+            // Only the first level is dirtied by a store. The lower
+            // levels see it when the line is written back.
+            uint64_t evicted_addr;
+            int evicted_owner;
+            bool hit = levels[i].access(addr, is_store && i == 0, idx, &evicted_addr, &evicted_owner);
+            if (evicted_owner >= 0) {
+                write_back(i + 1, evicted_addr, evicted_owner);
+            }
+            if (hit) {
+                return;
+            }
+            f.misses[i]++;
+            if (i + 1 == levels.size()) {
+                f.dram_read_bytes += levels[i].get_config().line_size;
+            }
+        }
+    }
+
+    // Write a dirty line evicted from the level above back into the
+    // given level. The whole line is written, so a miss allocates it
+    // without reading it from the level below. Past the last level,
+    // it's written to DRAM.
+    void write_back(size_t level, uint64_t addr, int owner) {
+        if (level == levels.size()) {
+            funcs[owner].dram_write_bytes += levels.back().get_config().line_size;
+            return;
+        }
+        uint64_t evicted_addr;
+        int evicted_owner;
+        levels[level].access(addr, true, owner, &evicted_addr, &evicted_owner);
+        if (evicted_owner >= 0) {
+            write_back(level + 1, evicted_addr, evicted_owner);
+        }
+    }
+
+    void report() const {
+        for (const FuncStats &f : funcs) {
+            uint64_t accesses = f.loads + f.stores;
+            if (!accesses) {
+                continue;
+            }
+            printf("Func %s:\n", f.name.c_str());
+            printf("  loads: %llu, stores: %llu, bytes accessed: %llu\n",
+                   (unsigned long long)f.loads, (unsigned long long)f.stores,
+                   (unsigned long long)f.bytes);
+            uint64_t line_accesses = f.cold;
+            for (int b = 0; b < histogram_buckets; b++) {
+                line_accesses += f.reuse[b];
+            }
+            uint64_t reaching = line_accesses;
+            for (size_t i = 0; i < levels.size(); i++) {
+                printf("  L%d misses: %llu (%.2f%% of accesses reaching it)\n", (int)(i + 1),
+                       (unsigned long long)f.misses[i],
+                       reaching ? 100.0 * f.misses[i] / reaching : 0.0);
+                reaching = f.misses[i];
+            }
+            printf("  DRAM bytes read: %llu, written: %llu\n",
+                   (unsigned long long)f.dram_read_bytes,
+                   (unsigned long long)f.dram_write_bytes);
+            printf("  Reuse distance histogram (in lines):\n");
+            printf("    cold: %llu\n", (unsigned long long)f.cold);
+            for (int b = 0; b < histogram_buckets; b++) {
+                if (!f.reuse[b]) {
+                    continue;
+                }
+                uint64_t lo = b ? ((uint64_t)1 << (b - 1)) : 0;
+                uint64_t hi = ((uint64_t)1 << b) - 1;
+                printf("    [%llu, %llu]: %llu\n", (unsigned long long)lo,
+                       (unsigned long long)hi, (unsigned long long)f.reuse[b]);
+            }
+        }
+    }
+};
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
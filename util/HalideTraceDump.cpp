@@ -329,12 +329,13 @@ int main(int argc, char * const *argv) {
     int packet_count = 0;
 
     map<string, FuncInfo> func_info;
+    PacketReader reader(file_desc);
 
     printf("[INFO] First pass...\n");
 
     for (;;) {
         Packet p;
-        if (!p.read_from_filedesc(file_desc)) {
+        if (!reader.read(&p)) {
             printf("[INFO] Finished pass 1 after %d packets.\n", packet_count);
             break;
         }
@@ -356,8 +357,7 @@ int main(int argc, char * const *argv) {
     }
 
     packet_count = 0;
-    fseek(file_desc, 0, SEEK_SET);
-    if (ferror(file_desc)){
+    if (!reader.rewind()) {
         fprintf(stderr, "Error: couldn't seek back to beginning of trace file. Aborting.\n");
         exit(-1);
     }
@@ -368,7 +368,7 @@ int main(int argc, char * const *argv) {
 
     for (;;) {
         Packet p;
-        if (!p.read_from_filedesc(file_desc)) {
+        if (!reader.read(&p)) {
             printf("[INFO] Finished pass 2 after %d packets.\n", packet_count);
             if (file_desc != nullptr) {
                 fclose(file_desc);
@@ -7,29 +7,186 @@
 namespace Halide {
 namespace Internal {
 
-bool Packet::read_from_stdin() {
-    return read_from_filedesc(stdin);
+namespace {
+const uint32_t compressed_trace_block_magic = 0x31435448;
 }
 
-bool Packet::read_from_filedesc(FILE *fdesc){
+bool PacketReader::read(Packet *p) {
+    if (format == Compressed) {
+        return read_compressed(p);
+    }
+    uint32_t first_word;
+    if (!read_bytes(&first_word, sizeof(first_word))) {
+        return false;
+    }
+    if (format == Unknown) {
+        // A raw packet can't be anywhere near as large as the magic
+        // number, so the first word tells us the format.
+        format = (first_word == compressed_trace_block_magic) ? Compressed : Raw;
+        if (format == Compressed) {
+            return read_block_body() && read_compressed(p);
+        }
+    }
+    return read_raw(p, first_word);
+}
+
+bool PacketReader::rewind() {
+    if (fseek(fdesc, 0, SEEK_SET) != 0 || ferror(fdesc)) {
+        return false;
+    }
+    format = Unknown;
+    funcs.clear();
+    last_id = 0;
+    block.clear();
+    cursor = 0;
+    return true;
+}
+
+bool PacketReader::read_raw(Packet *p, uint32_t size) {
     size_t header_size = sizeof(halide_trace_packet_t);
-    if (!Packet::read(this, header_size, fdesc)) {
+    p->size = size;
+    if (!read_bytes((uint8_t *)p + sizeof(size), header_size - sizeof(size))) {
+        fprintf(stderr, "Unexpected EOF mid-packet\n");
         return false;
     }
     size_t payload_size = size - header_size;
-    if (payload_size > sizeof(payload)) {
-        fprintf(stderr, "Payload larger than %d bytes in trace stream (%d)\n", (int)sizeof(payload), (int)payload_size);
+    if (payload_size > sizeof(p->payload)) {
+        fprintf(stderr, "Payload larger than %d bytes in trace stream (%d)\n", (int)sizeof(p->payload), (int)payload_size);
         abort();
         return false;
     }
-    if (!Packet::read(payload, payload_size, fdesc)) {
-        fprintf(stderr, "Unexpected EOF mid-packet");
+    if (!read_bytes(p->payload, payload_size)) {
+        fprintf(stderr, "Unexpected EOF mid-packet\n");
+        return false;
+    }
+    return true;
+}
+
+bool PacketReader::next_block() {
+    uint32_t magic;
+    if (!read_bytes(&magic, sizeof(magic))) {
+        return false;
+    }
+    if (magic != compressed_trace_block_magic) {
+        fprintf(stderr, "Bad block header in compressed trace stream\n");
+        exit(-1);
+    }
+    return read_block_body();
+}
+
+bool PacketReader::read_block_body() {
+    uint32_t sizes[2];
+    if (!read_bytes(sizes, sizeof(sizes))) {
+        fprintf(stderr, "Unexpected EOF mid-block\n");
+        return false;
+    }
+    std::vector<uint8_t> compressed(sizes[0]);
+    if (!read_bytes(compressed.data(), sizes[0])) {
+        fprintf(stderr, "Unexpected EOF mid-block\n");
+        return false;
+    }
+    block.clear();
+    block.reserve(sizes[1]);
+    for (size_t i = 0; i < compressed.size(); i++) {
+        block.push_back(compressed[i]);
+        if (compressed[i] == 0 && i + 1 < compressed.size()) {
+            block.insert(block.end(), compressed[++i], 0);
+        }
+    }
+    if (block.size() != sizes[1]) {
+        fprintf(stderr, "Corrupt block in compressed trace stream\n");
+        exit(-1);
+    }
+    cursor = 0;
+    return true;
+}
+
+uint64_t PacketReader::get_uvarint() {
+    uint64_t x = 0;
+    for (int shift = 0; cursor < block.size(); shift += 7) {
+        uint8_t b = block[cursor++];
+        x |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            return x;
+        }
+    }
+    fprintf(stderr, "Truncated varint in compressed trace stream\n");
+    exit(-1);
+    return 0;
+}
+
+int64_t PacketReader::get_svarint() {
+    uint64_t x = get_uvarint();
+    return (int64_t)(x >> 1) ^ -(int64_t)(x & 1);
+}
+
+bool PacketReader::read_compressed(Packet *p) {
+    if (cursor == block.size() && !next_block()) {
         return false;
     }
+
+    uint64_t idx = get_uvarint();
+    if (idx == funcs.size()) {
+        FuncState f;
+        size_t len = get_uvarint();
+        f.name.assign((const char *)block.data() + cursor, len);
+        cursor += len;
+        funcs.push_back(f);
+    } else if (idx > funcs.size()) {
+        fprintf(stderr, "Bad Func index in compressed trace stream\n");
+        exit(-1);
+    }
+    FuncState &f = funcs[idx];
+
+    p->event = (halide_trace_event_code_t)get_uvarint();
+    p->id = last_id = (int32_t)(last_id + get_svarint());
+    p->parent_id = f.parent_id = (int32_t)(f.parent_id + get_svarint());
+    p->type.code = (halide_type_code_t)get_uvarint();
+    p->type.bits = (uint8_t)get_uvarint();
+    p->type.lanes = (uint16_t)get_uvarint();
+    p->value_index = (int32_t)get_uvarint();
+    p->dimensions = (int32_t)get_uvarint();
+
+    int bytes = p->type.bytes();
+    size_t coords_bytes = p->dimensions * sizeof(int32_t);
+    size_t value_bytes = p->type.lanes * bytes;
+    size_t payload_size = (coords_bytes + value_bytes + f.name.size() + 1 + 3) & ~3;
+    if (payload_size > sizeof(p->payload)) {
+        fprintf(stderr, "Payload larger than %d bytes in trace stream (%d)\n", (int)sizeof(p->payload), (int)payload_size);
+        abort();
+        return false;
+    }
+    p->size = (uint32_t)(sizeof(halide_trace_packet_t) + payload_size);
+
+    // Coordinates past the end of the previous packet's are encoded
+    // against zero.
+    f.coords.resize(p->dimensions, 0);
+    for (int i = 0; i < p->dimensions; i++) {
+        f.coords[i] = (int32_t)(f.coords[i] + get_svarint());
+        p->coordinates()[i] = f.coords[i];
+    }
+
+    if (!(f.type == p->type) || f.value.size() != value_bytes) {
+        f.value.assign(value_bytes, 0);
+        f.type = p->type;
+    }
+    for (int i = 0; i < p->type.lanes; i++) {
+        uint64_t prev = 0;
+        memcpy(&prev, f.value.data() + i * bytes, bytes);
+        uint64_t x;
+        if (p->type.code == halide_type_int || p->type.code == halide_type_uint) {
+            x = prev + (uint64_t)get_svarint();
+        } else {
+            x = prev ^ get_uvarint();
+        }
+        memcpy(f.value.data() + i * bytes, &x, bytes);
+    }
+    memcpy(p->value(), f.value.data(), value_bytes);
+    memcpy(p->func(), f.name.c_str(), f.name.size() + 1);
     return true;
 }
 
-bool Packet::read(void *d, size_t size, FILE *fdesc) {
+bool PacketReader::read_bytes(void *d, size_t size) {
     uint8_t *dst = (uint8_t *)d;
     if (!size) return true;
     size_t s = fread(dst, 1, size, fdesc);
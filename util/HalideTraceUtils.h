@@ -3,6 +3,8 @@
 
 #include "HalideRuntime.h"
 #include <stdio.h>
+#include <string>
+#include <vector>
 
 namespace Halide {
 namespace Internal {
@@ -76,16 +78,76 @@ struct Packet : public halide_trace_packet_t {
         const uint8_t *val = (const uint8_t *)(value()) + idx * type.bytes();
         return value_as<T>(type, (const halide_scalar_value_t *)val);
     }
+};
+
+// A streaming reader for binary trace files. It understands both the
+// raw format, which is a sequence of halide_trace_packet_t, and the
+// compressed format written by halide_default_trace when the
+// HL_TRACE_COMPRESS environment variable is set.
+//
+// A compressed trace is a sequence of blocks. Each block starts with
+// three little-endian uint32s: the magic number 0x31435448 ("HTC1"),
+// the size of the block payload, and the size of the payload once
+// decompressed. In the payload, every zero byte is followed by a
+// count n, and stands for n + 1 zero bytes. The decompressed payload
+// is a sequence of packets made of unsigned (u) and zigzag signed (s)
+// LEB128 varints:
+//
+//   u func index (if it's the first time the Func is seen, followed by
+//     u name length and the name bytes)
+//   u event, s id delta, s parent_id delta, u type code, u type bits,
+//   u type lanes, u value_index, u dimensions, s coordinate deltas,
+//   one varint per value lane
+//
+// The id is delta-encoded against the previous packet. The parent_id,
+// coordinates and values are delta-encoded against the previous
+// packet from the same Func. Integer values use the signed
+// difference, and floats and handles the unsigned xor of their bits,
+// with respect to the previous value if it had the same type.
+class PacketReader {
+public:
+    PacketReader(FILE *fdesc) : fdesc(fdesc) {}
 
-    // Grab a packet from stdin. Returns false when stdin closes.
-    bool read_from_stdin();
+    // Read the next packet. Returns false at the end of the trace.
+    bool read(Packet *p);
 
-    // Grab a packet from a particular fctl file descriptor. Returns false when end is reached.
-    bool read_from_filedesc(FILE *fdesc);
+    // Restart from the beginning of the file. Returns false if the
+    // file can't be rewound (e.g. it's a pipe).
+    bool rewind();
+
+    bool is_compressed() const {
+        return format == Compressed;
+    }
 
 private:
-    // Do a blocking read of some number of bytes from a unistd file descriptor.
-    bool read(void *d, size_t size, FILE *fdesc);
+    enum Format {Unknown, Raw, Compressed};
+
+    struct FuncState {
+        std::string name;
+        int32_t parent_id = 0;
+        std::vector<int32_t> coords;
+        halide_type_t type;
+        std::vector<uint8_t> value;
+    };
+
+    FILE *fdesc;
+    Format format = Unknown;
+
+    // Decoder state for compressed traces.
+    std::vector<FuncState> funcs;
+    int32_t last_id = 0;
+    std::vector<uint8_t> block;
+    size_t cursor = 0;
+
+    bool read_raw(Packet *p, uint32_t size);
+    bool read_compressed(Packet *p);
+    bool next_block();
+    bool read_block_body();
+    uint64_t get_uvarint();
+    int64_t get_svarint();
+
+    // Do a blocking read of some number of bytes from a file descriptor.
+    bool read_bytes(void *d, size_t size);
 };
 
 }
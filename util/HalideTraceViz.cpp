@@ -11,6 +11,10 @@
 #include <queue>
 #include <iostream>
 #include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
 #ifdef _MSC_VER
 #include <io.h>
 typedef int64_t ssize_t;
@@ -187,6 +191,142 @@ void composite(uint8_t *a, uint8_t *b, uint8_t *dst) {
     }
 }
 
+// A minimal thread pool that runs a function over bands of rows of
+// the frame in parallel. The calling thread handles one of the bands.
+class RowPool {
+    vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable wakeup, done;
+    std::function<void(int, int)> task;
+    int num_bands, rows = 0, generation = 0, remaining = 0;
+    bool shutting_down = false;
+
+    void run_band(int band) {
+        int y_min = (rows * band) / num_bands;
+        int y_max = (rows * (band + 1)) / num_bands;
+        if (y_min < y_max) {
+            task(y_min, y_max);
+        }
+    }
+
+    void worker(int band) {
+        int seen = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wakeup.wait(lock, [&] { return shutting_down || generation != seen; });
+                if (shutting_down) {
+                    return;
+                }
+                seen = generation;
+            }
+            run_band(band);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (--remaining == 0) {
+                    done.notify_one();
+                }
+            }
+        }
+    }
+
+public:
+    RowPool(int n) : num_bands(std::max(1, n)) {
+        for (int i = 1; i < num_bands; i++) {
+            threads.emplace_back(&RowPool::worker, this, i);
+        }
+    }
+
+    ~RowPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            shutting_down = true;
+        }
+        wakeup.notify_all();
+        for (auto &t : threads) {
+            t.join();
+        }
+    }
+
+    // Call f(y_min, y_max) on disjoint bands covering [0, r), and
+    // wait for all of them to finish.
+    void run(int r, std::function<void(int, int)> f) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            task = std::move(f);
+            rows = r;
+            remaining = num_bands - 1;
+            generation++;
+        }
+        wakeup.notify_all();
+        run_band(0);
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [&] { return remaining == 0; });
+    }
+};
+
+// Writes frames to stdout on a background thread, so that the video
+// encoder on the other end of the pipe can consume a frame while the
+// next one is being rendered. At most one frame is in flight.
+class FrameWriter {
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable cond;
+    const uint32_t *pending = nullptr;
+    size_t frame_bytes;
+    bool shutting_down = false, failed = false;
+
+    void worker() {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            cond.wait(lock, [&] { return shutting_down || pending; });
+            if (!pending) {
+                return;
+            }
+            const uint32_t *frame = pending;
+            lock.unlock();
+            ssize_t bytes_written = write(1, frame, frame_bytes);
+            lock.lock();
+            failed |= (bytes_written < (ssize_t)frame_bytes);
+            pending = nullptr;
+            cond.notify_all();
+        }
+    }
+
+public:
+    FrameWriter(size_t frame_bytes) : frame_bytes(frame_bytes) {
+        thread = std::thread(&FrameWriter::worker, this);
+    }
+
+    ~FrameWriter() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            shutting_down = true;
+        }
+        cond.notify_all();
+        thread.join();
+    }
+
+    // Wait for the previous frame to be written, then start writing
+    // this one. The frame must not be modified until the next call to
+    // submit or flush. Returns false if a write has failed.
+    bool submit(const uint32_t *frame) {
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.wait(lock, [&] { return !pending; });
+        pending = frame;
+        cond.notify_all();
+        return !failed;
+    }
+
+    // Wait for all frames to be written. Returns false if a write has
+    // failed.
+    bool flush() {
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.wait(lock, [&] { return !pending; });
+        return !failed;
+    }
+};
+
 #define FONT_W 12
 #define FONT_H 32
 void draw_text(const char *text, int x, int y, uint32_t color, uint32_t *dst, int dst_width, int dst_height) {
@@ -221,7 +361,7 @@ void usage() {
     fprintf(stderr,
             R"USAGE(
 HalideTraceViz accepts Halide-generated binary tracing packets from
-stdin, and outputs them as raw 8-bit rgba32 pixel values to
+stdin (raw, or compressed by setting HL_TRACE_COMPRESS=1), and outputs them as raw 8-bit rgba32 pixel values to
 stdout. You should pipe the output of HalideTraceViz into a video
 encoder or player.
 
@@ -259,6 +399,18 @@ parameters should be set zero or one times:
  --hold frames: How many frames to output after the end of the
     trace. Defaults to 250.
 
+ --frames first last: Only output the frames in the given range. The
+    trace is still processed up to the first frame, but without the
+    cost of compositing and writing frames, and reading stops after
+    the last frame. Defaults to all frames.
+
+ --skip n: Only output every nth frame, starting from the first. Use
+    this together with a smaller timestep to get a preview of a long
+    trace quickly. Defaults to 1.
+
+ --threads n: The number of threads used to composite frames. Must
+    be positive. Defaults to the number of cores.
+
 The following parameters can be set once per Func. With the exception
 of label, they continue to take effect for all subsequently defined
 Funcs.
@@ -321,6 +473,12 @@ Funcs.
      appears with its bottom left corner at the current coordinates
      and fades in over n frames.
 
+The trace is read one packet at a time, so its length doesn't affect
+the memory used. However, the frame is kept in memory as several
+full-size layers, and the state of every Func and of every live
+pipeline, realization and production is kept too, so the memory used
+grows with --size and with the number of Funcs.
+
 )USAGE");
 }
 
@@ -378,6 +536,8 @@ int run(int argc, char **argv) {
 
     int timestep = 10000;
     int hold_frames = 250;
+    int first_frame = 0, last_frame = -1, frame_skip = 1;
+    int num_threads = std::thread::hardware_concurrency();
 
     FuncInfo::Config config;
     config.x = config.y = 0;
@@ -490,6 +650,19 @@ int run(int argc, char **argv) {
         } else if (next == "--hold") {
             expect(i + 1 < argc, i);
             hold_frames = atoi(argv[++i]);
+        } else if (next == "--frames") {
+            expect(i + 2 < argc, i);
+            first_frame = atoi(argv[++i]);
+            last_frame = atoi(argv[++i]);
+            expect(first_frame >= 0 && last_frame >= first_frame, i);
+        } else if (next == "--skip") {
+            expect(i + 1 < argc, i);
+            frame_skip = atoi(argv[++i]);
+            expect(frame_skip > 0, i);
+        } else if (next == "--threads") {
+            expect(i + 1 < argc, i);
+            num_threads = atoi(argv[++i]);
+            expect(num_threads > 0, i);
         } else if (next == "--uninit") {
             expect(i + 3 < argc, i);
             int r = atoi(argv[++i]);
@@ -521,8 +694,18 @@ int run(int argc, char **argv) {
     uint32_t *text = new uint32_t[frame_width * frame_height];
     memset(text, 0, 4 * frame_width * frame_height);
 
-    uint32_t *blend = new uint32_t[frame_width * frame_height];
-    memset(blend, 0, 4 * frame_width * frame_height);
+    // Two blend buffers, so that one can be written out while the
+    // next frame is composited into the other.
+    uint32_t *blend[2];
+    for (int b = 0; b < 2; b++) {
+        blend[b] = new uint32_t[frame_width * frame_height];
+        memset(blend[b], 0, 4 * frame_width * frame_height);
+    }
+    int current_blend = 0;
+    int frame_index = 0;
+
+    RowPool pool(num_threads);
+    FrameWriter writer(4 * frame_width * frame_height);
 
     struct PipelineInfo {
         string name;
@@ -531,6 +714,8 @@ int run(int argc, char **argv) {
 
     map<uint32_t, PipelineInfo> pipeline_info;
 
+    PacketReader reader(stdin);
+
     size_t end_counter = 0;
     size_t packet_clock = 0;
     for (;;) {
@@ -546,62 +731,77 @@ int run(int argc, char **argv) {
             const ssize_t frame_bytes = 4 * frame_width * frame_height;
 
             while (halide_clock >= video_clock) {
-                // Composite text over anim over image
-                for (int i = 0; i < frame_width * frame_height; i++) {
-                    uint8_t *anim_decay_px  = (uint8_t *)(anim_decay + i);
-                    uint8_t *anim_px  = (uint8_t *)(anim + i);
-                    uint8_t *image_px = (uint8_t *)(image + i);
-                    uint8_t *text_px  = (uint8_t *)(text + i);
-                    uint8_t *blend_px = (uint8_t *)(blend + i);
-                    // anim over anim_decay
-                    composite(anim_decay_px, anim_px, anim_decay_px);
-                    // anim_decay over image
-                    composite(image_px, anim_decay_px, blend_px);
-                    // text over image
-                    composite(blend_px, text_px, blend_px);
-                }
-
-                // Dump the frame
-                ssize_t bytes_written = write(1, blend, frame_bytes);
-                if (bytes_written < frame_bytes) {
-                    fprintf(stderr, "Could not write frame to stdout.\n");
-                    return -1;
-                }
+                bool emit = (frame_index >= first_frame &&
+                             (last_frame < 0 || frame_index <= last_frame) &&
+                             (frame_index - first_frame) % frame_skip == 0);
+                uint32_t *dst = blend[current_blend];
+
+                // Composite text over anim over image, then decay the
+                // animation layers. Frames that aren't output still
+                // need their animation state updated, but skip the
+                // rest of the compositing.
+                const uint32_t inv_d0 = (1 << 24) / decay_factor[0];
+                const uint32_t inv_d1 = (1 << 24) / decay_factor[1];
+                pool.run(frame_height, [&](int y_min, int y_max) {
+                    for (int i = y_min * frame_width; i < y_max * frame_width; i++) {
+                        uint8_t *anim_decay_px  = (uint8_t *)(anim_decay + i);
+                        uint8_t *anim_px  = (uint8_t *)(anim + i);
+                        // anim over anim_decay
+                        composite(anim_decay_px, anim_px, anim_decay_px);
+                        if (emit) {
+                            uint8_t *image_px = (uint8_t *)(image + i);
+                            uint8_t *text_px  = (uint8_t *)(text + i);
+                            uint8_t *blend_px = (uint8_t *)(dst + i);
+                            // anim_decay over image
+                            composite(image_px, anim_decay_px, blend_px);
+                            // text over image
+                            composite(blend_px, text_px, blend_px);
+                        }
 
-                video_clock += timestep;
+                        // Decay the anim_decay
+                        if (decay_factor[1] != 1) {
+                            uint32_t color = anim_decay[i];
+                            uint32_t rgb = color & 0x00ffffff;
+                            uint32_t alpha = (color >> 24);
+                            alpha *= inv_d1;
+                            alpha &= 0xff000000;
+                            anim_decay[i] = alpha | rgb;
+                        }
 
-                // Decay the anim_decay
-                if (decay_factor[1] != 1) {
-                    const uint32_t inv_d1 = (1 << 24) / decay_factor[1];
-                    for (int i = 0; i < frame_width * frame_height; i++) {
-                        uint32_t color = anim_decay[i];
+                        // Also decay the anim
+                        uint32_t color = anim[i];
                         uint32_t rgb = color & 0x00ffffff;
                         uint32_t alpha = (color >> 24);
-                        alpha *= inv_d1;
+                        alpha *= inv_d0;
                         alpha &= 0xff000000;
-                        anim_decay[i] = alpha | rgb;
+                        anim[i] = alpha | rgb;
                     }
-                }
+                });
 
-                // Also decay the anim
-                const uint32_t inv_d0 = (1 << 24) / decay_factor[0];
-                for (int i = 0; i < frame_width * frame_height; i++) {
-                    uint32_t color = anim[i];
-                    uint32_t rgb = color & 0x00ffffff;
-                    uint32_t alpha = (color >> 24);
-                    alpha *= inv_d0;
-                    alpha &= 0xff000000;
-                    anim[i] = alpha | rgb;
+                // Dump the frame
+                if (emit) {
+                    if (!writer.submit(dst)) {
+                        fprintf(stderr, "Could not write frame to stdout.\n");
+                        return -1;
+                    }
+                    current_blend ^= 1;
                 }
+
+                video_clock += timestep;
+                frame_index++;
             }
 
             // Blank anim
             memset(anim, 0, frame_bytes);
+
+            if (last_frame >= 0 && frame_index > last_frame) {
+                break;
+            }
         }
 
         // Read a tracing packet
         Packet p;
-        if (!p.read_from_stdin()) {
+        if (!reader.read(&p)) {
             end_counter++;
             continue;
         }
@@ -616,7 +816,13 @@ int run(int argc, char **argv) {
             continue;
         }
 
-        PipelineInfo pipeline = pipeline_info[p.parent_id];
+        // Look up the parent without inserting it, so that events with
+        // an unknown parent don't grow the map for the rest of the trace.
+        PipelineInfo pipeline = {"", 0};
+        auto parent = pipeline_info.find(p.parent_id);
+        if (parent != pipeline_info.end()) {
+            pipeline = parent->second;
+        }
 
         if (p.event == halide_trace_begin_realization ||
             p.event == halide_trace_produce ||
@@ -782,6 +988,11 @@ int run(int argc, char **argv) {
 
     }
 
+    if (!writer.flush()) {
+        fprintf(stderr, "Could not write frame to stdout.\n");
+        return -1;
+    }
+
     fprintf(stderr, "Total number of Funcs: %d\n", (int)func_info.size());
 
     // Print stats about the Func gleaned from the trace.